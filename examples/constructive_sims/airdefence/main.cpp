@@ -22,77 +22,124 @@
 *****************************************************************************/
 
 #include <chrono>
-#include <vector>
+#include <algorithm>
 
-#include "parallel.h"
+#include "parameter_sweep.h"
 #include "airdefencesim.h"
 
 int main(int argc, char *argv[])
 {
-    using namespace std::chrono_literals;
     auto start = std::chrono::high_resolution_clock::now();
 
     auto p = Parallel::createParallel(std::thread::hardware_concurrency());
 
-    size_t nSims = 0;
+    // simulations stop as soon as every plane is shot down or reached the target
+    p->setStopWhenFinished(true);
+
     double tStep = 1.0;
-    double simDur = 700.0;
+    double simDur = 700.0; // maximum
 
-    std::vector<std::shared_ptr<ReachEvaluation>> results;
+    auto sweep = ParameterSweep::createParameterSweep();
 
-    for(unsigned int a = 0; a < 60; a++)
+    // arguments: [--lockstep] [cache directory]
+    bool lockstep = false;
+    std::shared_ptr<ResultCache> cache;
+    for(int k = 1; k < argc; k++)
     {
-        for(unsigned int v = 0; v < 60; v++ )
+        if(std::string(argv[k]) == "--lockstep")
+        {
+            // all points have the same agents -> step batches of them together
+            lockstep = true;
+        }
+        else
         {
-            double missileSpeed = 500.0 + a * 25.0;
-            double planeSpeed = 500.0 + v * 25.0;
+            // points of overlapping sweeps are simulated once
+            cache = ResultCache::createResultCache(argv[k]);
+            sweep->setResultCache(cache);
+        }
+    }
 
-            auto sim = Simulation::createSimulation(nSims++);
+    sweep->addLinearAxis("missile_speed", 500.0, 25.0, 60);
+    sweep->addLinearAxis("plane_speed", 500.0, 25.0, 60);
+    sweep->setScenarioBuilder([](const ParameterPoint& point, unsigned int simId)
+    {
+        double missileSpeed = point["missile_speed"];
+        double planeSpeed = point["plane_speed"];
 
-            sim->setAgentFactory(std::shared_ptr<AirdefenceAgentFactory>(new AirdefenceAgentFactory(planeSpeed, missileSpeed)));
-            sim->setEnvironmentFactory(std::shared_ptr<PlaneEnvFactory>(new PlaneEnvFactory()));
-            sim->setEnableLogMessages(false);
+        auto sim = Simulation::createSimulation(simId);
 
-            auto eval = std::shared_ptr<ReachEvaluation>(new ReachEvaluation(planeSpeed, missileSpeed));
-            sim->setEvaluation(eval);
-            results.push_back(eval);
+        sim->setAgentFactory(std::shared_ptr<AirdefenceAgentFactory>(new AirdefenceAgentFactory(planeSpeed, missileSpeed)));
+        sim->setEnvironmentFactory(std::shared_ptr<PlaneEnvFactory>(new PlaneEnvFactory()));
+        sim->setEnableLogMessages(false);
+        sim->setEvaluation(std::shared_ptr<ReachEvaluation>(new ReachEvaluation(planeSpeed, missileSpeed)));
 
-            p->addSimulation(sim, tStep, simDur);
-        }
-    }
-
-    p->run();
+        return sim;
+    });
 
-    while(true)
+    // slow planes need more steps till they are shot down or reach the target -> start them first
+    sweep->setCostEstimator([](const ParameterPoint& point)
     {
-        auto[done, queued] = p->getProgress();
-        double progress = done / nSims * 100.0;
-        std::cout << "[" << done << ", " << queued << "], " << progress << "%" << std::endl;
+        return 1.0 / point["plane_speed"];
+    });
 
-        if(done == nSims)
-            break;
+    size_t nSims = sweep->numberOfPoints();
 
-        std::this_thread::sleep_for(10000ms);
+    // report progress whenever another percent of the simulations finished
+    size_t reportEvery = std::max<size_t>(1, nSims / 100);
+    std::atomic_size_t nDone(0);
+    std::mutex printMutex;
+    p->setCompletionCallback([&](std::shared_ptr<Simulation>)
+    {
+        size_t done = ++nDone;
+        if(done % reportEvery == 0 || done == nSims)
+        {
+            std::unique_lock<std::mutex> lock(printMutex);
+            std::cout << p->liveReport() << std::endl;
+        }
+    });
+
+    ResultTable results;
+    if(lockstep)
+    {
+        sweep->setStopWhenFinished(true);
+        results = sweep->runLockstep(std::thread::hardware_concurrency(), 64, [](size_t nRuns)
+        {
+            return std::shared_ptr<ReachBatchEvaluation>(new ReachBatchEvaluation(nRuns));
+        }, tStep, simDur);
+    }
+    else
+    {
+        results = sweep->run(p, tStep, simDur);
+        std::cout << "Tail idle time: " << p->tailIdleSeconds() << " s" << std::endl;
     }
 
     auto end = std::chrono::high_resolution_clock::now();
 
+    results.writeCsv("airdefence_results.csv");
+
     // print results
-    std::sort(results.begin(), results.end(), [](std::shared_ptr<ReachEvaluation> a,
-                std::shared_ptr<ReachEvaluation> b)
-    {
-        return a->m_agentsReachedId.size() < b->m_agentsReachedId.size();
-    });
+    results.sortByColumn("hits");
 
     std::cout << "plane_speed, missile_speed, hits" << std::endl;
-    std::for_each(results.begin(), results.end(), [](std::shared_ptr<ReachEvaluation> r)
+    for(size_t r = 0; r < results.numberOfRows(); r++)
     {
-        std::cout << r->m_speedPlane << ", " << r->m_speedMissile << ", " << r->m_agentsReachedId.size() << std::endl;
-    });
+        std::cout << results.value(r, "plane_speed") << ", " << results.value(r, "missile_speed") << ", "
+                  << results.value(r, "hits") << std::endl;
+    }
 
     std::chrono::duration<double, std::milli> elapsed = end-start;
     std::cout << "Waited " << elapsed.count() << " ms" << std::endl;
-    std::cout << "Time per step: " << elapsed.count() / (nSims * (simDur/tStep)) << " ms" << std::endl;
+    // simulations end at different times
+    double nSteps = 0.0;
+    for(double t: results.column("sim_time"))
+    {
+        nSteps += t / tStep;
+    }
+    std::cout << "Time per step: " << elapsed.count() / nSteps << " ms" << std::endl;
+    if(cache)
+    {
+        std::cout << "Cached results: " << cache->hits() << ", simulated: " << cache->misses() << std::endl;
+    }
 
     return 0;
 }
@@ -22,77 +22,79 @@
 *****************************************************************************/
 
 #include <chrono>
-#include <vector>
+#include <algorithm>
 
-#include "parallel.h"
+#include "parameter_sweep.h"
 #include "clsimulation.h"
 
 int main(int argc, char *argv[])
 {
-    using namespace std::chrono_literals;
     auto start = std::chrono::high_resolution_clock::now();
 
     auto p = Parallel::createParallel(std::thread::hardware_concurrency());
 
-    size_t nSims = 0;
+    // each worker resets its environment and its 900 humans in place for the next run
+    p->setRecycleSimulations(true);
+
     double tStep = 0.2;
     double simDur = 60.0;
+    uint64_t masterSeed = 2021;
 
-    std::vector<std::shared_ptr<StressAccumulatorEvaluation>> results;
-
-    for(unsigned int a = 0; a < 200; a++)
+    auto sweep = ParameterSweep::createParameterSweep();
+    sweep->addLinearAxis("max_acceleration", 0.1, 0.1, 200);
+    sweep->addLinearAxis("max_speed", 0.1, 0.1, 200);
+    sweep->setScenarioBuilder([masterSeed](const ParameterPoint& point, unsigned int simId)
     {
-        for(unsigned int v = 0; v < 200; v++ )
-        {
-            double maxSpeed = 0.1+0.1*v;
-            double maxAcceleration = 0.1+0.1*a;
+        double maxSpeed = point["max_speed"];
+        double maxAcceleration = point["max_acceleration"];
 
-            auto sim = Simulation::createSimulation(nSims++);
+        auto sim = Simulation::createSimulation(simId);
+        sim->setMasterSeed(masterSeed);
 
-            sim->setAgentFactory(std::shared_ptr<CivilianAgentFactory>(new CivilianAgentFactory(maxSpeed, maxAcceleration)));
-            sim->setEnvironmentFactory(std::shared_ptr<CLEnvFactory>(new CLEnvFactory()));
+        sim->setAgentFactory(std::shared_ptr<CivilianAgentFactory>(new CivilianAgentFactory(maxSpeed, maxAcceleration)));
+        sim->setEnvironmentFactory(std::shared_ptr<CLEnvFactory>(new CLEnvFactory()));
+        sim->setEvaluation(std::shared_ptr<StressAccumulatorEvaluation>(new StressAccumulatorEvaluation(maxSpeed, maxAcceleration)));
 
-            auto eval = std::shared_ptr<StressAccumulatorEvaluation>(new StressAccumulatorEvaluation(maxSpeed, maxAcceleration));
-            sim->setEvaluation(eval);
-            results.push_back(eval);
-
-            p->addSimulation(sim, tStep, simDur);
-        }
-    }
+        return sim;
+    });
 
-    p->run();
+    size_t nSims = sweep->numberOfPoints();
 
-    while(true)
+    // report progress whenever another percent of the simulations finished
+    size_t reportEvery = std::max<size_t>(1, nSims / 100);
+    std::atomic_size_t nDone(0);
+    std::mutex printMutex;
+    p->setCompletionCallback([&](std::shared_ptr<Simulation>)
     {
-        auto[done, queued] = p->getProgress();
-        double progress = done / nSims * 100.0;
-        std::cout << "[" << done << ", " << queued << "], " << progress << "%" << std::endl;
-
-        if(done == nSims)
-            break;
+        size_t done = ++nDone;
+        if(done % reportEvery == 0 || done == nSims)
+        {
+            std::unique_lock<std::mutex> lock(printMutex);
+            std::cout << p->liveReport() << std::endl;
+        }
+    });
 
-        std::this_thread::sleep_for(10000ms);
-    }
+    ResultTable results = sweep->run(p, tStep, simDur);
 
     auto end = std::chrono::high_resolution_clock::now();
 
+    results.writeCsv("claustrophobia_results.csv");
+
     // print results
-    std::sort(results.begin(), results.end(), [](std::shared_ptr<StressAccumulatorEvaluation> a,
-                std::shared_ptr<StressAccumulatorEvaluation> b)
-    {
-        return a->m_stressSeconds < b->m_stressSeconds;
-    });
+    results.sortByColumn("stress_seconds");
 
     std::cout << "max v, max a, stress seconds, sim time" << std::endl;
-    std::for_each(results.begin(), results.begin()+10, [](std::shared_ptr<StressAccumulatorEvaluation> r)
+    for(size_t r = 0; r < std::min<size_t>(10, results.numberOfRows()); r++)
     {
-        std::cout << r->m_maxSpeed << ", " << r->m_maxAcceleration << ", "
-                  << r->m_stressSeconds << ", " << r->m_currentTime << std::endl;
-    });
+        std::cout << results.value(r, "max_speed") << ", " << results.value(r, "max_acceleration") << ", "
+                  << results.value(r, "stress_seconds") << ", " << results.value(r, "sim_time") << std::endl;
+    }
 
     std::chrono::duration<double, std::milli> elapsed = end-start;
     std::cout << "Waited " << elapsed.count() << " ms" << std::endl;
-    std::cout << "Time per step: " << elapsed.count() / (nSims * (simDur/tStep)) << " ms" << std::endl;
+    auto stats = p->getLiveStatistics();
+    std::cout << "Time per step: " << 1000.0 / stats.stepsPerSecond << " ms" << std::endl;
+    std::cout << p->workerReport();
 
     return 0;
 }
@@ -0,0 +1,150 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <string>
+
+#include "parallel.h"
+#include "clsimulation.h"
+
+/**
+ * The former Parallel implementation: one shared queue, one mutex,
+ * one simulation claimed at a time. Kept here as reference.
+ */
+class SharedQueueParallel
+{
+public:
+    SharedQueueParallel(size_t nThreads) : m_nbrThreads(nThreads) {}
+
+    void addSimulation(std::shared_ptr<Simulation> aSimulation, double timeSteps, double simulationTime)
+    {
+        m_simQueue.push({aSimulation, timeSteps, simulationTime});
+    }
+
+    void runAndWait()
+    {
+        std::vector<std::thread> threads;
+        for(size_t k = 0; k < m_nbrThreads; k++)
+        {
+            threads.push_back(std::thread([this] { this->doWork(); } ));
+        }
+
+        for(std::thread& t : threads)
+        {
+            t.join();
+        }
+    }
+
+private:
+    void doWork()
+    {
+        while (true)
+        {
+            Parallel::SimQueueElement sq;
+            {
+                std::unique_lock<std::mutex> lock(m_queueMutex);
+                if( m_simQueue.empty() )
+                {
+                    return;
+                }
+                sq = m_simQueue.front();
+                m_simQueue.pop();
+            }
+
+            auto[sim, ts, dur] = sq;
+            sim->initEnvironment();
+            sim->initAgents();
+            sim->runSimulation(ts, dur);
+        }
+    }
+
+    std::queue<Parallel::SimQueueElement> m_simQueue;
+    size_t m_nbrThreads;
+    std::mutex m_queueMutex;
+};
+
+std::vector<std::shared_ptr<Simulation>> createSims(size_t nSims)
+{
+    std::vector<std::shared_ptr<Simulation>> sims;
+    for(size_t k = 0; k < nSims; k++)
+    {
+        // varying speeds -> varying costs
+        double maxSpeed = 0.1 + 0.1 * (k % 20);
+        double maxAcceleration = 0.1 + 0.1 * ((k / 20) % 20);
+
+        auto sim = Simulation::createSimulation(k);
+        sim->setAgentFactory(std::shared_ptr<CivilianAgentFactory>(new CivilianAgentFactory(maxSpeed, maxAcceleration)));
+        sim->setEnvironmentFactory(std::shared_ptr<CLEnvFactory>(new CLEnvFactory()));
+        sim->setEnableLogMessages(false);
+        sims.push_back(sim);
+    }
+    return sims;
+}
+
+int main(int argc, char *argv[])
+{
+    // usage: parallelbench [number of simulations] [simulation duration s] [chunk size] [pin 0/1]
+    size_t nSims = argc > 1 ? std::stoul(argv[1]) : 400;
+    double simDur = argc > 2 ? std::stod(argv[2]) : 0.4;
+    size_t chunkSize = argc > 3 ? std::stoul(argv[3]) : 4;
+    bool pinThreads = argc > 4 ? std::stoi(argv[4]) != 0 : false;
+    double tStep = 0.2;
+    size_t nThreads = std::thread::hardware_concurrency();
+
+    std::cout << nSims << " simulations of " << simDur << " s on " << nThreads << " threads" << std::endl;
+
+    {
+        auto sims = createSims(nSims);
+        auto start = std::chrono::high_resolution_clock::now();
+
+        SharedQueueParallel p(nThreads);
+        for(auto& s: sims)
+            p.addSimulation(s, tStep, simDur);
+        p.runAndWait();
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Shared queue: " << elapsed.count() << " ms" << std::endl;
+    }
+
+    {
+        auto sims = createSims(nSims);
+        auto start = std::chrono::high_resolution_clock::now();
+
+        auto p = Parallel::createParallel(nThreads);
+        p->setChunkSize(chunkSize);
+        p->setPinThreads(pinThreads);
+        for(auto& s: sims)
+            p->addSimulation(s, tStep, simDur);
+        p->run();
+        p->wait();
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Work stealing (chunk " << chunkSize << (pinThreads ? ", pinned" : "") << "): "
+                  << elapsed.count() << " ms" << std::endl;
+        std::cout << p->workerReport();
+    }
+
+    return 0;
+}
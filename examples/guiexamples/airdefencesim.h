@@ -35,6 +35,7 @@
 #include "target.h"
 #include "evaluation.h"
 #include "simulation.h"
+#include "lockstep_batch.h"
 
 /**
  * @brief Open space environment
@@ -69,6 +70,12 @@ public:
     AirdefenceAgentFactory(double planeSpeed, double missileSpeed): AgentFactory(),
         m_planeSpeed(planeSpeed), m_missileSpeed(missileSpeed) {}
     virtual ~AirdefenceAgentFactory() {}
+
+    std::string configuration() const override
+    {
+        return "plane_speed=" + std::to_string(m_planeSpeed) + " missile_speed=" + std::to_string(m_missileSpeed);
+    }
+
     std::list<std::shared_ptr<Agent>> createAgents() override
     {
         std::list<std::shared_ptr<Agent>> agents;
@@ -86,32 +93,52 @@ public:
 
             auto hp = std::shared_ptr<HostilePlane>(new HostilePlane(20000+i));
             hp->setPosition(planePos);
+            hp->setVelocityLimit(m_planeSpeed);
             hp->setMovingTowardsTarget(target, m_planeSpeed);
             agents.push_back(hp);
         }
 
         auto m = std::shared_ptr<MissileStation>(new MissileStation(2000, nPlanes, 50000, m_missileSpeed));
         m->setPosition(Eigen::Vector2d(-70000.0, 0.0), true);
+        setStationary(m);
         agents.push_back(m);
 
         auto n = std::shared_ptr<MissileStation>(new MissileStation(3000, nPlanes, 50000, m_missileSpeed));
         n->setPosition(Eigen::Vector2d(60000.0, -60000.0), true);
+        setStationary(n);
         agents.push_back(n);
 
         auto r = std::shared_ptr<MissileStation>(new MissileStation(4000, nPlanes, 50000, m_missileSpeed));
         r->setPosition(Eigen::Vector2d(18000.0, 75000.0), true);
+        setStationary(r);
         agents.push_back(r);
 
         auto l = std::shared_ptr<MissileStation>(new MissileStation(5000, nPlanes, 50000, m_missileSpeed));
         l->setPosition(Eigen::Vector2d(170000, 0.0), true);
+        setStationary(l);
         agents.push_back(l);
 
         auto trg = Target::createTarget(102, target, 25000.0);
+        trg->setVelocityLimit(0.0);
         agents.push_back(trg);
 
         return agents;
     }
 
+private:
+    // stations and their sensors do not move -> zero speed bound, see LookaheadEnvironment
+    static void setStationary(const std::shared_ptr<MissileStation>& station)
+    {
+        station->setVelocityLimit(0.0);
+        for(const auto& sa: station->getSubAgents())
+        {
+            if(sa->type() == AgentType::EProxSensor)
+            {
+                sa->setVelocityLimit(0.0);
+            }
+        }
+    }
+
     double m_planeSpeed;
     double m_missileSpeed;
 };
@@ -174,6 +201,27 @@ public:
         return s.str();
     }
 
+    ResultValues getResultValues() override
+    {
+        return {{"plane_speed", m_speedPlane}, {"missile_speed", m_speedMissile},
+                {"hits", double(m_agentsReachedId.size())}, {"sim_time", m_currentTime}};
+    }
+
+    bool isSimulationFinished(std::shared_ptr<Simulation> sim) override
+    {
+        // Finished when each hostile plane either reached the target or was shot
+        // down. Reached planes stay counted, so the result cannot change anymore.
+        for(const auto& a : sim->getEnvironment()->getAgents())
+        {
+            if(a->type() == EPlaneHostile && a->getEnabled() && m_agentsReachedId.count(a->id()) == 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     std::set<unsigned long> m_agentsReachedId;
     double m_currentTime;
     int m_computationTime = 0;
@@ -182,4 +230,52 @@ public:
 
 };
 
+// ReachEvaluation for the runs of a LockstepBatch
+class ReachBatchEvaluation: public BatchEvaluation
+{
+public:
+
+    ReachBatchEvaluation(size_t nRuns): BatchEvaluation(), m_agentsReachedId(nRuns)
+    {
+    }
+
+    virtual ~ReachBatchEvaluation()
+    {
+    }
+
+    void evaluate(const LockstepBatch& batch, size_t run, double /*timeStep*/) override
+    {
+        for(const auto& ar : batch.agentsInSensorRange(batch.agentIndex(102), run))
+        {
+            // only consider hostile planes
+            if(ar.targetId >= 20000)
+            {
+                m_agentsReachedId[run].insert(ar.targetId);
+            }
+        }
+    }
+
+    Evaluation::ResultValues getResultValues(const LockstepBatch& batch, size_t run) override
+    {
+        return {{"hits", double(m_agentsReachedId[run].size())}, {"sim_time", batch.runningTime(run)}};
+    }
+
+    bool isRunFinished(const LockstepBatch& batch, size_t run) override
+    {
+        // see ReachEvaluation::isSimulationFinished
+        for(size_t a = 0; a < batch.numberOfAgents(); a++)
+        {
+            if(batch.agentType(a) == EPlaneHostile && batch.enabled(a, run) &&
+                    m_agentsReachedId[run].count(batch.agentId(a)) == 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::vector<std::set<unsigned long>> m_agentsReachedId;
+};
+
 #endif //AD_SIM_H
@@ -77,25 +77,27 @@ public:
     CivilianAgentFactory(double maxSpeed = 1.0, double maxAcceleration = 1.0): AgentFactory(),
         m_maxSpeed(maxSpeed), m_maxAcceleration(maxAcceleration) {}
     virtual ~CivilianAgentFactory() {}
+
+    std::string configuration() const override
+    {
+        return "max_speed=" + std::to_string(m_maxSpeed) + " max_acceleration=" + std::to_string(m_maxAcceleration);
+    }
+
     std::list<std::shared_ptr<Agent>> createAgents() override
     {
         std::list<std::shared_ptr<Agent>> agents;
 
-        std::random_device rd{};
-        std::mt19937 gen{rd()};
         std::normal_distribution<> reactionDist{0.4, 0.2};
 
-        double obsDistance = 1.5;
-        size_t sideNbr = 30;
         unsigned int agentIdx = 0;
-        for(size_t m = 0; m < sideNbr; m++)
+        for(size_t m = 0; m < SideNbr; m++)
         {
-            for(size_t n = 0; n < sideNbr; n++)
+            for(size_t n = 0; n < SideNbr; n++)
             {
-                auto h1 = std::shared_ptr<Human>(new Human(agentIdx++, m_maxSpeed, m_maxAcceleration, obsDistance, reactionDist(gen)));
+                auto h1 = std::shared_ptr<Human>(new Human(agentIdx++, m_maxSpeed, m_maxAcceleration, ObsDistance, reactionDist(randomStream())));
                 h1->setPosition(Eigen::Vector2d(0.0, 0.0) + m * Eigen::Vector2d(0.001, 0.0) + n * Eigen::Vector2d(0.0, 0.001) );
 
-                auto behavior = std::shared_ptr<MaintainDistance>(new MaintainDistance(h1->id(), 1, h1, obsDistance));
+                auto behavior = std::shared_ptr<MaintainDistance>(new MaintainDistance(h1->id(), 1, h1, ObsDistance));
                 h1->addObjective(behavior);
 
                 agents.push_back(h1);
@@ -105,6 +107,35 @@ public:
         return agents;
     }
 
+    std::list<std::shared_ptr<Agent>> resetAgents(const std::list<std::shared_ptr<Agent>>& previous) override
+    {
+        if(previous.size() != SideNbr * SideNbr)
+        {
+            return createAgents();
+        }
+
+        // same order and random draws as createAgents
+        std::normal_distribution<> reactionDist{0.4, 0.2};
+
+        auto it = previous.begin();
+        for(size_t m = 0; m < SideNbr; m++)
+        {
+            for(size_t n = 0; n < SideNbr; n++)
+            {
+                auto h1 = std::static_pointer_cast<Human>(*it++);
+                h1->reset();
+                h1->setParameters(m_maxSpeed, m_maxAcceleration, ObsDistance, reactionDist(randomStream()));
+                h1->setPosition(Eigen::Vector2d(0.0, 0.0) + m * Eigen::Vector2d(0.001, 0.0) + n * Eigen::Vector2d(0.0, 0.001) );
+                std::static_pointer_cast<MaintainDistance>(h1->getActiveObjective())->setObservationDistance(ObsDistance);
+            }
+        }
+
+        return previous;
+    }
+
+    static constexpr double ObsDistance = 1.5;
+    static constexpr size_t SideNbr = 30;
+
     double m_maxSpeed;
     double m_maxAcceleration;
 };
@@ -183,6 +214,12 @@ public:
         return s.str();
     }
 
+    ResultValues getResultValues() override
+    {
+        return {{"max_speed", m_maxSpeed}, {"max_acceleration", m_maxAcceleration},
+                {"stress_seconds", m_stressSeconds}, {"sim_time", m_currentTime}};
+    }
+
     double m_stressSeconds;
     double m_currentTime;
     double m_currentStress;
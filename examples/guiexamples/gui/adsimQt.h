@@ -47,6 +47,7 @@ public:
         m_background = swissmap.scaled(1500, 1500, Qt::KeepAspectRatio, Qt::SmoothTransformation);
 
         m_sim = Simulation::createSimulation(4);
+        m_sim->setLogger(m_logger);
         m_sim->setAgentFactory(std::shared_ptr<AirdefenceAgentFactory>(new AirdefenceAgentFactory(500.0, 550.0)));
         m_sim->setEnvironmentFactory(std::shared_ptr<PlaneEnvFactory>(new PlaneEnvFactory()));
 
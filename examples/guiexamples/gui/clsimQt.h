@@ -43,6 +43,7 @@ public:
     void restart() override
     {
         m_sim = Simulation::createSimulation(4);
+        m_sim->setLogger(m_logger);
         m_sim->setAgentFactory(std::shared_ptr<CivilianAgentFactory>(new CivilianAgentFactory()));
         m_sim->setEnvironmentFactory(std::shared_ptr<CLEnvFactory>(new CLEnvFactory()));
 
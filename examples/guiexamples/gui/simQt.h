@@ -63,6 +63,9 @@ protected:
     double m_timeStep;
     std::shared_ptr<Simulation> m_sim;
     std::shared_ptr<SimulationDrawer> m_drawer;
+
+    // log output is written by the logger's thread, the GUI thread does not wait for std out
+    std::shared_ptr<AsyncLogger> m_logger = AsyncLogger::createAsyncLogger();
 };
 
 
@@ -0,0 +1,146 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef ADAPTIVE_SWEEP_H
+#define ADAPTIVE_SWEEP_H
+
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "parameter_sweep.h"
+
+/**
+ * @brief The AdaptiveSweep class samples a parameter space coarse first
+ * and then refines where it matters: A cell of the grid is split in half
+ * along every axis when the metric at its corners differs by more than a
+ * threshold. Like this, transitions in the parameter space are resolved
+ * finely while flat regions stay coarse. A cell with a corner without
+ * metric value, e.g. because its simulation failed, is not refined.
+ */
+class AdaptiveSweep
+{
+
+public:
+
+    static std::shared_ptr<AdaptiveSweep> createAdaptiveSweep();
+
+    /**
+     * Constructor
+     */
+    AdaptiveSweep();
+
+    /**
+     * Destructor
+     */
+    virtual ~AdaptiveSweep();
+
+    /**
+     * Add an axis.
+     * @param name Parameter name.
+     * @param min First value.
+     * @param max Last value.
+     * @param count Number of values of the coarse grid, at least 2.
+     */
+    void addAxis(const std::string& name, double min, double max, size_t count);
+
+    /**
+     * Sets the scenario builder. The index of the point
+     * equals the simulation id. After building, the sweep sets the
+     * scenario key and stream id of the simulation from the point values,
+     * see ParameterSweep::scenarioKey, so that its random streams do not
+     * depend on the order in which points are refined.
+     * @param builder Scenario builder.
+     */
+    void setScenarioBuilder(ParameterSweep::ScenarioBuilder builder);
+
+    /**
+     * Sets when cells are refined.
+     * @param metric Name of the result value deciding about refinement.
+     * @param threshold A cell is refined if the metric at its corners differs by more.
+     * @param maxLevel Maximum number of refinements of a coarse cell.
+     */
+    void setRefinement(const std::string& metric, double threshold, unsigned int maxLevel);
+
+    /**
+     * Sets if simulations stop as soon as Evaluation::isSimulationFinished
+     * returns true, see Parallel::setStopWhenFinished. Default is false.
+     * @param stop Stop finished simulations early.
+     */
+    void setStopWhenFinished(bool stop);
+
+    /**
+     * Runs the sweep: the coarse grid first, then all refinement levels.
+     * Each level is run in parallel.
+     * @param nThreads Number of threads.
+     * @param timeStep Time step in seconds.
+     * @param duration Simulation duration in seconds.
+     * @return Table with the columns point, axis names..., level, result names...
+     * Results named like an axis are left out.
+     */
+    ResultTable run(size_t nThreads, double timeStep, double duration);
+
+    /**
+     * @return Points whose simulation failed in the last run. They are
+     * missing in the table, and their cells are not refined.
+     */
+    const std::vector<ParameterPoint>& failedPoints() const;
+
+private:
+    using LatticePoint = std::vector<uint64_t>;
+
+    struct Axis
+    {
+        std::string name;
+        double min;
+        double max;
+        size_t count;
+    };
+
+    struct Cell
+    {
+        LatticePoint lower;
+        uint64_t span;
+    };
+
+    ParameterPoint parameterPoint(const LatticePoint& lp, size_t index) const;
+    std::vector<LatticePoint> corners(const Cell& cell) const;
+    void runPoints(const std::vector<LatticePoint>& points, unsigned int level, size_t nThreads,
+                   double timeStep, double duration, ResultTable& table);
+
+    std::vector<Axis> m_axes;
+    ParameterSweep::ScenarioBuilder m_builder;
+    std::string m_metric;
+    double m_threshold;
+    unsigned int m_maxLevel;
+    bool m_stopWhenFinished;
+
+    std::set<LatticePoint> m_simulatedPoints;
+    std::map<LatticePoint, double> m_metricValues; // only points with a metric value
+    std::vector<ParameterPoint> m_failedPoints;
+    unsigned int m_nextSimulationId;
+};
+
+#endif // ADAPTIVE_SWEEP_H
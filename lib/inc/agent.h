@@ -193,6 +193,16 @@ public:
      */
     virtual void update(double time);
 
+    /**
+     * Resets the agent for another simulation run, see AgentFactory::resetAgents:
+     * Position, velocity and acceleration are zero, the agent is enabled, the
+     * objectives are reset (Objective::reset) and the random stream is taken
+     * again from the environment. Parameters such as limits and radius are
+     * kept. Sub agents are reset too. Derived agents with further run state
+     * should extend it.
+     */
+    virtual void reset();
+
     /**
      * Perform the actual spatial move of the agent. This
      * function should be called at the end of update.
@@ -248,6 +258,15 @@ public:
                      const std::vector<double>& vecDoubleParam = std::vector<double>(),
                      const std::vector<int>& vecIntParam = std::vector<int>());
 
+    /**
+     * Sends a message with double parameters, stored within the message
+     * if they fit (see Message::InlinePayloadSize).
+     * @param receiverId Receiver agent id
+     * @param subject Message subject.
+     * @param doubleParams Double parameters.
+     */
+    void sendMessage(unsigned int receiverId, Message::Subject subject, std::initializer_list<double> doubleParams);
+
     /**
      * @return Agent disabled or enabled.
      */
@@ -276,6 +295,13 @@ public:
      */
     ObjectiveSP getActiveObjective();
 
+    /**
+     * Get the agent's own random stream. The stream is taken from the
+     * environment on first use and is independent of other agents.
+     * @return Random stream.
+     */
+    RandomStream& randomStream();
+
 protected:
 
     void updateSubAgents(double time);
@@ -301,6 +327,9 @@ protected:
     double m_enabled;
 
     ObjectivePriorityQueue m_objectives;
+
+    RandomStream m_randomStream;
+    bool m_hasRandomStream;
 };
 
 using AgentSP = std::shared_ptr<Agent>;
@@ -328,6 +357,54 @@ public:
         return agents;
     }
 
+    /**
+     * Describes the parameters of the factory on one line, e.g. for the
+     * key of a ResultCache. Overwrite it if the created agents depend on
+     * parameters, otherwise cached results of different parameters mix.
+     * @return Configuration text, empty without parameters.
+     */
+    virtual std::string configuration() const
+    {
+        return "";
+    }
+
+    /**
+     * Provides the agents of another run by resetting the agents of the
+     * previous run in place (see Agent::reset) and applying the parameters
+     * of this factory, instead of creating them again. The previous agents
+     * were created by a factory of the same class. Like createAgents, the
+     * random stream is drawn from. Overwrite it if creating the agents is
+     * expensive; the default creates them again.
+     * @param previous Agents of the previous run, no longer in an environment.
+     * @return Agents.
+     */
+    virtual std::list<std::shared_ptr<Agent>> resetAgents(const std::list<std::shared_ptr<Agent>>& /*previous*/)
+    {
+        return createAgents();
+    }
+
+    /**
+     * Sets the random stream used while creating agents. The
+     * simulation sets it before calling createAgents.
+     * @param stream Random stream.
+     */
+    void setRandomStream(const RandomStream& stream)
+    {
+        m_randomStream = stream;
+    }
+
+    /**
+     * Get the random stream to use in createAgents.
+     * @return Random stream.
+     */
+    RandomStream& randomStream()
+    {
+        return m_randomStream;
+    }
+
+protected:
+    RandomStream m_randomStream;
+
 private:
     unsigned int m_cnt;
 };
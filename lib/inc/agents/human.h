@@ -63,6 +63,25 @@ public:
      */
     void disableReacting(bool disable);
 
+    /**
+     * Sets the parameters of the constructor, e.g. for a reset agent.
+     * @param velocityLimit Maximum speed the human can reach
+     * @param maxAcceleration Maximum acceleration the human can apply
+     * @param obsDistance Outside this distance, the human does not care.
+     * @param reactionTime How long it takes till human performs action.
+     */
+    void setParameters(double velocityLimit, double maxAcceleration, double obsDistance, double reactionTime);
+
+    /**
+     * @return Observation distance.
+     */
+    double observationDistance() const;
+
+    /**
+     * @return Reaction time in s.
+     */
+    double reactionTime() const;
+
     /**
      * Get agent's stress level (0.0 -> 1.0)
      */
@@ -76,6 +95,7 @@ private:
 public: // inherited from Agent
     std::pair<Eigen::Vector2d, Eigen::Vector2d> computeMotion(double time) const override;
     void update(double time) override;
+    void reset() override;
     AgentType type() const override;
     void performMove(double time) override;
 
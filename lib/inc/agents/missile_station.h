@@ -71,6 +71,12 @@ public:
      */
     double detectionRange() const;
 
+    /**
+     * Get the number of missiles not yet fired.
+     * @return Number of missiles.
+     */
+    size_t numberOfMissiles() const;
+
 
 public: // inherited from Agent
     void update(double time) override;
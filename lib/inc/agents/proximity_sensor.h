@@ -76,6 +76,12 @@ public:
      */
     void addIgnoreAgentId(unsigned int agentId);
 
+    /**
+     * Get the ignored agents.
+     * @return Agent ids.
+     */
+    const std::set<unsigned int>& ignoredAgentIds() const;
+
 
 public: // inherited from Agent
     void update(double time) override;
@@ -0,0 +1,175 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <iostream>
+
+#include "message.h"
+
+/**
+ * @brief The AsyncLogger class takes log output off the simulation thread:
+ * Producers push fixed-size records into a lock-free ring buffer, a
+ * background thread formats and writes them to the output stream. Messages
+ * are logged as sender, receiver and subject, so only the background thread
+ * formats them. Texts longer than a record are truncated. If the ring is
+ * full, the overflow policy either drops the record or blocks the producer
+ * till there is space (back-pressure). Any number of threads can log.
+ */
+class AsyncLogger
+{
+
+public:
+
+    /**
+     * What happens when the ring buffer is full.
+     */
+    enum OverflowPolicy
+    {
+        Drop,   // the record is dropped and counted
+        Block   // the producer waits till the writer made space
+    };
+
+    /**
+     * Characters of text per record.
+     */
+    static constexpr size_t MaxTextLength = 200;
+
+    /**
+     * Counters of the logger.
+     */
+    struct Counters
+    {
+        size_t logged;      // records pushed into the ring
+        size_t written;     // records written to the stream
+        size_t dropped;     // records dropped because the ring was full
+        size_t blocked;     // records which had to wait for space
+        size_t truncated;   // texts cut to MaxTextLength
+    };
+
+    static std::shared_ptr<AsyncLogger> createAsyncLogger(std::ostream& out = std::cout, size_t capacity = 4096,
+                                                          OverflowPolicy policy = Drop);
+
+    /**
+     * Constructor, starts the writer thread.
+     * @param out Output stream, must outlive the logger.
+     * @param capacity Number of records in the ring, rounded up to a power of two.
+     * @param policy Overflow policy.
+     */
+    AsyncLogger(std::ostream& out, size_t capacity, OverflowPolicy policy);
+
+    /**
+     * Destructor. Writes all pushed records and stops the writer thread.
+     */
+    virtual ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    /**
+     * Logs a line of text.
+     * @param text Text, cut to MaxTextLength.
+     * @return False if the record was dropped.
+     */
+    bool log(std::string_view text);
+
+    /**
+     * Logs a message, written like Environment logs it: "Message: " + toString().
+     * @param message Message.
+     * @return False if the record was dropped.
+     */
+    bool logMessage(const Message& message);
+
+    /**
+     * Blocks till all records logged so far are written and the stream is flushed.
+     */
+    void flush();
+
+    /**
+     * @return Counters, can be read from any thread.
+     */
+    Counters counters() const;
+
+    /**
+     * @return Number of records in the ring.
+     */
+    size_t capacity() const;
+
+    /**
+     * @return Overflow policy.
+     */
+    OverflowPolicy overflowPolicy() const;
+
+private:
+
+    struct Record
+    {
+        enum Kind : unsigned char
+        {
+            Text,
+            MessageRecord
+        };
+
+        Kind kind;
+        unsigned char length;
+        Message::Subject subject;
+        unsigned int senderId;
+        unsigned int receiverId;
+        char text[MaxTextLength];
+    };
+
+    struct Slot
+    {
+        std::atomic_size_t sequence;
+        Record record;
+    };
+
+    bool push(const Record& record);
+    bool pop(Record& record);
+    void write(const Record& record);
+    void writerLoop();
+
+    std::ostream& m_out;
+    OverflowPolicy m_policy;
+    std::vector<Slot> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic_size_t m_enqueuePos;
+    alignas(64) size_t m_dequeuePos; // writer thread only
+
+    std::atomic_size_t m_logged;
+    std::atomic_size_t m_written;
+    std::atomic_size_t m_dropped;
+    std::atomic_size_t m_blocked;
+    std::atomic_size_t m_truncated;
+
+    std::atomic_bool m_stop;
+    std::thread m_writer;
+};
+
+#endif // ASYNC_LOGGER_H
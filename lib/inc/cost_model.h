@@ -0,0 +1,100 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+
+/**
+ * @brief The CostModel class learns the cost of simulations, e.g. their wall
+ * time, from completed runs and estimates the cost of further runs. A run is
+ * described by features, e.g. the parameter values of a sweep point. The
+ * estimate is the inverse distance weighted mean of the nearest observations,
+ * each feature scaled by its observed range. The observations can be saved,
+ * so that later sweeps of a scenario start with the costs of earlier ones.
+ */
+class CostModel
+{
+
+public:
+
+    static std::shared_ptr<CostModel> createCostModel(size_t nbrOfNeighbours = 4);
+
+    /**
+     * Constructor
+     * @param nbrOfNeighbours Number of observations an estimate is made of.
+     */
+    CostModel(size_t nbrOfNeighbours = 4);
+
+    /**
+     * Adds the cost of a completed run. Can be called from any thread.
+     * @param features Features of the run, same number for all runs.
+     * @param cost Cost, e.g. wall time in seconds.
+     */
+    void addObservation(const std::vector<double>& features, double cost);
+
+    /**
+     * @return Number of observations.
+     */
+    size_t numberOfObservations() const;
+
+    /**
+     * Estimates the cost of a run. Can be called from any thread.
+     * @param features Features of the run.
+     * @return Estimated cost, 0 without observations.
+     */
+    double estimate(const std::vector<double>& features) const;
+
+    /**
+     * Writes the observations to a text file.
+     * @param path File path.
+     * @return False if the file could not be written.
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * Adds the observations of a file written by save.
+     * @param path File path.
+     * @return False if the file could not be read.
+     */
+    bool load(const std::string& path);
+
+private:
+
+    struct Observation
+    {
+        std::vector<double> features;
+        double cost;
+    };
+
+    size_t m_nbrOfNeighbours;
+    std::vector<Observation> m_observations;
+    std::vector<double> m_min; // per feature
+    std::vector<double> m_max;
+    mutable std::mutex m_mutex;
+};
+
+#endif // COST_MODEL_H
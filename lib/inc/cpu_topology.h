@@ -0,0 +1,95 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The CpuTopology class tells which CPUs the process may run on,
+ * how they are grouped into NUMA nodes, and pins threads to CPUs. The
+ * topology is read from /sys on Linux; elsewhere all CPUs form one node
+ * and pinning is not supported.
+ */
+class CpuTopology
+{
+
+public:
+
+    /**
+     * Directory the NUMA nodes are read from.
+     */
+    static constexpr const char* SysNodeDirectory = "/sys/devices/system/node";
+
+    /**
+     * A NUMA node with the CPUs the process may run on.
+     */
+    struct NumaNode
+    {
+        int id;                 // node number of the system
+        std::vector<int> cpus;
+    };
+
+    /**
+     * Get the NUMA nodes the process may run on, ordered by node number.
+     * Nodes without such CPUs are left out. Without NUMA information, all
+     * allowed CPUs form node 0.
+     * @param nodeDirectory Directory with the node<N> entries.
+     * @return Nodes.
+     */
+    static std::vector<NumaNode> numaNodes(const std::string& nodeDirectory = SysNodeDirectory);
+
+    /**
+     * Get the NUMA node of a CPU.
+     * @param cpu CPU number.
+     * @param nodeDirectory Directory with the node<N> entries.
+     * @return Node number of the system, -1 if unknown.
+     */
+    static int nodeOfCpu(int cpu, const std::string& nodeDirectory = SysNodeDirectory);
+
+    /**
+     * Assigns a CPU to each worker. The workers are spread over the NUMA
+     * nodes round robin, and within a node over its CPUs.
+     * @param nWorkers Number of workers.
+     * @return CPU of each worker, empty if unknown.
+     */
+    static std::vector<int> workerCpus(size_t nWorkers);
+
+    /**
+     * Pins the calling thread to a CPU.
+     * @param cpu CPU number.
+     * @return True on success.
+     */
+    static bool pinCurrentThread(int cpu);
+
+    /**
+     * Parses a Linux cpu list, e.g. "0-3,8,10-11".
+     * @param list Cpu list.
+     * @return CPU numbers.
+     */
+    static std::vector<int> parseCpuList(const std::string& list);
+};
+
+#endif // CPU_TOPOLOGY_H
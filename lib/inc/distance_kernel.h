@@ -0,0 +1,84 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef DISTANCE_KERNEL_H
+#define DISTANCE_KERNEL_H
+
+#include <cstddef>
+
+/**
+ * @brief The DistanceKernel class computes blocks of distance vectors
+ * from one position to many positions stored as structure of arrays (SoA).
+ * The instruction set (AVX-512, AVX2, SSE2 or scalar) is chosen at runtime
+ * according to the CPU. All variants give the same results.
+ */
+class DistanceKernel
+{
+
+public:
+
+    enum Isa
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    /**
+     * Detects the best instruction set supported by the running CPU.
+     * @return Instruction set.
+     */
+    static Isa detectIsa();
+
+    /**
+     * Get the instruction set used by computeBlock.
+     * @return Instruction set.
+     */
+    static Isa activeIsa();
+
+    /**
+     * Force an instruction set, e.g. for testing. Instruction sets
+     * not supported by the CPU fall back to the best supported one.
+     * @param isa Instruction set.
+     * @return The instruction set actually used.
+     */
+    static Isa setIsa(Isa isa);
+
+    /**
+     * Compute the distance vectors (x[k] - px, y[k] - py) and their
+     * lengths for n positions.
+     * @param px Origin x.
+     * @param py Origin y.
+     * @param x Array of n x-coordinates.
+     * @param y Array of n y-coordinates.
+     * @param n Number of positions.
+     * @param dx Output array of n distance vector x-components.
+     * @param dy Output array of n distance vector y-components.
+     * @param dist Output array of n distances.
+     */
+    static void computeBlock(double px, double py, const double* x, const double* y, size_t n,
+                             double* dx, double* dy, double* dist);
+};
+
+#endif // DISTANCE_KERNEL_H
@@ -32,6 +32,9 @@
 #include <Eigen/Dense>
 
 #include "environment_interface.h"
+#include "message_arena.h"
+#include "async_logger.h"
+#include "event_log.h"
 #include "agent.h"
 
 /**
@@ -70,7 +73,16 @@ public:
     virtual void update(double time);
 
     /**
-     * Add an agent to the environment.
+     * Resets the environment in place for another simulation run:
+     * All agents, distances, pending messages and message listeners are
+     * removed, but the allocated containers are kept. Derived classes
+     * with further state should extend it.
+     */
+    virtual void reset();
+
+    /**
+     * Add an agent to the environment. A message queue is set
+     * up for the agent and all its sub agents.
      * @param a Agent
      */
     void addAgent(std::shared_ptr<Agent> a);
@@ -118,32 +130,106 @@ public:
      */
     void setEnableLogMessages(bool enable);
 
+    /**
+     * Sets the lowest level written, if log messages are enabled.
+     * Default is LogLevel::Info, the level of log(logMsg) and of messages.
+     * @param level Log level.
+     */
+    void setLogLevel(LogLevel level);
+
+    /**
+     * @return Lowest level written.
+     */
+    LogLevel logLevel() const;
+
+    /**
+     * Sets an asynchronous logger: log() then pushes a record to it and
+     * returns, the logger's thread writes it. Messages are pushed as
+     * sender, receiver and subject without formatting them.
+     * @param logger Logger, nullptr to write std out synchronously.
+     */
+    void setLogger(std::shared_ptr<AsyncLogger> logger);
+
+    /**
+     * Sets a binary event log each sent message and each recorded
+     * event is appended to, independent of the log messages.
+     * @param eventLog Event log, nullptr for none.
+     */
+    void setEventLog(std::shared_ptr<EventLog> eventLog);
+
     /**
      * Add a message listener. Each message will be sent forward to each listener.
      * @param listener Message listener.
      */
     void addMessageListener(std::weak_ptr<MessageListener> listener);
 
+    /**
+     * Sets if messages of the agents are created in the environment's
+     * MessageArena, which is reset at the beginning of each update.
+     * Default is true.
+     * @param use Use the message arena.
+     */
+    void setUseMessageArena(bool use);
+
+    /**
+     * Sets the random service the agent streams are taken from.
+     * @param service Random service.
+     */
+    void setRandomService(std::shared_ptr<RandomService> service);
+
+    /**
+     * Get the random service.
+     * @return Random service.
+     */
+    std::shared_ptr<RandomService> getRandomService() const;
+
 public: //Inherited from EnvironmentInterface
 
     virtual std::pair<bool, Eigen::Vector2d> possibleMove(const Eigen::Vector2d& origin, const Eigen::Vector2d& destination) const override;
     virtual DistanceQueue getAgentDistancesToAllOtherAgents(unsigned int id) override;
     virtual MessageQueue& getMessages(unsigned int receiverAgendId) override;
     virtual void sendMessage(std::shared_ptr<Message> aMessage) override;
+    virtual MessageArena* messageArena() override;
     virtual void log(const std::string &logMsg) override;
+    virtual void log(LogLevel level, const std::string &logMsg) override;
     virtual void log(std::shared_ptr<Message> aMessage) override;
+    virtual bool logEnabled(LogLevel level) const override;
+    virtual void recordEvent(EventKind kind, unsigned int senderId, unsigned int receiverId,
+                             std::initializer_list<double> doubleParams = {}, std::initializer_list<int> intParams = {}) override;
     double distanceToEnvironmentBorder(const Eigen::Vector2d &pos, const Eigen::Vector2d &dir, double stepSize, double maxDist) override;
     std::vector<std::pair<double, Eigen::Vector2d> > circularSamplingDistancesToEnvironmentBorder(const Eigen::Vector2d &pos, unsigned int nbrOfSamples,
                                                                                                   double stepSize, double maxDist) override;
+    RandomStream getRandomStream(unsigned int agentId) override;
 
 protected:
 
+    /**
+     * Logs the message, appends it to the event log and forwards it to
+     * the message listeners.
+     * @param aMessage Message.
+     */
+    void notifyMessage(std::shared_ptr<Message> aMessage);
+
     unsigned int m_id;
     std::list<std::shared_ptr<Agent>> m_agents;
     DistanceMap m_agentDistanceMap;
     MessagesMap m_msgMap;
     bool m_enableLogMessages;
+    LogLevel m_logLevel;
+    std::shared_ptr<AsyncLogger> m_logger;
+    std::shared_ptr<EventLog> m_eventLog;
     std::vector<std::weak_ptr<MessageListener>> m_messageListeners;
+    std::shared_ptr<RandomService> m_randomService;
+    MessageArena m_messageArena;
+    bool m_useMessageArena;
+
+    // SoA buffers of computeDistances, kept to avoid reallocation
+    std::vector<Agent*> m_enabledAgents;
+    std::vector<double> m_posX;
+    std::vector<double> m_posY;
+    std::vector<double> m_distX;
+    std::vector<double> m_distY;
+    std::vector<double> m_dist;
 
 };
 
@@ -167,6 +253,17 @@ public:
         return Environment::createEnvironment(m_cnt++);
     }
 
+    /**
+     * Describes the parameters of the factory on one line, e.g. for the
+     * key of a ResultCache. Overwrite it if the created environment
+     * depends on parameters.
+     * @return Configuration text, empty without parameters.
+     */
+    virtual std::string configuration() const
+    {
+        return "";
+    }
+
 private:
     unsigned int m_cnt;
 };
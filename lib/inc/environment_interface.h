@@ -29,6 +29,12 @@
 #include <Eigen/Dense>
 
 #include "message.h"
+#include "mailbox.h"
+#include "random_stream.h"
+#include "log.h"
+#include "event_log.h"
+
+class MessageArena;
 
 /**
  * @brief The EnvironmentInterface class is an interface the
@@ -85,9 +91,10 @@ public:
     virtual DistanceQueue getAgentDistancesToAllOtherAgents(unsigned int id) = 0;
 
     /**
-     * MessageQueue contains the messages for a specific agent.
+     * MessageQueue contains the messages for a specific agent. Messages
+     * can be sent concurrently, but only the receiver pops them.
      */
-    using MessageQueue = std::queue<std::shared_ptr<Message>>;
+    using MessageQueue = Mailbox;
 
     /**
      * Get the messages for a specific agent. Note: Processing
@@ -103,18 +110,62 @@ public:
      */
     virtual void sendMessage(std::shared_ptr<Message> aMessage) = 0;
 
+    /**
+     * Get the arena messages of this environment should be created in.
+     * @return Message arena, nullptr to create messages in the MessagePool.
+     */
+    virtual MessageArena* messageArena()
+    {
+        return nullptr;
+    }
+
     /**
      * Log a message to the std out.
      * @param logMsg log message.
      */
     virtual void log(const std::string& logMsg) = 0;
 
+    /**
+     * Log a message of a given level. Prefer MafLog::log, which only
+     * formats the message if the level is logged.
+     * @param level Log level.
+     * @param logMsg Log message.
+     */
+    virtual void log(LogLevel /*level*/, const std::string& logMsg)
+    {
+        log(logMsg);
+    }
+
+    /**
+     * Check if a level is logged, before formatting a log message.
+     * @param level Log level.
+     * @return True if messages of the level are written.
+     */
+    virtual bool logEnabled(LogLevel level) const
+    {
+        return MafLog::compiledIn(level);
+    }
+
     /**
      * Log a message to the std out.
      * @param aMessage Message type
      */
     virtual void log(std::shared_ptr<Message> aMessage) = 0;
 
+    /**
+     * Record an agent event, such as a missile fired or detonated, in the
+     * event log of the environment, if it has one. May be called concurrently.
+     * @param kind Event kind.
+     * @param senderId Agent causing the event.
+     * @param receiverId Agent affected by the event.
+     * @param doubleParams Double parameters.
+     * @param intParams Int parameters.
+     */
+    virtual void recordEvent(EventKind /*kind*/, unsigned int /*senderId*/, unsigned int /*receiverId*/,
+                             std::initializer_list<double> /*doubleParams*/ = {}, std::initializer_list<int> /*intParams*/ = {})
+    {
+    }
+
     /**
      * Compute the distance from a given position into a given direction
      * till the border of the environment is reached.
@@ -137,6 +188,14 @@ public:
      */
     virtual std::vector<std::pair<double, Eigen::Vector2d>> circularSamplingDistancesToEnvironmentBorder(const Eigen::Vector2d& pos,
                                                               unsigned int nbrOfSamples, double stepSize, double maxDist) = 0;
+
+    /**
+     * Get the random stream of a specific agent. The stream only depends
+     * on the simulation's seed and the agent id.
+     * @param agentId Agent id.
+     * @return Random stream at its beginning.
+     */
+    virtual RandomStream getRandomStream(unsigned int agentId) = 0;
 };
 
 #endif // ENVIRONMENTINTERFACE_H
@@ -26,6 +26,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 class Simulation;
 
@@ -62,6 +63,18 @@ public:
      */
     virtual std::string getResult();
 
+    /**
+     * Named result values, e.g. to be written by a ResultSink.
+     */
+    using ResultValues = std::vector<std::pair<std::string, double>>;
+
+    /**
+     * Get the result as named values. The names and their order
+     * should not depend on the simulation run. Empty by default.
+     * @return Result values.
+     */
+    virtual ResultValues getResultValues();
+
     /**
      * This function evaluates if the simulation
      * is finished. Needs to be overwritten.
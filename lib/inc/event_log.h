@@ -0,0 +1,257 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <initializer_list>
+
+#include "message.h"
+
+/**
+ * @brief The EventKind enum holds the kinds of events of an EventLog.
+ */
+enum class EventKind : uint16_t
+{
+    MessageEvent,   // a message was sent, with its subject and payload
+    Fire,           // a missile station fired: station, target, station position, missile id
+    Detonation      // a missile detonated: missile, target, missile position
+};
+
+/**
+ * @brief The EventLog class appends the events of one simulation to a
+ * binary file: the sent messages, and agent events such as fire and
+ * detonation (see EnvironmentInterface::recordEvent). The file is a header
+ * (magic "MAFE", version) followed by one record per event. A record is a
+ * fixed EventLog::Record followed by its double parameters, int parameters
+ * and text, padded to 8 bytes, so that EventLogReader can access records in
+ * place. All numbers are stored in native byte order.
+ */
+class EventLog
+{
+
+public:
+
+    /**
+     * Fixed part of a record as stored in the file.
+     */
+    struct Record
+    {
+        uint32_t size;        // bytes of the record including payload and padding
+        uint16_t kind;        // EventKind
+        uint16_t subject;     // Message::Subject of message events
+        double time;          // simulation running time in s
+        uint32_t senderId;
+        uint32_t receiverId;
+        uint16_t nbrOfDoubles;
+        uint16_t nbrOfInts;
+        uint32_t textLength;
+    };
+
+    static std::shared_ptr<EventLog> createEventLog(const std::string& path);
+
+    /**
+     * Constructor
+     * @param path Path of the event log. An existing file is overwritten.
+     */
+    EventLog(const std::string& path);
+
+    /**
+     * @return True if the file could be opened.
+     */
+    bool isOpen() const;
+
+    /**
+     * Sets the time stamp of the following events.
+     * @param time Simulation running time in s.
+     */
+    void setTime(double time);
+
+    /**
+     * Appends a message as event. May be called concurrently.
+     * @param aMessage Message.
+     */
+    void append(const Message& aMessage);
+
+    /**
+     * Appends an agent event. May be called concurrently.
+     * @param kind Event kind.
+     * @param senderId Agent causing the event.
+     * @param receiverId Agent affected by the event.
+     * @param doubleParams Double parameters.
+     * @param intParams Int parameters.
+     */
+    void appendEvent(EventKind kind, unsigned int senderId, unsigned int receiverId,
+                     std::initializer_list<double> doubleParams = {}, std::initializer_list<int> intParams = {});
+
+    /**
+     * @return Number of events appended.
+     */
+    size_t numberOfEvents() const;
+
+    /**
+     * Writes buffered events to the file.
+     */
+    void flush();
+
+private:
+    void writeRecord(Record r, const double* doubles, const int32_t* ints, std::string_view text);
+
+    std::ofstream m_file;
+    mutable std::mutex m_mutex;
+    double m_time;
+    size_t m_nbrOfEvents;
+};
+
+/**
+ * @brief The EventLogReader class memory maps a file written by EventLog and
+ * iterates its events in place, without copying or parsing them. Where
+ * memory mapping is not available, the file is read into memory. An
+ * incomplete last record, e.g. of a crashed run, is ignored, as is
+ * everything from a record whose payload does not fit its size.
+ */
+class EventLogReader
+{
+
+public:
+
+    /**
+     * @brief The Event class is a view of one record in the mapped file,
+     * valid as long as the reader.
+     */
+    class Event
+    {
+    public:
+        Event(const unsigned char* record) : m_record(record) {}
+
+        double time() const;
+        EventKind kind() const;
+        unsigned int senderId() const;
+        unsigned int receiverId() const;
+        /**
+         * @return Subject, only meaningful for EventKind::MessageEvent.
+         */
+        Message::Subject subject() const;
+
+        size_t numberOfDoubleParams() const;
+
+        /**
+         * @param index Index, smaller than numberOfDoubleParams().
+         * @return Double parameter.
+         */
+        double doubleParam(size_t index) const;
+
+        size_t numberOfIntParams() const;
+
+        /**
+         * @param index Index, smaller than numberOfIntParams().
+         * @return Int parameter.
+         */
+        int intParam(size_t index) const;
+
+        /**
+         * @return Text parameter, pointing into the mapped file.
+         */
+        std::string_view textView() const;
+
+        /**
+         * @return Bytes of the record, distance to the next one.
+         */
+        size_t recordSize() const;
+
+    private:
+        EventLog::Record header() const;
+
+        const unsigned char* m_record;
+    };
+
+    /**
+     * @brief Forward iterator over the events.
+     */
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Event;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Event*;
+        using reference = Event;
+
+        Iterator(const unsigned char* pos) : m_pos(pos) {}
+
+        Event operator*() const { return Event(m_pos); }
+        Iterator& operator++() { m_pos += Event(m_pos).recordSize(); return *this; }
+        Iterator operator++(int) { Iterator it = *this; ++(*this); return it; }
+        bool operator==(const Iterator& other) const { return m_pos == other.m_pos; }
+        bool operator!=(const Iterator& other) const { return m_pos != other.m_pos; }
+
+    private:
+        const unsigned char* m_pos;
+    };
+
+    static std::shared_ptr<EventLogReader> createEventLogReader(const std::string& path);
+
+    /**
+     * Constructor, maps or reads the file.
+     * @param path Path of an event log.
+     */
+    EventLogReader(const std::string& path);
+
+    /**
+     * Destructor, unmaps or releases the file.
+     */
+    ~EventLogReader();
+
+    EventLogReader(const EventLogReader&) = delete;
+    EventLogReader& operator=(const EventLogReader&) = delete;
+
+    /**
+     * @return True if the file is mapped and has a valid header.
+     */
+    bool isOpen() const;
+
+    /**
+     * @return Number of complete events.
+     */
+    size_t numberOfEvents() const;
+
+    Iterator begin() const;
+    Iterator end() const;
+
+private:
+    void* m_map;
+    size_t m_mapSize;
+    std::vector<unsigned char> m_buffer; // file contents where it cannot be mapped
+    const unsigned char* m_begin;
+    const unsigned char* m_end;
+    size_t m_nbrOfEvents;
+};
+
+#endif // EVENT_LOG_H
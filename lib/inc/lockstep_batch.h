@@ -0,0 +1,304 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef LOCKSTEP_BATCH_H
+#define LOCKSTEP_BATCH_H
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <Eigen/Dense>
+
+#include "simulation.h"
+#include "evaluation.h"
+
+class LockstepBatch;
+
+/**
+ * @brief The BatchEvaluation class evaluates the runs of a LockstepBatch,
+ * like Evaluation does for a single Simulation.
+ */
+class BatchEvaluation
+{
+
+public:
+
+    /**
+     * Destructor
+     */
+    virtual ~BatchEvaluation() {}
+
+    /**
+     * Called for each active run after each time step.
+     * @param batch Batch.
+     * @param run Run index.
+     * @param timeStep Time step in seconds.
+     */
+    virtual void evaluate(const LockstepBatch& /*batch*/, size_t /*run*/, double /*timeStep*/) {}
+
+    /**
+     * Checks before each time step if a run finished, see runUntilFinished.
+     * @param batch Batch.
+     * @param run Run index.
+     * @return True if finished.
+     */
+    virtual bool isRunFinished(const LockstepBatch& /*batch*/, size_t /*run*/) { return false; }
+
+    /**
+     * Get the result of a run as named values.
+     * @param batch Batch.
+     * @param run Run index.
+     * @return Result values.
+     */
+    virtual Evaluation::ResultValues getResultValues(const LockstepBatch& /*batch*/, size_t /*run*/) { return {}; }
+};
+
+/**
+ * @brief The LockstepBatch class steps many runs of one scenario at the same
+ * time. The runs have the same agents (ids, classes, sensors, missiles) and
+ * only differ in their parameters, like speeds and ranges. The state is
+ * stored as [agent][run] arrays, so that kinematics and sensor distances are
+ * computed for all runs of an agent in one loop. Decisions which differ per
+ * run, like which missile fires at whom, are taken per run.
+ *
+ * Supported are the agent classes Agent, Plane, HostilePlane, ProximitySensor,
+ * Target and MissileStation with its sensor and missiles, as created by the
+ * agent factory, without objectives. The step reproduces the update order of
+ * Environment::update, including that a disable message only takes effect
+ * when the receiver updates. Agents move in open space: possibleMove of the
+ * environment is not consulted and log messages are not written.
+ */
+class LockstepBatch
+{
+
+public:
+
+    static constexpr size_t NoAgent = static_cast<size_t>(-1);
+
+    static std::shared_ptr<LockstepBatch> createLockstepBatch();
+
+    /**
+     * Constructor
+     */
+    LockstepBatch();
+
+    /**
+     * Adds a run. Its agents are created by the agent factory of the
+     * simulation, with the factory random stream of the simulation.
+     * The environment factory and evaluation of the simulation are not used.
+     * Note: Add all runs before the first step.
+     * @param sim Simulation, only providing its configuration.
+     * @return False if an agent class is not supported or the agents
+     * differ from the ones of the first run; the run is not added then.
+     */
+    bool addRun(std::shared_ptr<Simulation> sim);
+
+    /**
+     * Sets the evaluation of the runs.
+     * @param evaluation Batch evaluation.
+     */
+    void setEvaluation(std::shared_ptr<BatchEvaluation> evaluation);
+
+    /**
+     * @return Batch evaluation.
+     */
+    std::shared_ptr<BatchEvaluation> getEvaluation() const;
+
+    /**
+     * Steps all runs whose running time is below the duration.
+     * @param timeStep Time step in seconds.
+     * @param duration Simulation time in seconds.
+     */
+    void run(double timeStep, double duration);
+
+    /**
+     * Steps each run until BatchEvaluation::isRunFinished returns true for
+     * it or the maximum duration is reached, see Simulation::runSimulationUntilFinished.
+     * Finished runs are not stepped anymore.
+     * @param timeStep Time step in seconds.
+     * @param maxDuration Maximum simulation time in seconds.
+     */
+    void runUntilFinished(double timeStep, double maxDuration);
+
+    /**
+     * @return Number of runs.
+     */
+    size_t numberOfRuns() const;
+
+    /**
+     * @return Number of agents per run, sub agents included.
+     */
+    size_t numberOfAgents() const;
+
+    /**
+     * Get the index of an agent, the same in each run.
+     * @param agentId Agent id.
+     * @return Agent index, or NoAgent.
+     */
+    size_t agentIndex(unsigned int agentId) const;
+
+    /**
+     * @param agent Agent index.
+     * @return Agent id.
+     */
+    unsigned int agentId(size_t agent) const;
+
+    /**
+     * @param agent Agent index.
+     * @return Agent type.
+     */
+    AgentType agentType(size_t agent) const;
+
+    /**
+     * @param agent Agent index.
+     * @param run Run index.
+     * @return True if the agent is enabled, see Agent::getEnabled.
+     */
+    bool enabled(size_t agent, size_t run) const;
+
+    /**
+     * @param agent Agent index.
+     * @param run Run index.
+     * @return Position in m.
+     */
+    Eigen::Vector2d position(size_t agent, size_t run) const;
+
+    /**
+     * @param agent Agent index.
+     * @param run Run index.
+     * @return Velocity in m/s.
+     */
+    Eigen::Vector2d velocity(size_t agent, size_t run) const;
+
+    /**
+     * Get the agents in range of a sensor in the last step, see
+     * ProximitySensor::getAgentsInSensorRange.
+     * @param agent Agent index of a ProximitySensor or Target.
+     * @param run Run index.
+     * @return Agents ordered in increasing distance.
+     */
+    const std::vector<EnvironmentInterface::Distance>& agentsInSensorRange(size_t agent, size_t run) const;
+
+    /**
+     * @param run Run index.
+     * @return Simulation id of the run.
+     */
+    unsigned int simulationId(size_t run) const;
+
+    /**
+     * @param run Run index.
+     * @return Running time of the run in seconds.
+     */
+    double runningTime(size_t run) const;
+
+private:
+
+    enum Kind
+    {
+        Mover,      // Agent, Plane, HostilePlane
+        Sensor,     // ProximitySensor, Target
+        Station,    // MissileStation
+        Rocket      // Missile
+    };
+
+    enum Message
+    {
+        NoMessage,
+        DisableMessage
+    };
+
+    struct AgentSlot
+    {
+        unsigned int id;
+        AgentType type;
+        Kind kind;
+        size_t kindIndex;   // index of the sensor, station or missile
+    };
+
+    struct StationSlot
+    {
+        size_t sensor;                  // agent index of the sensor
+        std::vector<size_t> missiles;   // agent indices, in firing order
+    };
+
+    bool describeAgents(const std::list<std::shared_ptr<Agent>>& agents, std::vector<AgentSlot>& slots,
+                        std::vector<std::shared_ptr<Agent>>& flat) const;
+    void build();
+    size_t at(size_t agent, size_t run) const;
+
+    void step(double timeStep);
+    void senseAll();
+    void move(size_t idx, double timeStep);
+    void updateMover(size_t agent, double timeStep);
+    void updateMissile(size_t agent, double timeStep);
+    void updateStation(size_t agent);
+
+    std::shared_ptr<BatchEvaluation> m_evaluation;
+
+    // structure, equal for all runs
+    std::vector<AgentSlot> m_agents;
+    std::unordered_map<unsigned int, size_t> m_agentIndex;
+    std::vector<std::pair<size_t, bool>> m_updateOrder; // agent index, station firing instead of agent update
+    std::vector<size_t> m_sensors;                      // agent indices
+    std::vector<std::vector<bool>> m_ignored;           // per sensor, per agent
+    std::vector<StationSlot> m_stations;
+    std::vector<size_t> m_missiles;                     // agent indices
+
+    // per run
+    std::vector<unsigned int> m_simulationIds;
+    std::vector<double> m_runningTime;
+    std::vector<char> m_active;
+    std::vector<char> m_finished;
+
+    // state as [agent][run] arrays, see at()
+    size_t m_nRuns;
+    bool m_started;
+    std::vector<std::vector<std::shared_ptr<Agent>>> m_runAgents; // agents of the runs, till the first step
+    std::vector<double> m_posX, m_posY;
+    std::vector<double> m_velX, m_velY;
+    std::vector<double> m_accX, m_accY;
+    std::vector<double> m_maxSpeed;
+    std::vector<char> m_enabled;
+    std::vector<char> m_inDistanceMap;  // enabled at the beginning of the step
+    std::vector<double> m_startX, m_startY; // positions at the beginning of the step
+    std::vector<char> m_message;
+
+    // [sensor][run]
+    std::vector<double> m_range;
+    std::vector<std::vector<EnvironmentInterface::Distance>> m_inRange;
+
+    // [missile][run]
+    std::vector<char> m_missileStatus;
+    std::vector<size_t> m_missileTarget;
+    std::vector<double> m_targetBeforeX, m_targetBeforeY;
+    std::vector<char> m_targetBeforeAvailable;
+
+    // [station][agent][run] and [station][run]
+    std::vector<char> m_targeted;
+    std::vector<size_t> m_nextMissile;
+
+    // scratch of the sensor distances, per run
+    std::vector<double> m_dx, m_dy, m_dist;
+};
+
+#endif // LOCKSTEP_BATCH_H
@@ -0,0 +1,114 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#ifndef LOG_H
+#define LOG_H
+
+#include <sstream>
+#include <string>
+
+/**
+ * Log levels below this one are removed at compile time, e.g. with
+ * -DMAF_MIN_LOG_LEVEL=4 no log output is compiled in at all. Values are
+ * those of LogLevel: 0 Debug, 1 Info, 2 Warning, 3 Error, 4 Off.
+ */
+#ifndef MAF_MIN_LOG_LEVEL
+#define MAF_MIN_LOG_LEVEL 0
+#endif
+
+/**
+ * @brief The LogLevel enum holds the severities of log output.
+ */
+enum class LogLevel
+{
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+class MafLog
+{
+public:
+
+    /**
+     * Lowest level compiled in.
+     */
+    static constexpr LogLevel MinLevel = static_cast<LogLevel>(MAF_MIN_LOG_LEVEL);
+
+    /**
+     * Check if a level is compiled in.
+     * @param level Level.
+     * @return True if output of the level can be enabled at run time.
+     */
+    static constexpr bool compiledIn(LogLevel level)
+    {
+        return level >= MinLevel && level != LogLevel::Off;
+    }
+
+    /**
+     * Get the name of a level.
+     * @param level Level.
+     * @return Name, e.g. "Info".
+     */
+    static const char* levelName(LogLevel level)
+    {
+        switch(level)
+        {
+        case LogLevel::Debug:
+            return "Debug";
+        case LogLevel::Info:
+            return "Info";
+        case LogLevel::Warning:
+            return "Warning";
+        case LogLevel::Error:
+            return "Error";
+        default:
+            return "Off";
+        }
+    }
+
+    /**
+     * Logs lazily: The formatter writes the log text to a stream, but it is
+     * only called if the environment logs the level. Below MinLevel, the
+     * call compiles to nothing. Example:
+     * MafLog::log<LogLevel::Info>(*env, [&](std::ostream& s) { s << "FIRE: from " << id(); });
+     * @param env Environment, see EnvironmentInterface::logEnabled.
+     * @param format Formatter, called with a std::ostream&.
+     */
+    template<LogLevel Level, class Env, class Formatter>
+    static void log(Env& env, Formatter&& format)
+    {
+        if constexpr(compiledIn(Level))
+        {
+            if(env.logEnabled(Level))
+            {
+                std::ostringstream s;
+                format(static_cast<std::ostream&>(s));
+                env.log(Level, s.str());
+            }
+        }
+    }
+};
+
+#endif // LOG_H
@@ -0,0 +1,121 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef LOOKAHEAD_ENVIRONMENT_H
+#define LOOKAHEAD_ENVIRONMENT_H
+
+#include "tiled_environment.h"
+
+/**
+ * @brief The LookaheadEnvironment class is a conservative parallel engine.
+ * A call to update(window) advances the environment by a whole window. At its
+ * start, the agents are grouped into logical processes: two top level agents
+ * (incl. their sub agents) are put into the same logical process, if they
+ * could come closer than the interaction range within the window, given their
+ * current positions and speed bounds. Logical processes can therefore not
+ * interact during the window and are advanced independently on several
+ * threads, each with its own time steps.
+ *
+ * Notes:
+ *  - The interaction range must cover all distances at which agents react
+ *    to each other (observation distance, sensor range, pursued targets).
+ *  - The speed bound of an agent is min(velocity limit, speed + acceleration
+ *    limit * window). Agents without limits are merged with all others,
+ *    so give agents which do not move, e.g. missile stations with their
+ *    sensors, a zero velocity limit when creating the scenario.
+ *  - Messages within a logical process are delivered right away, messages
+ *    between logical processes at the end of the window.
+ * The results match the time-stepped Environment with the same time step,
+ * apart from message delivery timing between logical processes.
+ */
+class LookaheadEnvironment: public TiledEnvironment
+{
+
+public:
+
+    static std::shared_ptr<LookaheadEnvironment> createLookaheadEnvironment(unsigned int id, double timeStep,
+                                                                            double interactionRange, size_t nThreads);
+
+    /**
+     * Constructor
+     * @param id Environment id.
+     * @param timeStep Time step used within a window in s.
+     * @param interactionRange Max. distance at which agents interact in m.
+     * @param nThreads Number of worker threads.
+     */
+    LookaheadEnvironment(unsigned int id, double timeStep, double interactionRange, size_t nThreads);
+
+    /**
+     * Destructor
+     */
+    virtual ~LookaheadEnvironment();
+
+    /**
+     * @return Time step within a window in s.
+     */
+    double timeStep() const;
+
+    /**
+     * @return Interaction range in m.
+     */
+    double interactionRange() const;
+
+    /**
+     * @return Number of logical processes of the last window.
+     */
+    size_t numberOfLogicalProcesses() const;
+
+    /**
+     * Groups the agents into logical processes which cannot
+     * interact within the given window.
+     * @param window Window duration in s.
+     */
+    void buildLogicalProcesses(double window);
+
+    /**
+     * Max. speed an agent can reach within a given time.
+     * @param a Agent.
+     * @param window Time in s.
+     * @return Speed bound in m/s.
+     */
+    static double speedBound(const Agent& a, double window);
+
+public: // inherited from Environment
+    /**
+     * Advance all logical processes by a window.
+     * @param window Window duration in s.
+     */
+    void update(double window) override;
+    void reset() override;
+
+protected:
+    void computeProcessDistances(size_t lpIdx);
+    bool deliverImmediately(const Message& aMessage) const override;
+
+    double m_timeStep;
+    double m_interactionRange;
+    std::vector<std::vector<Agent*>> m_lpMembers;
+    std::unordered_map<unsigned int, size_t> m_lpOfAgent;
+};
+
+#endif // LOOKAHEAD_ENVIRONMENT_H
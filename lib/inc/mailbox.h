@@ -0,0 +1,100 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <memory>
+#include <atomic>
+
+#include "message.h"
+
+/**
+ * @brief The Mailbox class is a lock-free multi-producer single-consumer
+ * message queue. Any number of threads can push messages concurrently, while
+ * only the owner of the mailbox (the receiving agent) reads and pops them.
+ * A push is a single atomic exchange, so senders never block each other.
+ * Note: A message being pushed concurrently becomes visible to the reader
+ * as soon as its sender has finished push().
+ */
+class Mailbox
+{
+
+public:
+
+    /**
+     * Constructor
+     */
+    Mailbox();
+
+    /**
+     * Destructor
+     */
+    virtual ~Mailbox();
+
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    /**
+     * Add a message. Can be called from multiple threads.
+     * @param aMessage Message.
+     */
+    void push(std::shared_ptr<Message> aMessage);
+
+    /**
+     * Get the oldest message. Only call when not empty.
+     * Consumer only.
+     * @return Message.
+     */
+    std::shared_ptr<Message> front() const;
+
+    /**
+     * Remove the oldest message. Consumer only.
+     */
+    void pop();
+
+    /**
+     * @return True if there is no message. Consumer only.
+     */
+    bool empty() const;
+
+    /**
+     * @return Number of messages. While messages are pushed concurrently,
+     * it may include messages which are not yet visible to pop().
+     */
+    size_t size() const;
+
+private:
+
+    struct Node
+    {
+        std::shared_ptr<Message> message;
+        std::atomic<Node*> next;
+    };
+
+    std::atomic<Node*> m_head; // producers append here
+    Node* m_tail; // consumer reads here, always a consumed or stub node
+    std::atomic_size_t m_size;
+};
+
+#endif // MAILBOX_H
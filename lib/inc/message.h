@@ -25,13 +25,20 @@
 #define MESSAGE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <initializer_list>
 #include <Eigen/Dense>
 
+#include "message_pool.h"
+
 /**
  * @brief This class is a message sent from
- * one agent to another.
+ * one agent to another. Small payloads (text, doubles and ints together
+ * up to InlinePayloadSize bytes) are stored within the message, larger
+ * ones on the heap. Create messages with createMessage, which takes them
+ * from the MessagePool, so that sending does not allocate.
  */
 class Message
 {
@@ -46,15 +53,74 @@ public:
         Hit
     };
 
-    Message(unsigned int senderId, unsigned int receiverId, Subject subject, const std::string& textParam = "",
+    /**
+     * Bytes of payload stored within the message.
+     */
+    static constexpr size_t InlinePayloadSize = 40;
+
+    /**
+     * Constructor of a message without payload.
+     * @param senderId Sender agent's ID.
+     * @param receiverId Receiver agent's ID.
+     * @param subject Subject.
+     */
+    Message(unsigned int senderId, unsigned int receiverId, Subject subject);
+
+    /**
+     * Constructor of a message with double parameters.
+     * @param senderId Sender agent's ID.
+     * @param receiverId Receiver agent's ID.
+     * @param subject Subject.
+     * @param doubleParams Double parameters.
+     */
+    Message(unsigned int senderId, unsigned int receiverId, Subject subject, std::initializer_list<double> doubleParams);
+
+    /**
+     * Constructor of a message with text, double and int parameters.
+     * @param senderId Sender agent's ID.
+     * @param receiverId Receiver agent's ID.
+     * @param subject Subject.
+     * @param textParam Text parameter.
+     * @param vecDoubleParam Double parameters.
+     * @param vecIntParam Int parameters.
+     */
+    Message(unsigned int senderId, unsigned int receiverId, Subject subject, const std::string& textParam,
             const std::vector<double>& vecDoubleParam = std::vector<double>(),
             const std::vector<int>& vecIntParam = std::vector<int>());
 
+    /**
+     * Copy constructor, copies the payload.
+     */
+    Message(const Message& other);
+    Message& operator=(const Message& other);
+
     /**
      * Destructor
      */
     virtual ~Message();
 
+    /**
+     * Creates a message from the MessagePool. The arguments are those of
+     * the constructors.
+     * @return Message.
+     */
+    template<class... Args>
+    static std::shared_ptr<Message> createMessage(Args&&... args);
+
+    /**
+     * Creates a message with double parameters from the MessagePool.
+     * @return Message.
+     */
+    static std::shared_ptr<Message> createMessage(unsigned int senderId, unsigned int receiverId, Subject subject,
+                                                  std::initializer_list<double> doubleParams);
+
+    /**
+     * Copies the message into the MessagePool, e.g. to keep a message
+     * allocated in a MessageArena beyond the step.
+     * @return Copy of the message.
+     */
+    std::shared_ptr<Message> clone() const;
+
     /**
      * @return Sender agent's ID.
      */
@@ -80,6 +146,40 @@ public:
      */
     std::vector<int> intVecParam() const;
 
+    /**
+     * @return Text parameter without copy, valid as long as the message.
+     */
+    std::string_view textView() const;
+
+    /**
+     * @return Number of double parameters.
+     */
+    size_t numberOfDoubleParams() const;
+
+    /**
+     * Get a double parameter without copying the vector.
+     * @param index Index, smaller than numberOfDoubleParams().
+     * @return Value.
+     */
+    double doubleParam(size_t index) const;
+
+    /**
+     * @return Number of int parameters.
+     */
+    size_t numberOfIntParams() const;
+
+    /**
+     * Get an int parameter without copying the vector.
+     * @param index Index, smaller than numberOfIntParams().
+     * @return Value.
+     */
+    int intParam(size_t index) const;
+
+    /**
+     * @return True if the payload is stored within the message.
+     */
+    bool hasInlinePayload() const;
+
     /**
      * @return Subject of the message.
      */
@@ -92,15 +192,46 @@ public:
 
 protected:
 
+    /**
+     * Payload which does not fit into the message.
+     */
+    struct ExtendedPayload
+    {
+        std::string text;
+        std::vector<double> doubles;
+        std::vector<int> ints;
+    };
+
+    void setPayload(const char* text, size_t textLength, const double* doubles, size_t nDoubles,
+                    const int* ints, size_t nInts);
+    const double* inlineDoubles() const;
+    const int* inlineInts() const;
+    const char* inlineText() const;
+
     unsigned int m_senderId;
     unsigned int m_receiverId;
     Subject m_subject;
-    std::string m_textParam;
-    std::vector<double> m_doubleVecParam;
-    std::vector<int> m_intVecParam;
+
+    // inline payload: doubles, then ints, then text
+    unsigned char m_nbrOfDoubles;
+    unsigned char m_nbrOfInts;
+    unsigned char m_textLength;
+    alignas(double) unsigned char m_payload[InlinePayloadSize];
+    std::unique_ptr<ExtendedPayload> m_extended; // nullptr if inline
 };
 
+template<class... Args>
+std::shared_ptr<Message> Message::createMessage(Args&&... args)
+{
+    return std::allocate_shared<Message>(MessagePoolAllocator<Message>(), std::forward<Args>(args)...);
+}
+
 
+/**
+ * @brief The MessageListener class is notified about every sent message.
+ * Messages of an environment live in its MessageArena: a listener keeping
+ * a message beyond messageReceived should keep message->clone() instead.
+ */
 class MessageListener
 {
 public:
@@ -0,0 +1,172 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#ifndef MESSAGE_ARENA_H
+#define MESSAGE_ARENA_H
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "message.h"
+
+/**
+ * @brief The MessageArena class allocates the messages of an environment
+ * from large chunks by bumping an offset. Messages are not freed one by one:
+ * a chunk is reset wholesale once all its messages were released, i.e.
+ * delivered and popped by their receivers. The environment resets the arena
+ * at the beginning of each step, so that the memory of the delivered
+ * messages is reused by the next step. A message that is kept longer, e.g.
+ * by a message listener, stays valid but pins its whole chunk; listeners
+ * keeping messages should copy them with Message::clone.
+ * Messages can be created from multiple threads concurrently.
+ */
+class MessageArena
+{
+
+public:
+
+    /**
+     * Size and alignment of a chunk in bytes.
+     */
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    /**
+     * Constructor
+     */
+    MessageArena();
+
+    /**
+     * Destructor. Chunks with messages still in use are freed with their last message.
+     */
+    virtual ~MessageArena();
+
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    /**
+     * Creates a message in the arena. The arguments are those of the
+     * Message constructors. Can be called from multiple threads.
+     * @return Message.
+     */
+    template<class... Args>
+    std::shared_ptr<Message> createMessage(Args&&... args);
+
+    /**
+     * Creates a message with double parameters in the arena.
+     * @return Message.
+     */
+    std::shared_ptr<Message> createMessage(unsigned int senderId, unsigned int receiverId, Message::Subject subject,
+                                           std::initializer_list<double> doubleParams);
+
+    /**
+     * Resets the current chunk to its beginning if all its messages were
+     * released. Do not call it while messages are created concurrently.
+     */
+    void reset();
+
+    /**
+     * @return Number of chunks allocated by the arena.
+     */
+    size_t numberOfChunks() const;
+
+    /**
+     * Get memory from the arena, used by ArenaAllocator.
+     * @param size Size in bytes, at most a chunk without its header.
+     * @return Block, aligned for any fundamental type.
+     */
+    void* allocate(size_t size);
+
+    /**
+     * Return memory of the arena, used by ArenaAllocator. The memory
+     * is only reused when its whole chunk is reset.
+     * @param block Block from allocate.
+     */
+    static void deallocate(void* block);
+
+    /**
+     * @brief The ArenaAllocator class is a standard allocator taking single
+     * objects from a MessageArena, e.g. for std::allocate_shared.
+     */
+    template<class T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        ArenaAllocator(MessageArena* arena) noexcept : m_arena(arena) {}
+
+        template<class U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.m_arena) {}
+
+        T* allocate(size_t n)
+        {
+            return static_cast<T*>(n == 1 ? m_arena->allocate(sizeof(T)) : ::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t n) noexcept
+        {
+            if(n == 1)
+            {
+                MessageArena::deallocate(p);
+            }
+            else
+            {
+                ::operator delete(p);
+            }
+        }
+
+        template<class U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept
+        {
+            return m_arena == other.m_arena;
+        }
+
+        template<class U>
+        bool operator!=(const ArenaAllocator<U>& other) const noexcept
+        {
+            return m_arena != other.m_arena;
+        }
+
+        MessageArena* m_arena;
+    };
+
+private:
+
+    struct Chunk;
+
+    bool tryAllocate(Chunk* chunk, size_t size, void*& block);
+    Chunk* nextChunk(Chunk* full);
+
+    std::atomic<Chunk*> m_current;
+    std::vector<Chunk*> m_chunks;
+    mutable std::mutex m_mutex;
+};
+
+template<class... Args>
+std::shared_ptr<Message> MessageArena::createMessage(Args&&... args)
+{
+    return std::allocate_shared<Message>(ArenaAllocator<Message>(this), std::forward<Args>(args)...);
+}
+
+#endif // MESSAGE_ARENA_H
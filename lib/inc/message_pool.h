@@ -0,0 +1,119 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#ifndef MESSAGE_POOL_H
+#define MESSAGE_POOL_H
+
+#include <cstddef>
+#include <new>
+
+/**
+ * @brief The MessagePool class recycles small memory blocks, so that sending
+ * a message does not call the global allocator once the pool is warm. Each
+ * thread keeps its own free lists, one per size class, so that allocating
+ * and freeing never locks. A block freed by another thread than the one
+ * that allocated it joins the free list of the freeing thread. Each free
+ * list is capped; blocks beyond are returned to the global allocator.
+ */
+class MessagePool
+{
+
+public:
+
+    /**
+     * Largest block size served by the pool, larger blocks use the global allocator.
+     */
+    static constexpr size_t MaxBlockSize = 256;
+
+    /**
+     * Blocks kept per size class and thread.
+     */
+    static constexpr size_t MaxCachedBlocks = 4096;
+
+    /**
+     * Get a block.
+     * @param size Size in bytes.
+     * @return Block, aligned for any fundamental type.
+     */
+    static void* allocate(size_t size);
+
+    /**
+     * Return a block.
+     * @param block Block from allocate.
+     * @param size Size given to allocate.
+     */
+    static void deallocate(void* block, size_t size);
+
+    /**
+     * @return Number of free blocks kept by the calling thread.
+     */
+    static size_t numberOfCachedBlocks();
+};
+
+/**
+ * @brief The MessagePoolAllocator class is a standard allocator taking single
+ * objects from the MessagePool, e.g. for std::allocate_shared.
+ */
+template<class T>
+class MessagePoolAllocator
+{
+
+public:
+
+    using value_type = T;
+
+    MessagePoolAllocator() noexcept {}
+
+    template<class U>
+    MessagePoolAllocator(const MessagePoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(n == 1 ? MessagePool::allocate(sizeof(T)) : ::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        if(n == 1)
+        {
+            MessagePool::deallocate(p, sizeof(T));
+        }
+        else
+        {
+            ::operator delete(p);
+        }
+    }
+
+    template<class U>
+    bool operator==(const MessagePoolAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const MessagePoolAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
+
+#endif // MESSAGE_POOL_H
@@ -107,6 +107,13 @@ public:
      */
     void process(double timeStep);
 
+    /**
+     * Resets the objective for another simulation run with the same
+     * agent, so that it starts again. Derived objectives with further
+     * run state should extend it.
+     */
+    virtual void reset();
+
 
 protected:
 
@@ -152,6 +159,11 @@ public:
      * Delete all elements in queue.
      */
     void deleteAllObjectives();
+
+    /**
+     * Reset all objectives in queue, see Objective::reset.
+     */
+    void resetObjectives();
 };
 
 #endif // OBJECTIVE_H
@@ -44,6 +44,11 @@ public:
      */
     virtual ~MaintainDistance();
 
+    /**
+     * Get and set the observation distance.
+     */
+    double observationDistance() const;
+    void setObservationDistance(double obsDistance);
 
 
     // From Objective interface
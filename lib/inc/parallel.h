@@ -24,14 +24,25 @@
 #ifndef PARALLEL_H
 #define PARALLEL_H
 
-#include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
 #include <atomic>
+#include <chrono>
+#include <string>
+#include <array>
 #include "simulation.h"
+#include "result_sink.h"
+#include "result_cache.h"
 
 /**
- * Runs simulations in parallel on multiple threads.
+ * Runs simulations in parallel on multiple threads. Each worker
+ * thread has its own queue of simulations, from which it claims
+ * chunks of simulations. A worker with an empty queue steals half
+ * of the queue of another worker.
  */
 class Parallel
 {
@@ -40,6 +51,73 @@ public:
 
     using SimQueueElement = std::tuple<std::shared_ptr<Simulation>, double, double>;
 
+    /**
+     * Becomes ready when the simulation finished. Holds the exception
+     * if the simulation threw one.
+     */
+    using SimulationFuture = std::shared_future<std::shared_ptr<Simulation>>;
+
+    /**
+     * Called by the worker thread when a simulation finished.
+     */
+    using CompletionCallback = std::function<void(std::shared_ptr<Simulation>)>;
+
+    /**
+     * Creates the simulation with the given index on demand.
+     */
+    using SimulationGenerator = std::function<std::shared_ptr<Simulation>(size_t index)>;
+
+    /**
+     * Estimates the cost of a simulation, e.g. its expected wall time.
+     * Only the relative size of the estimates matters.
+     */
+    using CostEstimator = std::function<double(const std::shared_ptr<Simulation>& sim)>;
+
+    /**
+     * Estimates the cost of the simulation a generator creates for an index.
+     */
+    using IndexCostEstimator = std::function<double(size_t index)>;
+
+    /**
+     * Statistics of one worker thread.
+     */
+    struct WorkerStatistics
+    {
+        int cpu;                // pinned CPU, -1 if not pinned
+        int node;               // NUMA node of the CPU, -1 if not pinned
+        size_t simulations;     // finished simulations
+        size_t steps;           // simulated time steps
+        double busySeconds;     // time spent running simulations
+        double idleSeconds;     // time spent claiming, stealing or waiting
+        double wallSeconds;     // time since run(), till the worker finished
+
+        /**
+         * @return Finished simulations per wall clock second.
+         */
+        double simulationsPerSecond() const;
+    };
+
+    /**
+     * Statistics of the whole run, taken while it runs.
+     */
+    struct LiveStatistics
+    {
+        double elapsedSeconds;          // time since run()
+        size_t finished;                // finished simulations
+        size_t running;                 // simulations being run
+        size_t queued;                  // simulations not yet started
+        double simulationsPerSecond;    // finished simulations per elapsed second
+        double stepsPerSecond;          // simulated time steps per elapsed second
+        double etaSeconds;              // expected time till all finished, -1 if unknown
+        double meanWallSeconds;         // wall time per simulation ...
+        double minWallSeconds;
+        double maxWallSeconds;
+        double medianWallSeconds;       // ... quantiles with a resolution of 19%
+        double p90WallSeconds;
+        double p99WallSeconds;
+        std::vector<WorkerStatistics> workers;
+    };
+
     static std::shared_ptr<Parallel> createParallel(size_t nThreads);
 
     /**
@@ -58,31 +136,279 @@ public:
      * @param aSimulation Simulation
      * @param timeSteps Time steps in seconds.
      * @param simulationTime Overall simulation time in seconds.
+     * @return Future which becomes ready when the simulation finished.
      */
-    void addSimulation( std::shared_ptr<Simulation> aSimulation, double timeSteps, double simulationTime );
+    SimulationFuture addSimulation( std::shared_ptr<Simulation> aSimulation, double timeSteps, double simulationTime );
+
+    /**
+     * Add simulations which are only created when a worker is about to
+     * run them, so that not all simulations exist at the same time. The
+     * generator is called from the worker threads, concurrently but with
+     * distinct indices. Generated simulations are run after the added ones.
+     * If the generator throws, the index counts as a failed simulation: it
+     * is finished without result, see numberOfFailedSimulations.
+     * Note: Add generators before run().
+     * @param count Number of simulations, indices 0 to count - 1.
+     * @param generator Creates the simulation of an index.
+     * @param timeSteps Time steps in seconds.
+     * @param simulationTime Overall simulation time in seconds.
+     * @param cost Optional cost estimate of the indices. If given, the indices
+     * are generated in order of decreasing cost, see setCostEstimator.
+     */
+    void addSimulationGenerator(size_t count, SimulationGenerator generator, double timeSteps, double simulationTime,
+                                IndexCostEstimator cost = nullptr);
+
+    /**
+     * Sets a cost estimator of the added simulations. run() then schedules
+     * them longest first: The simulations are sorted by decreasing cost and
+     * each is put to the worker queue with the least cost so far. Workers
+     * run their queue from the front, thieves take from the back, so the
+     * cheap simulations are left to fill the gaps at the end. Without
+     * estimator, the simulations are distributed in order of adding.
+     * Note: Set it before run().
+     * @param estimator Cost estimator, nullptr keeps the order of adding.
+     */
+    void setCostEstimator(CostEstimator estimator);
+
+    /**
+     * Sets a callback which is called for every finished simulation.
+     * Note: It is called from the worker threads; set it before run().
+     * If the callback throws, the simulation still counts as finished and
+     * additionally as failed, see numberOfFailedSimulations.
+     * @param callback Completion callback.
+     */
+    void setCompletionCallback(CompletionCallback callback);
+
+    /**
+     * Enables streaming mode: The result of each finished simulation is
+     * written to the sink, afterwards its environment is released and the
+     * simulation is not kept for waitAny. Like this, the memory used
+     * for environments only depends on the number of threads.
+     * Note: Set it before run().
+     * @param sink Result sink, nullptr disables streaming mode.
+     */
+    void setResultSink(std::shared_ptr<ResultSink> sink);
+
+    /**
+     * Sets a cache of results. In streaming mode, a simulation whose key
+     * (see ResultCache::key) is cached is not run; the cached values are
+     * written to the result sink instead. Results of simulations which
+     * were run are stored. Without result sink, the cache is not used,
+     * as the simulations and their evaluations are handed out.
+     * Note: Set it before run().
+     * @param cache Result cache, nullptr disables caching.
+     */
+    void setResultCache(std::shared_ptr<ResultCache> cache);
+
+    /**
+     * Sets if simulations stop as soon as Evaluation::isSimulationFinished
+     * returns true. The simulation time of addSimulation is then the
+     * maximum duration. Default is false.
+     * @param stop Stop finished simulations early.
+     */
+    void setStopWhenFinished(bool stop);
+
+    /**
+     * @return True if simulations stop when finished.
+     */
+    bool stopWhenFinished() const;
+
+    /**
+     * Sets if the worker threads are pinned to CPUs. The workers are spread
+     * over the NUMA nodes, see CpuTopology::workerCpus. As environments and
+     * agents are created by the worker running the simulation, their memory
+     * is then first touched, and so placed, on the worker's node.
+     * Note: Set it before run(). Default is false.
+     * @param pin Pin worker threads.
+     */
+    void setPinThreads(bool pin);
+
+    /**
+     * Sets if each worker recycles one simulation instead of initialising
+     * every added simulation: The added simulation then only provides
+     * id, seed, factories, evaluation and description. The worker resets
+     * its own simulation with them (see Simulation::reset) and runs it, so
+     * the environment is allocated once per worker as long as consecutive
+     * simulations use the same environment factory class. Thus the factory
+     * must create equivalent environments, regardless of its instance.
+     * Results are read from the evaluation; the added simulations
+     * themselves never get an environment.
+     * Note: Set it before run(). Default is false.
+     * @param recycle Recycle simulations.
+     */
+    void setRecycleSimulations(bool recycle);
+
+    /**
+     * @return True if workers recycle simulations.
+     */
+    bool recycleSimulations() const;
 
     /**
      * Run all simulations
      */
     void run();
 
+    /**
+     * Blocks until all added simulations finished.
+     */
+    void wait();
+
+    /**
+     * Blocks until a simulation finished which was not yet returned
+     * by waitAny. Simulations are returned in order of completion.
+     * In streaming mode, it only returns nullptr when all finished.
+     * @return Finished simulation, or nullptr if all were returned.
+     */
+    std::shared_ptr<Simulation> waitAny();
+
     /**
      * Main function of threads.
+     * @param workerIdx Index of the worker thread.
      */
-    void doWork();
+    void doWork(size_t workerIdx);
 
     /**
-     * Get progress.
+     * Get progress. Can be called from any thread.
      * @return <number of finished simulations, number of queued simulations>
      */
     std::pair<double, double> getProgress() const;
 
+    /**
+     * Get the number of simulations which threw, while being generated
+     * or run, or whose completion callback threw. They count as finished, but no result is written to the
+     * result sink. Can be called from any thread.
+     * @return Number of failed simulations.
+     */
+    size_t numberOfFailedSimulations() const;
+
+    /**
+     * Get statistics of each worker. Can be called from any thread.
+     * @return Statistics per worker.
+     */
+    std::vector<WorkerStatistics> getWorkerStatistics() const;
+
+    /**
+     * Get statistics of the run: throughput, wall time distribution of the
+     * simulations, expected remaining time, and the worker statistics. They
+     * are read from atomic counters, without locking, so they can be polled
+     * from any thread while the workers run. The ETA assumes the remaining
+     * simulations finish at the rate of the finished ones.
+     * @return Live statistics, all zero before run().
+     */
+    LiveStatistics getLiveStatistics() const;
+
+    /**
+     * Get a readable line of the live statistics, e.g. for progress output.
+     * @return Finished simulations, throughput, wall time quantiles and ETA.
+     */
+    std::string liveReport() const;
+
+    /**
+     * Get a readable table of the worker statistics.
+     * @return Report, one line per worker.
+     */
+    std::string workerReport() const;
+
+    /**
+     * Get the idle time at the end of the run: Summed over the workers,
+     * the time between the worker running out of simulations and the
+     * last worker finishing, respectively now while workers still run.
+     * Can be called from any thread.
+     * @return Tail idle time in seconds.
+     */
+    double tailIdleSeconds() const;
+
+    /**
+     * Sets how many simulations a worker claims at once from its own queue.
+     * Larger chunks reduce locking for many short simulations. Default is 1.
+     * @param chunkSize Number of simulations, at least 1.
+     */
+    void setChunkSize(size_t chunkSize);
+
+    /**
+     * @return Number of simulations a worker claims at once.
+     */
+    size_t chunkSize() const;
+
 private:
-    std::queue<SimQueueElement> m_simQueue;
+
+    struct Job
+    {
+        SimQueueElement element;
+        double cost;
+        std::shared_ptr<std::promise<std::shared_ptr<Simulation>>> promise; // nullptr if generated
+        std::exception_ptr error; // exception of the generator, the simulation is nullptr then
+    };
+
+    struct GeneratorRange
+    {
+        SimulationGenerator generator;
+        size_t count;
+        double timeSteps;
+        double simulationTime;
+        std::vector<size_t> order; // indices by decreasing cost, empty for index order
+        IndexCostEstimator cost;
+        std::atomic_size_t next;
+    };
+
+    struct WorkerQueue
+    {
+        std::deque<Job> simulations;
+        std::mutex mutex;
+
+        // statistics of the worker owning the queue
+        std::atomic_int cpu{-1};
+        std::atomic_int node{-1}; // NUMA node of cpu, resolved once when pinning
+        std::atomic_size_t nbrOfSimulations{0};
+        std::atomic_size_t nbrOfSteps{0};
+        std::atomic<int64_t> busyNanoseconds{0};
+        std::atomic<int64_t> finishedNanoseconds{-1}; // since run(), -1 while working
+
+        std::shared_ptr<Simulation> runner; // recycled simulation, only used by the owner
+    };
+
+    bool claimOwn(size_t workerIdx, std::deque<Job>& claimed);
+    bool steal(size_t workerIdx, std::deque<Job>& claimed);
+    bool claimGenerated(std::deque<Job>& claimed);
+    void runJob(WorkerQueue& own, Job& job);
+    std::shared_ptr<Simulation> prepareRunner(WorkerQueue& own, const std::shared_ptr<Simulation>& sim);
+    void scheduleLongestFirst();
+    int64_t elapsedNanoseconds() const;
+    void recordWallTime(int64_t nanoseconds);
+    double wallTimeQuantile(double q, size_t count) const;
+
+    // wall times of simulations: 4 buckets per doubling, starting at 1 us
+    static constexpr size_t NbrOfWallTimeBuckets = 128;
+
     size_t m_nbrThreads;
     std::vector<std::thread> m_threadPool;
-    std::mutex m_queueMutex;
+    std::vector<std::unique_ptr<WorkerQueue>> m_workerQueues;
+    std::vector<std::unique_ptr<GeneratorRange>> m_generators;
+    std::atomic_size_t m_nextQueue;
+    std::atomic_size_t m_chunkSize;
+    bool m_stopWhenFinished;
+    bool m_pinThreads;
+    bool m_recycleSimulations;
+    std::chrono::steady_clock::time_point m_runStart;
+    std::atomic_bool m_started;
+    std::atomic_size_t m_nbrOfQueuedSimulations;
     std::atomic_size_t m_nbrOfFinishedSimulations;
+    std::atomic_size_t m_nbrOfAddedSimulations;
+    std::atomic_size_t m_nbrOfFailedSimulations;
+    std::array<std::atomic_size_t, NbrOfWallTimeBuckets> m_wallTimeBuckets;
+    std::atomic<int64_t> m_wallNanosecondsSum;
+    std::atomic<int64_t> m_minWallNanoseconds;
+    std::atomic<int64_t> m_maxWallNanoseconds;
+
+    CompletionCallback m_completionCallback;
+    CostEstimator m_costEstimator;
+    std::shared_ptr<ResultSink> m_resultSink;
+    std::shared_ptr<ResultCache> m_resultCache;
+    std::mutex m_resultSinkMutex;
+    std::mutex m_completionMutex;
+    std::condition_variable m_completionCondition;
+    std::deque<std::shared_ptr<Simulation>> m_completed; // not yet returned by waitAny
+    size_t m_nbrOfReturnedSimulations;
 };
 
 #endif // PARALLEL_H
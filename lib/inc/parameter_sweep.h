@@ -0,0 +1,340 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <fstream>
+
+#include <unordered_map>
+
+#include "parallel.h"
+#include "process_pool.h"
+#include "result_table.h"
+#include "lockstep_batch.h"
+#include "cost_model.h"
+
+/**
+ * @brief The ParameterPoint struct holds the parameter values of
+ * one point of a parameter sweep, in axis order.
+ */
+struct ParameterPoint
+{
+    size_t index;
+    std::vector<std::string> names;
+    std::vector<double> values;
+
+    /**
+     * Get the value of a parameter.
+     * @param name Axis name, must exist.
+     * @return Parameter value.
+     */
+    double operator[](const std::string& name) const;
+};
+
+/**
+ * @brief The ParameterSweep class runs a simulation scenario for many
+ * parameter combinations. The parameter space is made of named axes and
+ * sampled as full grid, randomly or as latin hypercube. Each point is
+ * simulated a number of times (replications), the evaluation results
+ * of the replications are reduced to one row of the result table.
+ */
+class ParameterSweep
+{
+
+public:
+
+    /**
+     * How the points are taken from the axes.
+     */
+    enum Sampling
+    {
+        Grid,           // all combinations of the axis values, first axis changes slowest
+        Random,         // uniform within [min, max] of each axis
+        LatinHypercube  // one sample per stratum of each axis
+    };
+
+    /**
+     * Creates the simulation of a point. The simulation must be
+     * created with the given id, e.g. Simulation::createSimulation(simId).
+     * The id only tells the sweep where the simulation belongs to: After
+     * building, the sweep sets the scenario key and stream id of the
+     * simulation from the point values and the replication, see
+     * scenarioKey, so that its random streams and cached results do not
+     * depend on the position of the point in the sweep.
+     */
+    using ScenarioBuilder = std::function<std::shared_ptr<Simulation>(const ParameterPoint& point, unsigned int simId)>;
+
+    /**
+     * Reduces the results of all replications of a point to one result.
+     */
+    using Reduction = std::function<Evaluation::ResultValues(const std::vector<Evaluation::ResultValues>& replications)>;
+
+    /**
+     * Creates the evaluation of a lockstep batch with the given number of runs.
+     */
+    using BatchEvaluationBuilder = std::function<std::shared_ptr<BatchEvaluation>(size_t nRuns)>;
+
+    /**
+     * Estimates the cost of simulating a point, e.g. from its parameters.
+     */
+    using PointCostEstimator = std::function<double(const ParameterPoint& point)>;
+
+    static std::shared_ptr<ParameterSweep> createParameterSweep();
+
+    /**
+     * Constructor
+     */
+    ParameterSweep();
+
+    /**
+     * Destructor
+     */
+    virtual ~ParameterSweep();
+
+    /**
+     * Add an axis with given values.
+     * @param name Parameter name.
+     * @param values Values. For random sampling, min and max are used.
+     */
+    void addAxis(const std::string& name, const std::vector<double>& values);
+
+    /**
+     * Add an axis with the values first + k * step, k = 0..count-1.
+     * @param name Parameter name.
+     * @param first First value.
+     * @param step Step between values.
+     * @param count Number of values.
+     */
+    void addLinearAxis(const std::string& name, double first, double step, size_t count);
+
+    /**
+     * @return Names of the axes.
+     */
+    std::vector<std::string> axisNames() const;
+
+    /**
+     * Sets the sampling. Default is Grid.
+     * @param sampling Sampling method.
+     * @param nbrOfSamples Number of points for Random and LatinHypercube.
+     * @param seed Seed of the random sampling.
+     */
+    void setSampling(Sampling sampling, size_t nbrOfSamples = 0, uint64_t seed = 0);
+
+    /**
+     * @return Number of points.
+     */
+    size_t numberOfPoints() const;
+
+    /**
+     * Get a point.
+     * @param index Point index.
+     * @return Point.
+     */
+    ParameterPoint point(size_t index) const;
+
+    /**
+     * Sets how often each point is simulated. Default is 1.
+     * @param replications Number of simulations per point.
+     */
+    void setReplications(size_t replications);
+
+    /**
+     * @return Number of simulations per point.
+     */
+    size_t replications() const;
+
+    /**
+     * Sets the scenario builder.
+     * @param builder Scenario builder.
+     */
+    void setScenarioBuilder(ScenarioBuilder builder);
+
+    /**
+     * Sets the reduction of the replications. By default,
+     * the mean of each value is taken.
+     * @param reduction Reduction.
+     */
+    void setReduction(Reduction reduction);
+
+    /**
+     * Mean of each value over the replications.
+     * @param replications Results of the replications.
+     * @return Mean values.
+     */
+    static Evaluation::ResultValues meanReduction(const std::vector<Evaluation::ResultValues>& replications);
+
+    /**
+     * Sets a journal file. Each finished point is appended to it at once.
+     * When run finds a journal of the same sweep (same points, replications
+     * and axes), the finished points are taken from it and only the
+     * remaining points are simulated. A journal of another sweep is replaced.
+     * @param path Journal path, empty disables the journal.
+     */
+    void setJournal(const std::string& path);
+
+    /**
+     * @return Number of points taken from the journal by the last run.
+     */
+    size_t numberOfResumedPoints() const;
+
+    /**
+     * Sets a cache of simulation results, see ResultCache. Simulations
+     * whose results are cached, e.g. by an overlapping earlier sweep,
+     * are not run again. Unlike the journal, the cache works per simulation
+     * and across sweeps: The key is made of the point values, replication,
+     * master seed and the configuration, not of the simulation id.
+     * @param cache Result cache, nullptr disables caching.
+     */
+    void setResultCache(std::shared_ptr<ResultCache> cache);
+
+    /**
+     * Sets if simulations stop as soon as Evaluation::isSimulationFinished
+     * returns true, see Parallel::setStopWhenFinished. Default is false.
+     * @param stop Stop finished simulations early.
+     */
+    void setStopWhenFinished(bool stop);
+
+    /**
+     * Sets a cost estimator of the points. run() then hands out the most
+     * expensive points first, see Parallel::addSimulationGenerator, so that
+     * no long simulation starts when the other workers are about to finish.
+     * @param estimator Cost estimator, nullptr for point order.
+     */
+    void setCostEstimator(PointCostEstimator estimator);
+
+    /**
+     * Sets a cost model learning the wall time of the simulations from the
+     * point values. run() adds every simulation it ran to the model and,
+     * if the model has observations and no cost estimator is set, hands out
+     * the points with the largest estimated cost first. Keep the model, or
+     * save and load it, to schedule the next sweep of the scenario.
+     * @param model Cost model, nullptr disables learning.
+     */
+    void setCostModel(std::shared_ptr<CostModel> model);
+
+    /**
+     * Get the scenario key of a simulation of a point: the axis names and
+     * values and the replication, e.g. "speed=2 replication=0".
+     * @param point Point.
+     * @param replication Replication index.
+     * @return Scenario key, see Simulation::setScenarioKey.
+     */
+    static std::string scenarioKey(const ParameterPoint& point, size_t replication);
+
+    /**
+     * @return Points which could not be simulated by the last run.
+     */
+    const std::vector<size_t>& failedPoints() const;
+
+    /**
+     * Runs all points on the given Parallel instance and blocks till finished.
+     * The simulation with id simId belongs to point simId / replications().
+     * The results are taken from Evaluation::getResultValues.
+     * @param parallel Parallel instance, not yet run.
+     * @param timeStep Time step in seconds.
+     * @param duration Simulation duration in seconds.
+     * @return Table with the columns point, axis names..., result names...
+     * in order of completion. Results named like an axis are left out.
+     */
+    ResultTable run(std::shared_ptr<Parallel> parallel, double timeStep, double duration);
+
+    /**
+     * Runs all points in forked worker processes, see ProcessPool, and
+     * blocks till finished. A simulation whose process crashed is retried;
+     * points failing all attempts are reported by failedPoints() and are
+     * missing in the table (and in the journal, so a resume tries again).
+     * @param nProcesses Number of worker processes.
+     * @param timeStep Time step in seconds.
+     * @param duration Simulation duration in seconds.
+     * @param maxRetries How often a failed simulation is tried again.
+     * @return Table like run.
+     */
+    ResultTable runProcesses(size_t nProcesses, double timeStep, double duration, size_t maxRetries = 1);
+
+    /**
+     * Runs all points in lockstep batches, see LockstepBatch, and blocks till
+     * finished. Consecutive simulations are grouped into batches, which are
+     * run by the given number of threads. The results are taken from the
+     * batch evaluation. A simulation whose agents cannot join the batch is
+     * run on its own, with its Evaluation.
+     * @param nThreads Number of threads.
+     * @param batchSize Number of simulations per batch.
+     * @param evaluationBuilder Creates the evaluation of a batch.
+     * @param timeStep Time step in seconds.
+     * @param duration Simulation duration in seconds.
+     * @return Table like run.
+     */
+    ResultTable runLockstep(size_t nThreads, size_t batchSize, BatchEvaluationBuilder evaluationBuilder,
+                            double timeStep, double duration);
+
+private:
+    struct Axis
+    {
+        std::string name;
+        std::vector<double> values;
+        double min;
+        double max;
+    };
+
+    struct RunState
+    {
+        ResultTable table;
+        std::vector<size_t> todo; // points to simulate
+        std::unordered_map<size_t, std::vector<Evaluation::ResultValues>> pending; // replications till all finished
+        std::ofstream journal;
+    };
+
+    void beginRun(RunState& state);
+    unsigned int simulationId(const RunState& state, size_t idx) const;
+    std::shared_ptr<Simulation> buildSimulation(unsigned int simId) const;
+    Evaluation::ResultValues simulate(std::shared_ptr<Simulation> sim, double timeStep, double duration, bool lookupCache = true) const;
+    void addResult(RunState& state, unsigned int simId, const Evaluation::ResultValues& values);
+    void endRun(RunState& state);
+
+    std::string journalHeader() const;
+    bool readJournal(ResultTable& table, std::vector<bool>& finished) const;
+    void writeJournalRow(std::ofstream& journal, const ResultTable& table, size_t row) const;
+
+    std::vector<Axis> m_axes;
+    Sampling m_sampling;
+    size_t m_nbrOfSamples;
+    uint64_t m_seed;
+    std::vector<std::vector<size_t>> m_strata; // latin hypercube: per axis the stratum of each sample
+    size_t m_replications;
+    ScenarioBuilder m_builder;
+    Reduction m_reduction;
+    std::string m_journalPath;
+    size_t m_nbrOfResumedPoints;
+    bool m_stopWhenFinished;
+    std::shared_ptr<ResultCache> m_resultCache;
+    PointCostEstimator m_costEstimator;
+    std::shared_ptr<CostModel> m_costModel;
+    std::vector<size_t> m_failedPoints;
+};
+
+#endif // PARAMETER_SWEEP_H
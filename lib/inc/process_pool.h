@@ -0,0 +1,102 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef PROCESS_POOL_H
+#define PROCESS_POOL_H
+
+#include <vector>
+#include <functional>
+
+#include "evaluation.h"
+
+/**
+ * @brief The ProcessPool class runs tasks in forked worker processes, so
+ * that a crashing or leaking simulation cannot take the whole sweep down.
+ * Task indices are sent to the workers over Unix socket pairs, one at a
+ * time, and the result values are sent back. If a worker dies or a task
+ * throws, the task is retried up to a maximum number of times and the
+ * worker is replaced. Tasks failing every attempt are reported.
+ * Note: Worker processes are only supported on unix like systems,
+ * elsewhere the tasks are run one after the other in this process.
+ * Fork copies only the calling thread, so run should not be called while
+ * other threads hold locks the tasks need.
+ */
+class ProcessPool
+{
+
+public:
+
+    /**
+     * Runs in a worker process and computes the result of a task.
+     */
+    using Task = std::function<Evaluation::ResultValues(size_t taskIdx)>;
+
+    /**
+     * Receives the result of a task in this process.
+     */
+    using ResultCallback = std::function<void(size_t taskIdx, const Evaluation::ResultValues& values)>;
+
+    /**
+     * Constructor
+     * @param nProcesses Number of worker processes.
+     */
+    ProcessPool(size_t nProcesses);
+
+    /**
+     * Destructor
+     */
+    virtual ~ProcessPool();
+
+    /**
+     * Sets how often a failed task is tried again. Default is 1.
+     * @param retries Number of retries.
+     */
+    void setMaxRetries(size_t retries);
+
+    /**
+     * Runs the tasks 0 to count - 1 and blocks till all finished or failed.
+     * @param count Number of tasks.
+     * @param task Task function, called in the worker processes.
+     * @param callback Result callback, called in this process.
+     * @return Number of successful tasks.
+     */
+    size_t run(size_t count, Task task, ResultCallback callback);
+
+    /**
+     * @return Indices of the tasks which failed in the last run.
+     */
+    const std::vector<size_t>& failedTasks() const;
+
+    /**
+     * @return Number of worker processes which died in the last run.
+     */
+    size_t numberOfLostWorkers() const;
+
+private:
+    size_t m_nbrProcesses;
+    size_t m_maxRetries;
+    std::vector<size_t> m_failedTasks;
+    size_t m_nbrOfLostWorkers;
+};
+
+#endif // PROCESS_POOL_H
@@ -0,0 +1,186 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <memory>
+#include <array>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief The RandomStream class is a counter-based pseudo random number
+ * generator (Philox4x32-10). The generated sequence depends only on the key
+ * and the stream id, so two streams with the same key and stream id produce
+ * identical numbers, no matter on which thread or in which order they are used.
+ * The class fulfills the UniformRandomBitGenerator requirements and can be
+ * passed to the std distributions.
+ */
+class RandomStream
+{
+
+public:
+
+    using result_type = uint32_t;
+
+    /**
+     * Constructor
+     * @param key Generator key (seed).
+     * @param streamId Id of the independent stream within the key.
+     */
+    RandomStream(uint64_t key = 0, uint64_t streamId = 0);
+
+    /**
+     * Destructor
+     */
+    virtual ~RandomStream();
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    /**
+     * Get next random number.
+     * @return Uniform distributed 32 bit number.
+     */
+    result_type operator()();
+
+    /**
+     * Get next uniform distributed number in [0, 1).
+     * @return Random number.
+     */
+    double uniform();
+
+    /**
+     * Skip the next n random numbers.
+     * @param n Number of random numbers to skip.
+     */
+    void discard(uint64_t n);
+
+    /**
+     * @return Generator key.
+     */
+    uint64_t key() const;
+
+    /**
+     * @return Stream id.
+     */
+    uint64_t streamId() const;
+
+    /**
+     * Compute one Philox4x32-10 block.
+     * @param counter 128 bit counter.
+     * @param key 64 bit key.
+     * @return 128 random bits.
+     */
+    static std::array<uint32_t, 4> philox(const std::array<uint32_t, 4>& counter, const std::array<uint32_t, 2>& key);
+
+private:
+    void generateBlock();
+
+    uint64_t m_key;
+    uint64_t m_streamId;
+    uint64_t m_blockCounter;
+    std::array<uint32_t, 4> m_block;
+    unsigned int m_blockPos;
+};
+
+
+/**
+ * @brief The RandomService class hands out independent random streams
+ * for one simulation. The streams are derived from a master seed and the
+ * simulation id, so a simulation is reproducible when rerun with the same
+ * master seed.
+ */
+class RandomService
+{
+
+public:
+
+    /**
+     * Separates the streams of different consumers.
+     */
+    enum StreamDomain
+    {
+        AgentDomain,
+        FactoryDomain,
+        EnvironmentDomain,
+        UserDomain
+    };
+
+    static std::shared_ptr<RandomService> createRandomService(uint64_t masterSeed, unsigned int simulationId);
+
+    /**
+     * Constructor
+     * @param masterSeed Master seed, e.g. of a whole parameter sweep.
+     * @param simulationId Simulation id.
+     */
+    RandomService(uint64_t masterSeed, unsigned int simulationId);
+
+    /**
+     * Destructor
+     */
+    virtual ~RandomService();
+
+    /**
+     * @return Master seed.
+     */
+    uint64_t masterSeed() const;
+
+    /**
+     * @return Simulation id.
+     */
+    unsigned int simulationId() const;
+
+    /**
+     * Get a stream of a given domain. Each call returns the stream
+     * at its beginning.
+     * @param domain Stream domain.
+     * @param id Id within the domain, e.g. agent id.
+     * @return Random stream.
+     */
+    RandomStream getStream(StreamDomain domain, unsigned int id) const;
+
+    /**
+     * Get the stream of a specific agent.
+     * @param agentId Agent id.
+     * @return Random stream.
+     */
+    RandomStream getAgentStream(unsigned int agentId) const;
+
+    /**
+     * Derives a stream id from a text, e.g. describing the parameters of
+     * a scenario, so that equal scenarios get equal random streams
+     * regardless of their simulation id. Stable across platforms.
+     * @param text Text.
+     * @return Stream id, see Simulation::setStreamId.
+     */
+    static unsigned int streamIdOf(const std::string& text);
+
+private:
+    uint64_t m_masterSeed;
+    unsigned int m_simulationId;
+    uint64_t m_key;
+};
+
+#endif // RANDOM_STREAM_H
@@ -0,0 +1,118 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <memory>
+#include <string>
+#include <atomic>
+
+#include "simulation.h"
+#include "evaluation.h"
+
+/**
+ * @brief The ResultCache class stores evaluation results on disk, keyed by
+ * the configuration of the simulation, so that identical simulations of
+ * overlapping runs are not simulated again. Each result is one file in the
+ * cache directory, named by the hash of the key; the file also holds the
+ * key itself to detect hash collisions. Files are written to a temporary
+ * file first and then renamed, so the cache can be shared by threads and
+ * processes.
+ */
+class ResultCache
+{
+
+public:
+
+    static std::shared_ptr<ResultCache> createResultCache(const std::string& directory);
+
+    /**
+     * Constructor
+     * @param directory Cache directory, created if it does not exist.
+     */
+    ResultCache(const std::string& directory);
+
+    /**
+     * @return True if the cache directory exists.
+     */
+    bool isOpen() const;
+
+    /**
+     * Get the key of a simulation run. It is made of the library version,
+     * the scenario key (see Simulation::setScenarioKey) or, without, the
+     * simulation id, the stream id and master seed (which select the random
+     * streams), time step, duration, and the class and configuration of the
+     * factories and of the evaluation. Factories with parameters must
+     * therefore describe them in configuration(), see AgentFactory and
+     * EnvironmentFactory.
+     * @param sim Simulation, its factories and evaluation must be set.
+     * @param timeStep Time step in seconds.
+     * @param duration Simulation time, respectively maximum time, in seconds.
+     * @param stopWhenFinished True if the simulation stops when finished.
+     * @return Key text.
+     */
+    static std::string key(std::shared_ptr<Simulation> sim, double timeStep, double duration, bool stopWhenFinished);
+
+    /**
+     * Looks up a result. Can be called from any thread.
+     * @param key Key text.
+     * @param values Result values, set if found.
+     * @return True if the result is cached.
+     */
+    bool lookup(const std::string& key, Evaluation::ResultValues& values);
+
+    /**
+     * Stores a result. Can be called from any thread.
+     * @param key Key text.
+     * @param values Result values.
+     * @return False if the result could not be written.
+     */
+    bool store(const std::string& key, const Evaluation::ResultValues& values);
+
+    /**
+     * @return Number of successful lookups.
+     */
+    size_t hits() const;
+
+    /**
+     * @return Number of lookups which found nothing.
+     */
+    size_t misses() const;
+
+    /**
+     * @return Library version, part of every key.
+     */
+    static std::string libraryVersion();
+
+private:
+
+    std::string filePath(const std::string& key) const;
+
+    std::string m_directory;
+    bool m_isOpen;
+    std::atomic_size_t m_hits;
+    std::atomic_size_t m_misses;
+};
+
+#endif // RESULT_CACHE_H
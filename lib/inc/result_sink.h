@@ -0,0 +1,165 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <memory>
+#include <string>
+#include <fstream>
+#include <functional>
+
+#include "evaluation.h"
+
+/**
+ * @brief The SimulationResult struct holds the result of one
+ * finished simulation.
+ */
+struct SimulationResult
+{
+    unsigned int simulationId;
+    std::string description;
+    Evaluation::ResultValues values;
+    double wallSeconds = 0.0; // time to run the simulation, 0 if the result was cached
+};
+
+/**
+ * @brief The ResultSink class receives the results of finished simulations,
+ * so that the simulations themselves can be released. Parallel never calls
+ * write concurrently.
+ */
+class ResultSink
+{
+
+public:
+
+    /**
+     * Destructor
+     */
+    virtual ~ResultSink() {}
+
+    /**
+     * Write the result of a finished simulation.
+     * @param result Simulation result.
+     */
+    virtual void write(const SimulationResult& result) = 0;
+
+    /**
+     * Flush buffered results.
+     */
+    virtual void flush() {}
+};
+
+/**
+ * @brief The CallbackResultSink class forwards each result to a function.
+ */
+class CallbackResultSink: public ResultSink
+{
+
+public:
+
+    using Callback = std::function<void(const SimulationResult&)>;
+
+    static std::shared_ptr<CallbackResultSink> createCallbackResultSink(Callback callback);
+
+    /**
+     * Constructor
+     * @param callback Called for each result.
+     */
+    CallbackResultSink(Callback callback);
+
+    void write(const SimulationResult& result) override;
+
+private:
+    Callback m_callback;
+};
+
+/**
+ * @brief The CsvResultSink class writes one line per result. The header
+ * line is taken from the value names of the first result.
+ */
+class CsvResultSink: public ResultSink
+{
+
+public:
+
+    static std::shared_ptr<CsvResultSink> createCsvResultSink(const std::string& path);
+
+    /**
+     * Constructor
+     * @param path Path of csv file. An existing file is overwritten.
+     */
+    CsvResultSink(const std::string& path);
+
+    /**
+     * @return True if the file could be opened.
+     */
+    bool isOpen() const;
+
+    void write(const SimulationResult& result) override;
+    void flush() override;
+
+private:
+    std::ofstream m_file;
+    bool m_headerWritten;
+};
+
+/**
+ * @brief The BinaryResultSink class writes results as length prefixed binary
+ * records, which are more compact and faster to write than csv. All numbers
+ * are stored in native byte order.
+ */
+class BinaryResultSink: public ResultSink
+{
+
+public:
+
+    static std::shared_ptr<BinaryResultSink> createBinaryResultSink(const std::string& path);
+
+    /**
+     * Constructor
+     * @param path Path of binary file. An existing file is overwritten.
+     */
+    BinaryResultSink(const std::string& path);
+
+    /**
+     * @return True if the file could be opened.
+     */
+    bool isOpen() const;
+
+    void write(const SimulationResult& result) override;
+    void flush() override;
+
+    /**
+     * Reads a file written by BinaryResultSink record by record.
+     * @param path Path of binary file.
+     * @param callback Called for each result.
+     * @return False if the file could not be opened or is corrupt.
+     */
+    static bool read(const std::string& path, CallbackResultSink::Callback callback);
+
+private:
+    std::ofstream m_file;
+};
+
+#endif // RESULT_SINK_H
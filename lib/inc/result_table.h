@@ -0,0 +1,118 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef RESULT_TABLE_H
+#define RESULT_TABLE_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The ResultTable class stores results column by column: each
+ * named column is a contiguous vector of doubles, one entry per row.
+ */
+class ResultTable
+{
+
+public:
+
+    /**
+     * Returned by columnIndex if no such column exists.
+     */
+    static constexpr size_t NoColumn = size_t(-1);
+
+    /**
+     * Constructor
+     * @param columnNames Names of the columns.
+     */
+    ResultTable(const std::vector<std::string>& columnNames = {});
+
+    /**
+     * Destructor
+     */
+    virtual ~ResultTable();
+
+    /**
+     * @return Names of the columns.
+     */
+    const std::vector<std::string>& columnNames() const;
+
+    /**
+     * @return Number of columns.
+     */
+    size_t numberOfColumns() const;
+
+    /**
+     * @return Number of rows.
+     */
+    size_t numberOfRows() const;
+
+    /**
+     * Get the index of a column.
+     * @param name Column name.
+     * @return Column index or NoColumn.
+     */
+    size_t columnIndex(const std::string& name) const;
+
+    /**
+     * Get a whole column.
+     * @param name Column name, must exist.
+     * @return Values of the column.
+     */
+    const std::vector<double>& column(const std::string& name) const;
+
+    /**
+     * Get a single value.
+     * @param row Row index.
+     * @param name Column name, must exist.
+     * @return Value.
+     */
+    double value(size_t row, const std::string& name) const;
+
+    /**
+     * Add a row.
+     * @param values One value per column, in column order.
+     */
+    void addRow(const std::vector<double>& values);
+
+    /**
+     * Sorts all rows by the values of a column. Rows with
+     * equal values keep their order.
+     * @param name Column name, must exist.
+     * @param ascending Sort order.
+     */
+    void sortByColumn(const std::string& name, bool ascending = true);
+
+    /**
+     * Writes the table as csv file with a header line.
+     * @param path File path. An existing file is overwritten.
+     * @return False if the file could not be written.
+     */
+    bool writeCsv(const std::string& path) const;
+
+private:
+    std::vector<std::string> m_columnNames;
+    std::vector<std::vector<double>> m_columns;
+};
+
+#endif // RESULT_TABLE_H
@@ -106,12 +106,27 @@ public:
     std::shared_ptr<Evaluation> getEvaluation();
 
     /**
-     * Inits the environment. No agents added yet.
+     * Inits the environment. No agents added yet. An environment
+     * which was reset in place by reset() is kept.
      */
     void initEnvironment();
 
     /**
-     * Creates and add the agents.
+     * Prepares the simulation for another run with new parameters, i.e.
+     * with the factories and evaluation set afterwards. The running time is
+     * set back, the random streams follow the new id and seed, and the
+     * environment is reset in place (see Environment::reset) instead of
+     * being created again by initEnvironment(). Call releaseEnvironment()
+     * before if the next run needs another kind of environment.
+     * @param id New simulation id.
+     * @param masterSeed New master seed.
+     */
+    void reset(unsigned int id, uint64_t masterSeed);
+
+    /**
+     * Creates and add the agents. After reset(), the agents of the previous
+     * run are reset in place by AgentFactory::resetAgents instead, if the
+     * agent factory is of the same class.
      */
     void initAgents();
 
@@ -127,6 +142,12 @@ public:
      */
     std::shared_ptr<Environment> getEnvironment();
 
+    /**
+     * Releases the environment and with it all agents. The
+     * evaluation and the factories are kept.
+     */
+    void releaseEnvironment();
+
     /**
      * Return the overall simulation running time in seconds.
      * @return Running time in seconds.
@@ -147,6 +168,14 @@ public:
      */
     void runSimulation(double timeStep);
 
+    /**
+     * Run simulation till finished, but at most for a given time. The function
+     * Evaluation::isSimulationFinished indicates when the simulation is finished.
+     * @param timeStep Time steps in seconds.
+     * @param maxDuration Maximum simulation duration in seconds.
+     */
+    void runSimulationUntilFinished(double timeStep, double maxDuration);
+
     /**
      * Used computation time in ms for
      * one time step.
@@ -160,8 +189,92 @@ public:
      */
     void setEnableLogMessages(bool enable);
 
+    /**
+     * @return True if log messages are printed.
+     */
+    bool enableLogMessages() const;
+
+    /**
+     * Sets an asynchronous logger the environment logs to instead
+     * of writing std out itself, see Environment::setLogger.
+     * @param logger Logger, nullptr to log synchronously.
+     */
+    void setLogger(std::shared_ptr<AsyncLogger> logger);
+
+    /**
+     * @return Asynchronous logger, nullptr if none.
+     */
+    std::shared_ptr<AsyncLogger> logger() const;
+
+    /**
+     * Sets a directory the messages of each run are written to as
+     * binary event log, events_<simulation id>.mafe, see EventLog.
+     * @param directory Directory, empty for no event log (default).
+     */
+    void setEventLogDirectory(const std::string& directory);
+
+    /**
+     * @return Event log directory, empty if none.
+     */
+    std::string eventLogDirectory() const;
+
+    /**
+     * @return Event log of the current run, nullptr if none.
+     */
+    std::shared_ptr<EventLog> eventLog() const;
+
+    /**
+     * Sets the master seed. Together with the stream id, it
+     * determines all random streams of this simulation.
+     * @param seed Master seed.
+     */
+    void setMasterSeed(uint64_t seed);
+
+    /**
+     * Sets the id the random streams are derived from, together with the
+     * master seed. Default is the simulation id; reset() sets it back.
+     * @param streamId Stream id, e.g. RandomService::streamIdOf(scenarioKey()).
+     */
+    void setStreamId(unsigned int streamId);
+
+    /**
+     * @return Stream id.
+     */
+    unsigned int streamId() const;
+
+    /**
+     * Sets a one line description of what is simulated independent of the
+     * simulation id, e.g. the parameter values and replication of a sweep
+     * point. If set, ResultCache::key uses it instead of the simulation id,
+     * so equal scenarios of different runs share cached results. reset()
+     * clears it.
+     * @param key Scenario key without line breaks, empty for none.
+     */
+    void setScenarioKey(const std::string& key);
+
+    /**
+     * @return Scenario key, empty if none.
+     */
+    std::string scenarioKey() const;
+
+    /**
+     * Get the master seed.
+     * @return Master seed.
+     */
+    uint64_t masterSeed() const;
+
+    /**
+     * Get the random service of this simulation.
+     * @return Random service.
+     */
+    std::shared_ptr<RandomService> getRandomService() const;
+
 private:
+    void flushEventLog();
+
     unsigned int m_id;
+    unsigned int m_streamId;
+    std::string m_scenarioKey;
     double m_simulationRunningTime;
     std::shared_ptr<AgentFactory> m_agentFactory;
     std::shared_ptr<EnvironmentFactory> m_environmentFactory;
@@ -170,6 +283,14 @@ private:
     std::string m_description;
     int m_computationTime = 0;
     bool m_enableLogMessages = true;
+    bool m_environmentReset = false;
+    std::shared_ptr<AsyncLogger> m_logger;
+    std::list<std::shared_ptr<Agent>> m_agents; // agents of the last initAgents
+    std::shared_ptr<AgentFactory> m_agentsFactory; // factory which provided m_agents
+    bool m_agentsReset = false;
+    std::string m_eventLogDirectory;
+    std::shared_ptr<EventLog> m_eventLog;
+    std::shared_ptr<RandomService> m_randomService;
 
 };
 
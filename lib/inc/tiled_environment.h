@@ -0,0 +1,213 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#ifndef TILED_ENVIRONMENT_H
+#define TILED_ENVIRONMENT_H
+
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include "environment.h"
+
+/**
+ * @brief The TiledEnvironment class partitions the environment into square
+ * tiles, which are updated by several worker threads. Each step, agents are
+ * assigned to the tile of their position (agents migrate between tiles), and
+ * the positions of agents in neighbouring tiles within the halo width are
+ * exchanged before the distances are computed.
+ *
+ * Differences to Environment:
+ *  - Agents only see other agents closer than the halo width. The halo width
+ *    must therefore be at least the largest interaction range (e.g. observation
+ *    distance or sensor range) of the agents.
+ *  - By default, messages sent within a step are delivered at the end of the
+ *    step. With immediate delivery, they are pushed into the receiver's
+ *    lock-free mailbox right away; the receiver might then see it in the same
+ *    or in the next step, depending on thread timing.
+ *  - The distance map getAgentDistances() is not used.
+ * With end of step delivery, the results do not depend on the number of threads.
+ * Logging and message listeners are always served at the end of the step.
+ */
+class TiledEnvironment: public Environment
+{
+
+public:
+
+    enum MessageDelivery
+    {
+        EndOfStep, /** Deliver messages at end of step, deterministic */
+        Immediate /** Deliver messages during the step */
+    };
+
+    static std::shared_ptr<TiledEnvironment> createTiledEnvironment(unsigned int id, double tileSize,
+                                                                    double haloWidth, size_t nThreads);
+
+    /**
+     * Constructor
+     * @param id Environment id.
+     * @param tileSize Edge length of the square tiles in m.
+     * @param haloWidth Agents closer than the halo width see each other, in m.
+     * @param nThreads Number of worker threads.
+     */
+    TiledEnvironment(unsigned int id, double tileSize, double haloWidth, size_t nThreads);
+
+    /**
+     * Destructor
+     */
+    virtual ~TiledEnvironment();
+
+    /**
+     * @return Edge length of the tiles in m.
+     */
+    double tileSize() const;
+
+    /**
+     * @return Halo width in m.
+     */
+    double haloWidth() const;
+
+    /**
+     * @return Number of worker threads.
+     */
+    size_t numberOfThreads() const;
+
+    /**
+     * @return Number of occupied tiles in the last step.
+     */
+    size_t numberOfTiles() const;
+
+    /**
+     * @return Number of agents which changed their tile in the last step.
+     */
+    size_t numberOfMigrations() const;
+
+    /**
+     * Sets when messages sent during the parallel update are delivered.
+     * @param delivery Message delivery.
+     */
+    void setMessageDelivery(MessageDelivery delivery);
+
+    /**
+     * @return Message delivery.
+     */
+    MessageDelivery messageDelivery() const;
+
+    /**
+     * Assigns the agents to tiles and computes the distances of all agents
+     * to their neighbours within the halo width.
+     */
+    void computeTiledDistances();
+
+public: // inherited from Environment
+    void update(double time) override;
+    void reset() override;
+    DistanceQueue getAgentDistancesToAllOtherAgents(unsigned int id) override;
+    void sendMessage(std::shared_ptr<Message> aMessage) override;
+    using Environment::log;
+    void log(LogLevel level, const std::string &logMsg) override;
+
+protected:
+
+    using TileKey = std::pair<long, long>;
+
+    struct Tile
+    {
+        TileKey key;
+        std::vector<std::shared_ptr<Agent>> updateAgents; // top level agents updated by this tile
+        std::vector<Agent*> distanceAgents; // enabled agents incl. sub agents located in this tile
+        std::vector<std::shared_ptr<Message>> outbox; // messages to deliver at end of step
+        std::vector<std::shared_ptr<Message>> delivered; // messages delivered during the step
+    };
+
+    TileKey tileOf(const Eigen::Vector2d& pos) const;
+    void computeTileDistances(Tile& tile);
+
+    /**
+     * Updates the top level agents of a tile. Messages sent meanwhile are
+     * collected in the tile's outbox (or delivered, see MessageDelivery).
+     */
+    void updateTileAgents(Tile& tile, double time);
+
+    /**
+     * Decides if a message sent during the parallel update is pushed
+     * into the receiver's mailbox right away.
+     * @param aMessage Message.
+     * @return True for immediate delivery, false for end of step.
+     */
+    virtual bool deliverImmediately(const Message& aMessage) const;
+
+    /**
+     * Serves logging and listeners of the delivered messages and delivers
+     * the outbox messages, both in tile order.
+     */
+    void deliverTileMessages();
+
+    /**
+     * Runs the jobs 0..nJobs-1 on the worker threads and the calling thread.
+     * The worker threads are started on first use and kept for the next steps.
+     * @param nJobs Number of jobs.
+     * @param job Job function, called with the job index.
+     */
+    void runParallel(size_t nJobs, const std::function<void(size_t)>& job);
+
+    /**
+     * Stops and joins the worker threads.
+     */
+    void stopWorkers();
+
+    void workerLoop(size_t generation);
+    void runJobs();
+
+    double m_tileSize;
+    double m_haloWidth;
+    size_t m_nThreads;
+    MessageDelivery m_messageDelivery;
+
+    std::vector<Tile> m_tiles;
+    std::map<TileKey, size_t> m_tileIndex;
+    std::unordered_map<unsigned int, TileKey> m_agentTile;
+    size_t m_nMigrations;
+
+    std::unordered_map<unsigned int, size_t> m_slotOfAgent;
+    std::vector<DistanceQueue> m_slotDistances;
+
+    std::mutex m_logMutex;
+
+    // persistent worker threads of runParallel
+    std::vector<std::thread> m_workers;
+    std::mutex m_workerMutex;
+    std::condition_variable m_workerCondition;
+    std::condition_variable m_workersDoneCondition;
+    const std::function<void(size_t)>* m_job;
+    size_t m_nJobs;
+    std::atomic_size_t m_nextJob;
+    size_t m_jobGeneration;
+    size_t m_nBusyWorkers;
+    bool m_stopWorkers;
+};
+
+#endif // TILED_ENVIRONMENT_H
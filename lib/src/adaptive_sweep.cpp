@@ -0,0 +1,268 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <cassert>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+#include "adaptive_sweep.h"
+
+std::shared_ptr<AdaptiveSweep> AdaptiveSweep::createAdaptiveSweep()
+{
+    return std::shared_ptr<AdaptiveSweep>(new AdaptiveSweep());
+}
+
+AdaptiveSweep::AdaptiveSweep() : m_threshold(0.0), m_maxLevel(0), m_stopWhenFinished(false),
+    m_nextSimulationId(0)
+{
+
+}
+
+AdaptiveSweep::~AdaptiveSweep()
+{
+
+}
+
+void AdaptiveSweep::addAxis(const std::string &name, double min, double max, size_t count)
+{
+    assert(count >= 2);
+    m_axes.push_back({name, min, max, count});
+}
+
+void AdaptiveSweep::setScenarioBuilder(ParameterSweep::ScenarioBuilder builder)
+{
+    m_builder = builder;
+}
+
+void AdaptiveSweep::setRefinement(const std::string &metric, double threshold, unsigned int maxLevel)
+{
+    m_metric = metric;
+    m_threshold = threshold;
+    m_maxLevel = maxLevel;
+}
+
+void AdaptiveSweep::setStopWhenFinished(bool stop)
+{
+    m_stopWhenFinished = stop;
+}
+
+const std::vector<ParameterPoint> &AdaptiveSweep::failedPoints() const
+{
+    return m_failedPoints;
+}
+
+ParameterPoint AdaptiveSweep::parameterPoint(const LatticePoint &lp, size_t index) const
+{
+    // lattice coordinates are in units of the finest level
+    ParameterPoint p;
+    p.index = index;
+    for(size_t a = 0; a < m_axes.size(); a++)
+    {
+        const Axis& axis = m_axes[a];
+        double nSteps = double(axis.count - 1) * (uint64_t(1) << m_maxLevel);
+        p.names.push_back(axis.name);
+        p.values.push_back(axis.min + (axis.max - axis.min) * lp[a] / nSteps);
+    }
+    return p;
+}
+
+std::vector<AdaptiveSweep::LatticePoint> AdaptiveSweep::corners(const Cell &cell) const
+{
+    std::vector<LatticePoint> c;
+    for(size_t bits = 0; bits < (size_t(1) << m_axes.size()); bits++)
+    {
+        LatticePoint lp = cell.lower;
+        for(size_t a = 0; a < m_axes.size(); a++)
+        {
+            if(bits & (size_t(1) << a))
+            {
+                lp[a] += cell.span;
+            }
+        }
+        c.push_back(lp);
+    }
+    return c;
+}
+
+void AdaptiveSweep::runPoints(const std::vector<LatticePoint> &points, unsigned int level, size_t nThreads,
+                              double timeStep, double duration, ResultTable &table)
+{
+    unsigned int firstId = m_nextSimulationId;
+    m_nextSimulationId += points.size();
+    std::vector<bool> finished(points.size(), false);
+
+    auto parallel = Parallel::createParallel(nThreads);
+    parallel->setStopWhenFinished(m_stopWhenFinished);
+
+    // the sink is never called concurrently
+    parallel->setResultSink(CallbackResultSink::createCallbackResultSink([&](const SimulationResult& result)
+    {
+        const LatticePoint& lp = points[result.simulationId - firstId];
+        ParameterPoint p = parameterPoint(lp, result.simulationId);
+        finished[result.simulationId - firstId] = true;
+
+        // values already given by the point are not repeated
+        Evaluation::ResultValues values = result.values;
+        values.erase(std::remove_if(values.begin(), values.end(), [&p](const auto& v)
+        {
+            return std::find(p.names.begin(), p.names.end(), v.first) != p.names.end();
+        }), values.end());
+
+        auto metric = std::find_if(values.begin(), values.end(), [this](const auto& v) { return v.first == m_metric; });
+        if(metric != values.end() && !std::isnan(metric->second))
+        {
+            m_metricValues[lp] = metric->second;
+        }
+
+        if(table.numberOfColumns() == 0)
+        {
+            std::vector<std::string> columns = {"point"};
+            columns.insert(columns.end(), p.names.begin(), p.names.end());
+            columns.push_back("level");
+            for(const auto& [name, value]: values)
+            {
+                columns.push_back(name);
+            }
+            table = ResultTable(columns);
+        }
+
+        std::vector<double> row = {double(result.simulationId)};
+        row.insert(row.end(), p.values.begin(), p.values.end());
+        row.push_back(level);
+        for(const auto& [name, value]: values)
+        {
+            row.push_back(value);
+        }
+        table.addRow(row);
+    }));
+
+    parallel->addSimulationGenerator(points.size(), [&](size_t idx)
+    {
+        unsigned int simId = firstId + idx;
+        ParameterPoint p = parameterPoint(points[idx], simId);
+        auto sim = m_builder(p, simId);
+        assert(sim->id() == simId);
+
+        // equal points get the same random streams, whenever they are refined
+        std::string key = ParameterSweep::scenarioKey(p, 0);
+        sim->setScenarioKey(key);
+        sim->setStreamId(RandomService::streamIdOf(key));
+        return sim;
+    }, timeStep, duration);
+
+    parallel->run();
+    parallel->wait();
+
+    for(size_t k = 0; k < points.size(); k++)
+    {
+        if(!finished[k])
+        {
+            m_failedPoints.push_back(parameterPoint(points[k], firstId + k));
+        }
+    }
+}
+
+ResultTable AdaptiveSweep::run(size_t nThreads, double timeStep, double duration)
+{
+    assert(m_builder && !m_axes.empty());
+
+    ResultTable table;
+    m_simulatedPoints.clear();
+    m_metricValues.clear();
+    m_failedPoints.clear();
+    m_nextSimulationId = 0;
+
+    // coarse cells
+    uint64_t coarseSpan = uint64_t(1) << m_maxLevel;
+    std::vector<Cell> cells = {{LatticePoint(m_axes.size(), 0), coarseSpan}};
+    for(size_t a = 0; a < m_axes.size(); a++)
+    {
+        std::vector<Cell> extended;
+        for(const Cell& c: cells)
+        {
+            for(size_t k = 0; k + 1 < m_axes[a].count; k++)
+            {
+                Cell e = c;
+                e.lower[a] = k * coarseSpan;
+                extended.push_back(e);
+            }
+        }
+        cells = extended;
+    }
+
+    for(unsigned int level = 0; !cells.empty(); level++)
+    {
+        // simulate the corners which were not simulated before
+        std::vector<LatticePoint> points;
+        for(const Cell& c: cells)
+        {
+            for(const LatticePoint& lp: corners(c))
+            {
+                if(m_simulatedPoints.insert(lp).second)
+                {
+                    points.push_back(lp);
+                }
+            }
+        }
+        runPoints(points, level, nThreads, timeStep, duration, table);
+
+        // split the cells with a large change of the metric
+        std::vector<Cell> refined;
+        for(const Cell& c: cells)
+        {
+            if(c.span == 1)
+            {
+                continue;
+            }
+
+            // without the metric at all corners, the change within the cell is unknown
+            double min = std::numeric_limits<double>::max();
+            double max = std::numeric_limits<double>::lowest();
+            bool complete = true;
+            for(const LatticePoint& lp: corners(c))
+            {
+                auto v = m_metricValues.find(lp);
+                if(v == m_metricValues.end())
+                {
+                    complete = false;
+                    break;
+                }
+                min = std::min(min, v->second);
+                max = std::max(max, v->second);
+            }
+
+            if(complete && max - min > m_threshold)
+            {
+                Cell half{c.lower, c.span / 2};
+                for(const LatticePoint& lower: corners(half))
+                {
+                    refined.push_back({lower, half.span});
+                }
+            }
+        }
+        cells = refined;
+    }
+
+    return table;
+}
@@ -26,6 +26,7 @@
 
 #include "agent.h"
 #include "helpers.h"
+#include "message_arena.h"
 
 std::shared_ptr<Agent> Agent::createAgent(unsigned int id)
 {
@@ -35,7 +36,7 @@ std::shared_ptr<Agent> Agent::createAgent(unsigned int id)
 Agent::Agent(unsigned int id) : m_id(id), m_radius(0.0), m_velocity(Eigen::Vector2d(0.0, 0.0)),
     m_position(Eigen::Vector2d(0.0, 0.0)), m_acceleration(Eigen::Vector2d(0.0, 0.0)),
     m_maxSpeed(std::numeric_limits<double>::max()), m_maxAccelreation(std::numeric_limits<double>::max()),
-    m_enabled(true)
+    m_enabled(true), m_hasRandomStream(false)
 {
 
 }
@@ -144,6 +145,7 @@ void Agent::setAccelerateTowardsTarget(const Eigen::Vector2d& target, double acc
 void Agent::setEnvironment(std::shared_ptr<EnvironmentInterface> env)
 {
     m_environment = env;
+    m_hasRandomStream = false;
 }
 
 std::weak_ptr<EnvironmentInterface> Agent::getEnvironment() const
@@ -177,6 +179,21 @@ void Agent::update(double time)
     }
 }
 
+void Agent::reset()
+{
+    m_position = Eigen::Vector2d(0.0, 0.0);
+    m_velocity = Eigen::Vector2d(0.0, 0.0);
+    m_acceleration = Eigen::Vector2d(0.0, 0.0);
+    m_enabled = true;
+    m_hasRandomStream = false;
+    m_objectives.resetObjectives();
+
+    for(auto& sa: m_subAgents)
+    {
+        sa->reset();
+    }
+}
+
 void Agent::performMove(double time)
 {
     // A very basic default implementation how an agent moves.
@@ -225,6 +242,18 @@ ObjectiveSP Agent::getActiveObjective()
     return ret;
 }
 
+RandomStream& Agent::randomStream()
+{
+    if(!m_hasRandomStream)
+    {
+        assert(hasEnvironment());
+        m_randomStream = m_environment.lock()->getRandomStream(id());
+        m_hasRandomStream = true;
+    }
+
+    return m_randomStream;
+}
+
 double Agent::accelreationLimit() const
 {
     return m_maxAccelreation;
@@ -267,8 +296,18 @@ void Agent::processMessage(std::shared_ptr<Message> msg)
 
 void Agent::sendMessage(unsigned int receiverId, Message::Subject subject, const std::string &textParam, const std::vector<double> &vecDoubleParam, const std::vector<int> &vecIntParam)
 {
-    auto m = std::shared_ptr<Message>(new Message(id(), receiverId, subject, textParam, vecDoubleParam, vecIntParam));
-    m_environment.lock()->sendMessage(m);
+    auto env = m_environment.lock();
+    MessageArena* arena = env->messageArena();
+    env->sendMessage(arena ? arena->createMessage(id(), receiverId, subject, textParam, vecDoubleParam, vecIntParam)
+                           : Message::createMessage(id(), receiverId, subject, textParam, vecDoubleParam, vecIntParam));
+}
+
+void Agent::sendMessage(unsigned int receiverId, Message::Subject subject, std::initializer_list<double> doubleParams)
+{
+    auto env = m_environment.lock();
+    MessageArena* arena = env->messageArena();
+    env->sendMessage(arena ? arena->createMessage(id(), receiverId, subject, doubleParams)
+                           : Message::createMessage(id(), receiverId, subject, doubleParams));
 }
 
 double Agent::velocityLimit() const
@@ -58,6 +58,33 @@ void Human::disableReacting(bool disable)
     m_disableReacting = disable;
 }
 
+void Human::setParameters(double velocityLimit, double maxAcceleration, double obsDistance, double reactionTime)
+{
+    m_maxSpeed = velocityLimit;
+    m_maxAccelreation = maxAcceleration;
+    m_obsDistance = obsDistance;
+    m_reactionTime = reactionTime;
+}
+
+double Human::observationDistance() const
+{
+    return m_obsDistance;
+}
+
+double Human::reactionTime() const
+{
+    return m_reactionTime;
+}
+
+void Human::reset()
+{
+    Agent::reset();
+
+    m_disableReacting = false;
+    m_timeSinceLastReaction = 0.0;
+    m_stressLevel = 0.0;
+}
+
 double Human::getStressLevel() const
 {
     return m_stressLevel;
@@ -92,9 +92,12 @@ void Missile::update(double time)
             // if target closer than missile can fly within "time" -> detonate
             if(dist.dist < time * m_maxSpeed)
             {
-                std::ostringstream s;
-                s << "Missile " << id() << " detonated: Target " << m_target;
-                m_environment.lock()->log(s.str());
+                auto env = m_environment.lock();
+                MafLog::log<LogLevel::Info>(*env, [this](std::ostream& s)
+                {
+                    s << "Missile " << id() << " detonated: Target " << m_target;
+                });
+                env->recordEvent(EventKind::Detonation, id(), m_target, {m_position.x(), m_position.y()});
 
                 sendMessage(m_target, Message::Disable);
 
@@ -80,9 +80,13 @@ void MissileStation::update(double time)
             missile->fire(agent.targetId);
             m_targets.insert(agent.targetId);
 
-            std::ostringstream s;
-            s << "FIRE: from " << id() << " at " << agent.targetId;
-            m_environment.lock()->log(s.str());
+            auto env = m_environment.lock();
+            MafLog::log<LogLevel::Info>(*env, [this, &agent](std::ostream& s)
+            {
+                s << "FIRE: from " << id() << " at " << agent.targetId;
+            });
+            env->recordEvent(EventKind::Fire, id(), agent.targetId, {m_position.x(), m_position.y()},
+                             {static_cast<int>(missile->id())});
         }
     }
 }
@@ -94,7 +98,7 @@ AgentType MissileStation::type() const
 
 void MissileStation::setEnvironment(std::shared_ptr<EnvironmentInterface> env)
 {
-    m_environment = env;
+    Agent::setEnvironment(env);
 
     // set environment also to all local generated subagents
     for(auto suba: getSubAgents())
@@ -107,3 +111,8 @@ double MissileStation::detectionRange() const
 {
     return m_detectionRange;
 }
+
+size_t MissileStation::numberOfMissiles() const
+{
+    return m_missiles.size();
+}
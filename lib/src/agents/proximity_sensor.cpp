@@ -97,3 +97,8 @@ void ProximitySensor::addIgnoreAgentId(unsigned int agentId)
     m_ignoreAgentIds.insert(agentId);
 }
 
+const std::set<unsigned int> &ProximitySensor::ignoredAgentIds() const
+{
+    return m_ignoreAgentIds;
+}
+
@@ -0,0 +1,216 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+
+#include "async_logger.h"
+
+std::shared_ptr<AsyncLogger> AsyncLogger::createAsyncLogger(std::ostream &out, size_t capacity, OverflowPolicy policy)
+{
+    return std::shared_ptr<AsyncLogger>(new AsyncLogger(out, capacity, policy));
+}
+
+AsyncLogger::AsyncLogger(std::ostream &out, size_t capacity, OverflowPolicy policy) : m_out(out), m_policy(policy),
+    m_enqueuePos(0), m_dequeuePos(0), m_logged(0), m_written(0), m_dropped(0), m_blocked(0), m_truncated(0), m_stop(false)
+{
+    size_t size = 2;
+    while(size < capacity)
+    {
+        size *= 2;
+    }
+
+    m_slots = std::vector<Slot>(size);
+    m_mask = size - 1;
+    for(size_t k = 0; k < size; k++)
+    {
+        m_slots[k].sequence = k;
+    }
+
+    m_writer = std::thread([this] { writerLoop(); });
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    m_stop = true;
+    m_writer.join();
+}
+
+bool AsyncLogger::log(std::string_view text)
+{
+    Record r;
+    r.kind = Record::Text;
+    if(text.size() > MaxTextLength)
+    {
+        m_truncated++;
+        text = text.substr(0, MaxTextLength);
+    }
+    r.length = static_cast<unsigned char>(text.size());
+    std::memcpy(r.text, text.data(), text.size());
+    return push(r);
+}
+
+bool AsyncLogger::logMessage(const Message &message)
+{
+    Record r;
+    r.kind = Record::MessageRecord;
+    r.length = 0;
+    r.subject = message.subject();
+    r.senderId = message.senderId();
+    r.receiverId = message.receiverId();
+    return push(r);
+}
+
+bool AsyncLogger::push(const Record &record)
+{
+    bool waited = false;
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    while(true)
+    {
+        // bounded MPMC ring: a slot is free for position pos when its sequence equals pos
+        Slot& slot = m_slots[pos & m_mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+        if(diff == 0)
+        {
+            if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.record = record;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                m_logged++;
+                return true;
+            }
+        }
+        else if(diff < 0)
+        {
+            // full
+            if(m_policy == Drop)
+            {
+                m_dropped++;
+                return false;
+            }
+
+            if(!waited)
+            {
+                m_blocked++;
+                waited = true;
+            }
+            std::this_thread::yield();
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AsyncLogger::pop(Record &record)
+{
+    Slot& slot = m_slots[m_dequeuePos & m_mask];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if(sequence != m_dequeuePos + 1)
+    {
+        return false;
+    }
+
+    record = slot.record;
+    slot.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+    m_dequeuePos++;
+    return true;
+}
+
+void AsyncLogger::write(const Record &record)
+{
+    if(record.kind == Record::MessageRecord)
+    {
+        m_out << "Message: " << Message(record.senderId, record.receiverId, record.subject).toString() << '\n';
+    }
+    else
+    {
+        m_out.write(record.text, record.length);
+        m_out << '\n';
+    }
+}
+
+void AsyncLogger::writerLoop()
+{
+    Record record;
+    size_t idle = 0;
+    while(true)
+    {
+        // the stop flag is read before draining -> records pushed before it are written
+        bool stop = m_stop;
+
+        size_t n = 0;
+        while(pop(record))
+        {
+            write(record);
+            n++;
+        }
+
+        if(n > 0)
+        {
+            // one flush per batch instead of one per line
+            m_out.flush();
+            m_written += n;
+            idle = 0;
+        }
+        else if(stop)
+        {
+            return;
+        }
+        else
+        {
+            // back off up to 1 ms while there is nothing to write
+            idle = std::min<size_t>(idle + 1, 10);
+            std::this_thread::sleep_for(std::chrono::microseconds(1) * (1 << idle));
+        }
+    }
+}
+
+void AsyncLogger::flush()
+{
+    size_t logged = m_logged;
+    while(m_written < logged)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+AsyncLogger::Counters AsyncLogger::counters() const
+{
+    return {m_logged, m_written, m_dropped, m_blocked, m_truncated};
+}
+
+size_t AsyncLogger::capacity() const
+{
+    return m_slots.size();
+}
+
+AsyncLogger::OverflowPolicy AsyncLogger::overflowPolicy() const
+{
+    return m_policy;
+}
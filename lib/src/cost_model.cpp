@@ -0,0 +1,179 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "cost_model.h"
+
+namespace
+{
+    const char* CostFileHeader = "MAFCOST 1";
+}
+
+std::shared_ptr<CostModel> CostModel::createCostModel(size_t nbrOfNeighbours)
+{
+    return std::shared_ptr<CostModel>(new CostModel(nbrOfNeighbours));
+}
+
+CostModel::CostModel(size_t nbrOfNeighbours) : m_nbrOfNeighbours(std::max<size_t>(1, nbrOfNeighbours))
+{
+
+}
+
+void CostModel::addObservation(const std::vector<double> &features, double cost)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_observations.empty())
+    {
+        m_min = features;
+        m_max = features;
+    }
+    else if(features.size() != m_min.size())
+    {
+        return;
+    }
+
+    for(size_t f = 0; f < features.size(); f++)
+    {
+        m_min[f] = std::min(m_min[f], features[f]);
+        m_max[f] = std::max(m_max[f], features[f]);
+    }
+
+    m_observations.push_back({features, cost});
+}
+
+size_t CostModel::numberOfObservations() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_observations.size();
+}
+
+double CostModel::estimate(const std::vector<double> &features) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_observations.empty() || features.size() != m_min.size())
+    {
+        return 0.0;
+    }
+
+    // distances in features scaled to the observed range
+    std::vector<std::pair<double, double>> neighbours; // distance, cost
+    neighbours.reserve(m_observations.size());
+    for(const auto& o: m_observations)
+    {
+        double d2 = 0.0;
+        for(size_t f = 0; f < features.size(); f++)
+        {
+            double range = m_max[f] - m_min[f];
+            double diff = range > 0.0 ? (features[f] - o.features[f]) / range : 0.0;
+            d2 += diff * diff;
+        }
+        neighbours.push_back({std::sqrt(d2), o.cost});
+    }
+
+    size_t k = std::min(m_nbrOfNeighbours, neighbours.size());
+    std::partial_sort(neighbours.begin(), neighbours.begin() + k, neighbours.end());
+
+    // an observation at the same features decides alone
+    if(neighbours.front().first <= 0.0)
+    {
+        double sum = 0.0;
+        size_t n = 0;
+        for(size_t i = 0; i < k && neighbours[i].first <= 0.0; i++, n++)
+        {
+            sum += neighbours[i].second;
+        }
+        return sum / n;
+    }
+
+    double weightedSum = 0.0;
+    double weights = 0.0;
+    for(size_t i = 0; i < k; i++)
+    {
+        double w = 1.0 / neighbours[i].first;
+        weightedSum += w * neighbours[i].second;
+        weights += w;
+    }
+    return weightedSum / weights;
+}
+
+bool CostModel::save(const std::string &path) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    std::ofstream f(path);
+    if(!f.is_open())
+    {
+        return false;
+    }
+
+    // one observation per line: cost, then the features
+    f << CostFileHeader << std::endl;
+    f << std::setprecision(17);
+    for(const auto& o: m_observations)
+    {
+        f << o.cost;
+        for(double v: o.features)
+        {
+            f << " " << v;
+        }
+        f << std::endl;
+    }
+
+    return static_cast<bool>(f);
+}
+
+bool CostModel::load(const std::string &path)
+{
+    std::ifstream f(path);
+    std::string line;
+    if(!f.is_open() || !std::getline(f, line) || line != CostFileHeader)
+    {
+        return false;
+    }
+
+    while(std::getline(f, line))
+    {
+        std::istringstream fields(line);
+        double cost;
+        if(!(fields >> cost))
+        {
+            continue;
+        }
+
+        std::vector<double> features;
+        double v;
+        while(fields >> v)
+        {
+            features.push_back(v);
+        }
+        addObservation(features, cost);
+    }
+
+    return true;
+}
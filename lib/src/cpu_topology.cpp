@@ -0,0 +1,181 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <fstream>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <filesystem>
+
+#include "cpu_topology.h"
+
+#if defined(__linux__)
+#define MAF_CPU_AFFINITY
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    // CPUs this process may run on
+    std::vector<int> allowedCpus()
+    {
+        std::vector<int> cpus;
+#ifdef MAF_CPU_AFFINITY
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+            for(int c = 0; c < CPU_SETSIZE; c++)
+            {
+                if(CPU_ISSET(c, &set))
+                    cpus.push_back(c);
+            }
+        }
+#endif
+        return cpus;
+    }
+
+    // all NUMA nodes with all their CPUs, ordered by node number; node numbers may have gaps
+    std::vector<CpuTopology::NumaNode> systemNodes(const std::string& nodeDirectory)
+    {
+        std::vector<CpuTopology::NumaNode> nodes;
+        std::error_code error;
+        for(const auto& entry: std::filesystem::directory_iterator(nodeDirectory, error))
+        {
+            std::string name = entry.path().filename().string();
+            if(name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+               !std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c); }))
+                continue;
+
+            std::ifstream f(entry.path() / "cpulist");
+            if(!f.is_open())
+                continue;
+
+            std::string list;
+            std::getline(f, list);
+            nodes.push_back({std::atoi(name.c_str() + 4), CpuTopology::parseCpuList(list)});
+        }
+
+        std::sort(nodes.begin(), nodes.end(), [](const CpuTopology::NumaNode& a, const CpuTopology::NumaNode& b) { return a.id < b.id; });
+        return nodes;
+    }
+}
+
+std::vector<int> CpuTopology::parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    const char* p = list.c_str();
+    while(*p)
+    {
+        char* end;
+        long first = std::strtol(p, &end, 10);
+        if(end == p)
+        {
+            // skip separators and anything unexpected, e.g. the newline
+            p++;
+            continue;
+        }
+
+        long last = first;
+        p = end;
+        if(*p == '-')
+        {
+            last = std::strtol(p + 1, &end, 10);
+            p = end;
+        }
+
+        for(long c = first; c <= last; c++)
+        {
+            cpus.push_back(c);
+        }
+    }
+    return cpus;
+}
+
+std::vector<CpuTopology::NumaNode> CpuTopology::numaNodes(const std::string& nodeDirectory)
+{
+    std::vector<int> allowed = allowedCpus();
+    std::vector<NumaNode> nodes;
+
+    for(const NumaNode& node: systemNodes(nodeDirectory))
+    {
+        std::vector<int> cpus;
+        for(int c: node.cpus)
+        {
+            if(std::find(allowed.begin(), allowed.end(), c) != allowed.end())
+                cpus.push_back(c);
+        }
+
+        if(!cpus.empty())
+            nodes.push_back({node.id, cpus});
+    }
+
+    // no NUMA information: one node
+    if(nodes.empty() && !allowed.empty())
+    {
+        nodes.push_back({0, allowed});
+    }
+
+    return nodes;
+}
+
+int CpuTopology::nodeOfCpu(int cpu, const std::string& nodeDirectory)
+{
+    for(const NumaNode& node: numaNodes(nodeDirectory))
+    {
+        if(std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end())
+            return node.id;
+    }
+    return -1;
+}
+
+std::vector<int> CpuTopology::workerCpus(size_t nWorkers)
+{
+    auto nodes = numaNodes();
+    std::vector<int> cpus;
+    if(nodes.empty())
+    {
+        return cpus;
+    }
+
+    for(size_t w = 0; w < nWorkers; w++)
+    {
+        const auto& node = nodes[w % nodes.size()].cpus;
+        cpus.push_back(node[(w / nodes.size()) % node.size()]);
+    }
+    return cpus;
+}
+
+bool CpuTopology::pinCurrentThread(int cpu)
+{
+#ifdef MAF_CPU_AFFINITY
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
@@ -0,0 +1,185 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
+#include "distance_kernel.h"
+
+#if defined(__GNUC__)
+    #define MAF_NOINLINE __attribute__((noinline))
+#else
+    #define MAF_NOINLINE
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define MAF_X86_DISPATCH
+    #include <immintrin.h>
+#endif
+
+namespace
+{
+    using BlockFunction = void (*)(double, double, const double*, const double*, size_t, double*, double*, double*);
+
+    // not inlined into the simd variants -> no contraction to fma
+    MAF_NOINLINE void blockScalar(double px, double py, const double* x, const double* y, size_t n,
+                     double* dx, double* dy, double* dist)
+    {
+        for(size_t k = 0; k < n; k++)
+        {
+            double vx = x[k] - px;
+            double vy = y[k] - py;
+            double sq = vx * vx;
+            sq = sq + vy * vy;
+            dx[k] = vx;
+            dy[k] = vy;
+            dist[k] = std::sqrt(sq);
+        }
+    }
+
+#ifdef MAF_X86_DISPATCH
+
+    // Note: multiply and add are kept separate (no fma), so that
+    // all variants produce bitwise the same results as blockScalar.
+
+    __attribute__((target("sse2")))
+    void blockSSE2(double px, double py, const double* x, const double* y, size_t n,
+                   double* dx, double* dy, double* dist)
+    {
+        const __m128d ppx = _mm_set1_pd(px);
+        const __m128d ppy = _mm_set1_pd(py);
+
+        size_t k = 0;
+        for(; k + 2 <= n; k += 2)
+        {
+            __m128d vx = _mm_sub_pd(_mm_loadu_pd(x + k), ppx);
+            __m128d vy = _mm_sub_pd(_mm_loadu_pd(y + k), ppy);
+            __m128d sq = _mm_add_pd(_mm_mul_pd(vx, vx), _mm_mul_pd(vy, vy));
+            _mm_storeu_pd(dx + k, vx);
+            _mm_storeu_pd(dy + k, vy);
+            _mm_storeu_pd(dist + k, _mm_sqrt_pd(sq));
+        }
+
+        blockScalar(px, py, x + k, y + k, n - k, dx + k, dy + k, dist + k);
+    }
+
+    __attribute__((target("avx2")))
+    void blockAVX2(double px, double py, const double* x, const double* y, size_t n,
+                   double* dx, double* dy, double* dist)
+    {
+        const __m256d ppx = _mm256_set1_pd(px);
+        const __m256d ppy = _mm256_set1_pd(py);
+
+        size_t k = 0;
+        for(; k + 4 <= n; k += 4)
+        {
+            __m256d vx = _mm256_sub_pd(_mm256_loadu_pd(x + k), ppx);
+            __m256d vy = _mm256_sub_pd(_mm256_loadu_pd(y + k), ppy);
+            __m256d sq = _mm256_add_pd(_mm256_mul_pd(vx, vx), _mm256_mul_pd(vy, vy));
+            _mm256_storeu_pd(dx + k, vx);
+            _mm256_storeu_pd(dy + k, vy);
+            _mm256_storeu_pd(dist + k, _mm256_sqrt_pd(sq));
+        }
+
+        blockSSE2(px, py, x + k, y + k, n - k, dx + k, dy + k, dist + k);
+    }
+
+    __attribute__((target("avx512f")))
+    void blockAVX512(double px, double py, const double* x, const double* y, size_t n,
+                     double* dx, double* dy, double* dist)
+    {
+        const __m512d ppx = _mm512_set1_pd(px);
+        const __m512d ppy = _mm512_set1_pd(py);
+
+        size_t k = 0;
+        for(; k + 8 <= n; k += 8)
+        {
+            __m512d vx = _mm512_sub_pd(_mm512_loadu_pd(x + k), ppx);
+            __m512d vy = _mm512_sub_pd(_mm512_loadu_pd(y + k), ppy);
+            __m512d sq = _mm512_add_pd(_mm512_mul_pd(vx, vx), _mm512_mul_pd(vy, vy));
+            _mm512_storeu_pd(dx + k, vx);
+            _mm512_storeu_pd(dy + k, vy);
+            _mm512_storeu_pd(dist + k, _mm512_sqrt_pd(sq));
+        }
+
+        blockAVX2(px, py, x + k, y + k, n - k, dx + k, dy + k, dist + k);
+    }
+
+#endif
+
+    BlockFunction functionForIsa(DistanceKernel::Isa isa)
+    {
+#ifdef MAF_X86_DISPATCH
+        switch(isa)
+        {
+        case DistanceKernel::AVX512:
+            return blockAVX512;
+        case DistanceKernel::AVX2:
+            return blockAVX2;
+        case DistanceKernel::SSE2:
+            return blockSSE2;
+        default:
+            break;
+        }
+#endif
+        (void)isa;
+        return blockScalar;
+    }
+
+    std::atomic<DistanceKernel::Isa> s_activeIsa(DistanceKernel::detectIsa());
+    std::atomic<BlockFunction> s_blockFunction(functionForIsa(s_activeIsa));
+}
+
+DistanceKernel::Isa DistanceKernel::detectIsa()
+{
+#ifdef MAF_X86_DISPATCH
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return AVX512;
+    if(__builtin_cpu_supports("avx2"))
+        return AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return SSE2;
+#endif
+    return Scalar;
+}
+
+DistanceKernel::Isa DistanceKernel::activeIsa()
+{
+    return s_activeIsa;
+}
+
+DistanceKernel::Isa DistanceKernel::setIsa(Isa isa)
+{
+    Isa chosen = std::min(isa, detectIsa());
+    s_activeIsa = chosen;
+    s_blockFunction = functionForIsa(chosen);
+    return chosen;
+}
+
+void DistanceKernel::computeBlock(double px, double py, const double* x, const double* y, size_t n,
+                                  double* dx, double* dy, double* dist)
+{
+    s_blockFunction.load(std::memory_order_relaxed)(px, py, x, y, n, dx, dy, dist);
+}
@@ -24,6 +24,7 @@
 #include <iostream>
 
 #include "environment.h"
+#include "distance_kernel.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -33,8 +34,9 @@ std::shared_ptr<Environment> Environment::createEnvironment(unsigned int id)
     return std::shared_ptr<Environment>(new Environment(id));
 }
 
-Environment::Environment(unsigned int id) : m_id(id), m_enableLogMessages(true)
+Environment::Environment(unsigned int id) : m_id(id), m_enableLogMessages(true), m_logLevel(LogLevel::Info), m_useMessageArena(true)
 {
+    m_randomService = RandomService::createRandomService(0, id);
 
 }
 
@@ -50,6 +52,9 @@ unsigned int Environment::id() const
 
 void Environment::update(double time)
 {
+    // the messages of the previous steps are delivered -> reuse their memory
+    m_messageArena.reset();
+
     // update the distance map -> agent move will access this map further down
     computeDistances();
 
@@ -60,9 +65,37 @@ void Environment::update(double time)
     });
 }
 
+void Environment::reset()
+{
+    m_agents.clear();
+    m_agentDistanceMap.clear();
+    m_messageListeners.clear();
+
+    // keep the mailboxes, agents of the next run often have the same ids
+    for(auto& [id, messages]: m_msgMap)
+    {
+        while(!messages.empty())
+        {
+            messages.pop();
+        }
+    }
+    m_messageArena.reset();
+
+    m_enabledAgents.clear();
+    m_posX.clear();
+    m_posY.clear();
+}
+
 void Environment::addAgent(std::shared_ptr<Agent> a)
 {
     m_agents.push_back(a);
+
+    // message queues exist before agents send concurrently
+    m_msgMap[a->id()];
+    for(const auto& sa: a->getAllSubAgents())
+    {
+        m_msgMap[sa->id()];
+    }
 }
 
 std::list<std::shared_ptr<Agent> > Environment::getAgents()
@@ -99,29 +132,43 @@ void Environment::computeDistances()
 {
     m_agentDistanceMap.clear();
 
-    const auto& agents = getAgents();
+    // Only consider enabled agents. Positions are gathered as SoA
+    // arrays, so that the distance kernel can vectorise.
+    m_enabledAgents.clear();
+    m_posX.clear();
+    m_posY.clear();
+    for(const auto& a: getAgents())
+    {
+        if(a->getEnabled())
+        {
+            m_enabledAgents.push_back(a.get());
+            m_posX.push_back(a->getPosition().x());
+            m_posY.push_back(a->getPosition().y());
+        }
+    }
+
+    size_t n = m_enabledAgents.size();
+    m_distX.resize(n);
+    m_distY.resize(n);
+    m_dist.resize(n);
 
     // O( n * log(n) )
-    for(auto fromA = agents.begin(); fromA != agents.end(); fromA++)
+    for(size_t i = 0; i < n; i++)
     {
-        const auto& agentA = *fromA;
+        // distances from agent i to all following agents
+        size_t nBlock = n - i - 1;
+        DistanceKernel::computeBlock(m_posX[i], m_posY[i], m_posX.data() + i + 1, m_posY.data() + i + 1, nBlock,
+                                     m_distX.data(), m_distY.data(), m_dist.data());
 
-        if(agentA->getEnabled()) // Only consider enabled agents
+        unsigned int idA = m_enabledAgents[i]->id();
+        for(size_t k = 0; k < nBlock; k++)
         {
-            for(auto toA = std::next(fromA,1); toA != agents.end(); toA++)
-            {
-                const auto& agentB = *toA;
-
-                if(agentB->getEnabled())
-                {
-                    Eigen::Vector2d vDiff = Environment::computeDistance(agentA, agentB);
-                    double vLength = vDiff.norm();
-
-                    // extend matrix with distances in both direction
-                    m_agentDistanceMap[agentA->id()].push({vLength, agentB->id(), vDiff});
-                    m_agentDistanceMap[agentB->id()].push({vLength, agentA->id(), -vDiff});
-                }
-            }
+            unsigned int idB = m_enabledAgents[i + 1 + k]->id();
+            Eigen::Vector2d vDiff(m_distX[k], m_distY[k]);
+
+            // extend matrix with distances in both direction
+            m_agentDistanceMap[idA].push({m_dist[k], idB, vDiff});
+            m_agentDistanceMap[idB].push({m_dist[k], idA, -vDiff});
         }
     }
 }
@@ -136,11 +183,60 @@ void Environment::setEnableLogMessages(bool enable)
     m_enableLogMessages = enable;
 }
 
+bool Environment::logEnabled(LogLevel level) const
+{
+    return MafLog::compiledIn(level) && m_enableLogMessages && level >= m_logLevel;
+}
+
+void Environment::setLogLevel(LogLevel level)
+{
+    m_logLevel = level;
+}
+
+LogLevel Environment::logLevel() const
+{
+    return m_logLevel;
+}
+
+void Environment::setLogger(std::shared_ptr<AsyncLogger> logger)
+{
+    m_logger = logger;
+}
+
+void Environment::setEventLog(std::shared_ptr<EventLog> eventLog)
+{
+    m_eventLog = eventLog;
+}
+
+void Environment::recordEvent(EventKind kind, unsigned int senderId, unsigned int receiverId,
+                              std::initializer_list<double> doubleParams, std::initializer_list<int> intParams)
+{
+    if(m_eventLog)
+    {
+        m_eventLog->appendEvent(kind, senderId, receiverId, doubleParams, intParams);
+    }
+}
+
 void Environment::addMessageListener(std::weak_ptr<MessageListener> listener)
 {
     m_messageListeners.push_back(listener);
 }
 
+void Environment::setRandomService(std::shared_ptr<RandomService> service)
+{
+    m_randomService = service;
+}
+
+std::shared_ptr<RandomService> Environment::getRandomService() const
+{
+    return m_randomService;
+}
+
+RandomStream Environment::getRandomStream(unsigned int agentId)
+{
+    return m_randomService->getAgentStream(agentId);
+}
+
 EnvironmentInterface::MessageQueue &Environment::getMessages(unsigned int receiverAgendId)
 {
     return m_msgMap[receiverAgendId];
@@ -149,8 +245,28 @@ EnvironmentInterface::MessageQueue &Environment::getMessages(unsigned int receiv
 void Environment::sendMessage(std::shared_ptr<Message> aMessage)
 {
     m_msgMap[aMessage->receiverId()].push(aMessage);
+    notifyMessage(aMessage);
+}
+
+MessageArena *Environment::messageArena()
+{
+    return m_useMessageArena ? &m_messageArena : nullptr;
+}
+
+void Environment::setUseMessageArena(bool use)
+{
+    m_useMessageArena = use;
+}
+
+void Environment::notifyMessage(std::shared_ptr<Message> aMessage)
+{
     log(aMessage);
 
+    if(m_eventLog)
+    {
+        m_eventLog->append(*aMessage);
+    }
+
     // forward message to each listener
     for(std::weak_ptr<MessageListener>& listener: m_messageListeners)
     {
@@ -160,15 +276,39 @@ void Environment::sendMessage(std::shared_ptr<Message> aMessage)
 
 void Environment::log(std::shared_ptr<Message> aMessage)
 {
-    log("Message: " + aMessage->toString());
+    // nothing is formatted if messages are not logged
+    if(!logEnabled(LogLevel::Info))
+    {
+        return;
+    }
+
+    if(m_logger)
+    {
+        m_logger->logMessage(*aMessage);
+        return;
+    }
+
+    log(LogLevel::Info, "Message: " + aMessage->toString());
 }
 
 
 void Environment::log(const std::string &logMsg)
 {
-    if(m_enableLogMessages)
+    log(LogLevel::Info, logMsg);
+}
+
+void Environment::log(LogLevel level, const std::string &logMsg)
+{
+    if(logEnabled(level))
     {
-        std::cout << logMsg << std::endl;
+        if(m_logger)
+        {
+            m_logger->log(logMsg);
+        }
+        else
+        {
+            std::cout << logMsg << std::endl;
+        }
     }
 }
 
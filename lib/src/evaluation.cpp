@@ -44,6 +44,11 @@ std::string Evaluation::getResult()
     return "";
 }
 
+Evaluation::ResultValues Evaluation::getResultValues()
+{
+    return {};
+}
+
 bool Evaluation::isSimulationFinished(std::shared_ptr<Simulation> /*sim*/)
 {
     return false;
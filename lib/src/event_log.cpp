@@ -0,0 +1,336 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <cstring>
+
+#include "event_log.h"
+
+#if defined(__unix__)
+#define MAF_EVENT_LOG_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    const char EventLogMagic[4] = {'M', 'A', 'F', 'E'};
+    const uint32_t EventLogVersion = 2;
+    const size_t FileHeaderSize = sizeof(EventLogMagic) + sizeof(EventLogVersion);
+    const size_t RecordAlignment = 8;
+
+    static_assert(sizeof(EventLog::Record) == 32, "record layout is part of the file format");
+    static_assert(FileHeaderSize % RecordAlignment == 0, "records must stay aligned");
+
+    template<typename T>
+    void writeValue(std::ofstream& f, const T& value)
+    {
+        f.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    size_t padded(size_t size)
+    {
+        return (size + RecordAlignment - 1) / RecordAlignment * RecordAlignment;
+    }
+}
+
+std::shared_ptr<EventLog> EventLog::createEventLog(const std::string &path)
+{
+    return std::shared_ptr<EventLog>(new EventLog(path));
+}
+
+EventLog::EventLog(const std::string &path) : m_file(path, std::ios::binary), m_time(0.0), m_nbrOfEvents(0)
+{
+    m_file.write(EventLogMagic, sizeof(EventLogMagic));
+    writeValue(m_file, EventLogVersion);
+}
+
+bool EventLog::isOpen() const
+{
+    return m_file.is_open();
+}
+
+void EventLog::setTime(double time)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_time = time;
+}
+
+void EventLog::append(const Message &aMessage)
+{
+    const size_t maxCount = std::numeric_limits<uint16_t>::max();
+
+    // the payload of a message is not necessarily stored as arrays
+    thread_local std::vector<double> doubles;
+    thread_local std::vector<int32_t> ints;
+    doubles.resize(std::min(aMessage.numberOfDoubleParams(), maxCount));
+    ints.resize(std::min(aMessage.numberOfIntParams(), maxCount));
+    for(size_t i = 0; i < doubles.size(); i++)
+    {
+        doubles[i] = aMessage.doubleParam(i);
+    }
+    for(size_t i = 0; i < ints.size(); i++)
+    {
+        ints[i] = aMessage.intParam(i);
+    }
+
+    Record r;
+    r.kind = static_cast<uint16_t>(EventKind::MessageEvent);
+    r.subject = static_cast<uint16_t>(aMessage.subject());
+    r.senderId = aMessage.senderId();
+    r.receiverId = aMessage.receiverId();
+    r.nbrOfDoubles = static_cast<uint16_t>(doubles.size());
+    r.nbrOfInts = static_cast<uint16_t>(ints.size());
+    writeRecord(r, doubles.data(), ints.data(), aMessage.textView());
+}
+
+void EventLog::appendEvent(EventKind kind, unsigned int senderId, unsigned int receiverId,
+                           std::initializer_list<double> doubleParams, std::initializer_list<int> intParams)
+{
+    static_assert(sizeof(int) == sizeof(int32_t), "ints are stored with 32 bits");
+
+    Record r;
+    r.kind = static_cast<uint16_t>(kind);
+    r.subject = 0;
+    r.senderId = senderId;
+    r.receiverId = receiverId;
+    r.nbrOfDoubles = static_cast<uint16_t>(doubleParams.size());
+    r.nbrOfInts = static_cast<uint16_t>(intParams.size());
+    writeRecord(r, doubleParams.begin(), reinterpret_cast<const int32_t*>(intParams.begin()), std::string_view());
+}
+
+void EventLog::writeRecord(Record r, const double *doubles, const int32_t *ints, std::string_view text)
+{
+    r.textLength = static_cast<uint32_t>(text.size());
+    size_t payloadSize = r.nbrOfDoubles * sizeof(double) + r.nbrOfInts * sizeof(int32_t) + r.textLength;
+    r.size = static_cast<uint32_t>(padded(sizeof(Record) + payloadSize));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    r.time = m_time;
+    writeValue(m_file, r);
+    m_file.write(reinterpret_cast<const char*>(doubles), r.nbrOfDoubles * sizeof(double));
+    m_file.write(reinterpret_cast<const char*>(ints), r.nbrOfInts * sizeof(int32_t));
+    m_file.write(text.data(), text.size());
+
+    const char padding[RecordAlignment] = {};
+    m_file.write(padding, r.size - sizeof(Record) - payloadSize);
+    m_nbrOfEvents++;
+}
+
+size_t EventLog::numberOfEvents() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nbrOfEvents;
+}
+
+void EventLog::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.flush();
+}
+
+EventLog::Record EventLogReader::Event::header() const
+{
+    EventLog::Record r;
+    std::memcpy(&r, m_record, sizeof(r));
+    return r;
+}
+
+double EventLogReader::Event::time() const
+{
+    return header().time;
+}
+
+EventKind EventLogReader::Event::kind() const
+{
+    return static_cast<EventKind>(header().kind);
+}
+
+unsigned int EventLogReader::Event::senderId() const
+{
+    return header().senderId;
+}
+
+unsigned int EventLogReader::Event::receiverId() const
+{
+    return header().receiverId;
+}
+
+Message::Subject EventLogReader::Event::subject() const
+{
+    return static_cast<Message::Subject>(header().subject);
+}
+
+size_t EventLogReader::Event::numberOfDoubleParams() const
+{
+    return header().nbrOfDoubles;
+}
+
+double EventLogReader::Event::doubleParam(size_t index) const
+{
+    double value;
+    std::memcpy(&value, m_record + sizeof(EventLog::Record) + index * sizeof(double), sizeof(double));
+    return value;
+}
+
+size_t EventLogReader::Event::numberOfIntParams() const
+{
+    return header().nbrOfInts;
+}
+
+int EventLogReader::Event::intParam(size_t index) const
+{
+    int32_t value;
+    std::memcpy(&value, m_record + sizeof(EventLog::Record) + numberOfDoubleParams() * sizeof(double) + index * sizeof(int32_t),
+                sizeof(int32_t));
+    return value;
+}
+
+std::string_view EventLogReader::Event::textView() const
+{
+    EventLog::Record r = header();
+    const char* text = reinterpret_cast<const char*>(m_record + sizeof(EventLog::Record) + r.nbrOfDoubles * sizeof(double) +
+                                                     r.nbrOfInts * sizeof(int32_t));
+    return std::string_view(text, r.textLength);
+}
+
+size_t EventLogReader::Event::recordSize() const
+{
+    return header().size;
+}
+
+std::shared_ptr<EventLogReader> EventLogReader::createEventLogReader(const std::string &path)
+{
+    return std::shared_ptr<EventLogReader>(new EventLogReader(path));
+}
+
+EventLogReader::EventLogReader(const std::string &path) : m_map(nullptr), m_mapSize(0),
+    m_begin(nullptr), m_end(nullptr), m_nbrOfEvents(0)
+{
+    const unsigned char* data = nullptr;
+    size_t dataSize = 0;
+
+#ifdef MAF_EVENT_LOG_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return;
+    }
+
+    struct stat st;
+    if(::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= FileHeaderSize)
+    {
+        void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED)
+        {
+            m_map = map;
+            m_mapSize = st.st_size;
+            ::madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+            data = static_cast<const unsigned char*>(m_map);
+            dataSize = m_mapSize;
+        }
+    }
+    ::close(fd);
+#else
+    // no memory mapping: read the whole file
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if(f.is_open() && static_cast<size_t>(f.tellg()) >= FileHeaderSize)
+    {
+        m_buffer.resize(static_cast<size_t>(f.tellg()));
+        f.seekg(0);
+        if(f.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size()))
+        {
+            data = m_buffer.data();
+            dataSize = m_buffer.size();
+        }
+    }
+#endif
+
+    if(!data)
+    {
+        return;
+    }
+
+    uint32_t version;
+    std::memcpy(&version, data + sizeof(EventLogMagic), sizeof(version));
+    if(std::memcmp(data, EventLogMagic, sizeof(EventLogMagic)) != 0 || version != EventLogVersion)
+    {
+        return;
+    }
+
+    // find the end of the complete records, only their headers are read
+    const unsigned char* pos = data + FileHeaderSize;
+    const unsigned char* fileEnd = data + dataSize;
+    while(static_cast<size_t>(fileEnd - pos) >= sizeof(EventLog::Record))
+    {
+        EventLog::Record r;
+        std::memcpy(&r, pos, sizeof(r));
+
+        // the payload must lie within the record, the record within the file
+        uint64_t payloadSize = uint64_t(r.nbrOfDoubles) * sizeof(double) + uint64_t(r.nbrOfInts) * sizeof(int32_t) + r.textLength;
+        size_t size = r.size;
+        if(size < sizeof(EventLog::Record) || size % RecordAlignment != 0 || size > static_cast<size_t>(fileEnd - pos) ||
+           sizeof(EventLog::Record) + payloadSize > size)
+        {
+            break;
+        }
+        pos += size;
+        m_nbrOfEvents++;
+    }
+
+    m_begin = data + FileHeaderSize;
+    m_end = pos;
+}
+
+EventLogReader::~EventLogReader()
+{
+#ifdef MAF_EVENT_LOG_MMAP
+    if(m_map)
+    {
+        ::munmap(m_map, m_mapSize);
+    }
+#endif
+}
+
+bool EventLogReader::isOpen() const
+{
+    return m_begin != nullptr;
+}
+
+size_t EventLogReader::numberOfEvents() const
+{
+    return m_nbrOfEvents;
+}
+
+EventLogReader::Iterator EventLogReader::begin() const
+{
+    return Iterator(m_begin);
+}
+
+EventLogReader::Iterator EventLogReader::end() const
+{
+    return Iterator(m_end);
+}
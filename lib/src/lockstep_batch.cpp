@@ -0,0 +1,726 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <typeinfo>
+
+#include "lockstep_batch.h"
+#include "plane.h"
+#include "target.h"
+#include "missile_station.h"
+
+namespace
+{
+    // same arithmetic as MafHlp::correctVectorScale and MafHlp::adjustVectorScale
+    inline double length(double x, double y)
+    {
+        double sq = x * x;
+        sq = sq + y * y;
+        return std::sqrt(sq);
+    }
+
+    inline void correctScale(double& x, double& y, double maxMagnitude)
+    {
+        double len = length(x, y);
+        if( len > 1.0e-10 && len > maxMagnitude )
+        {
+            x = (x / len) * maxMagnitude;
+            y = (y / len) * maxMagnitude;
+        }
+    }
+
+    inline void adjustScale(double& x, double& y, double magnitude)
+    {
+        double len = length(x, y);
+        if( len > 1.0e-10 )
+        {
+            x = (x / len) * magnitude;
+            y = (y / len) * magnitude;
+        }
+    }
+}
+
+std::shared_ptr<LockstepBatch> LockstepBatch::createLockstepBatch()
+{
+    return std::shared_ptr<LockstepBatch>(new LockstepBatch());
+}
+
+LockstepBatch::LockstepBatch() : m_nRuns(0), m_started(false)
+{
+
+}
+
+bool LockstepBatch::addRun(std::shared_ptr<Simulation> sim)
+{
+    if(m_started)
+    {
+        return false;
+    }
+
+    // create the agents like Simulation::initAgents
+    auto factory = sim->agentFactory();
+    factory->setRandomStream(sim->getRandomService()->getStream(RandomService::FactoryDomain, 0));
+    auto agents = factory->createAgents();
+
+    std::vector<AgentSlot> slots;
+    std::vector<std::shared_ptr<Agent>> flat;
+    if(!describeAgents(agents, slots, flat))
+    {
+        return false;
+    }
+
+    if(m_runAgents.empty())
+    {
+        // the first run defines the structure
+        m_agents = slots;
+        m_agentIndex.clear();
+        m_updateOrder.clear();
+        m_sensors.clear();
+        m_ignored.clear();
+        m_stations.clear();
+        m_missiles.clear();
+
+        for(size_t a = 0; a < m_agents.size(); a++)
+        {
+            AgentSlot& slot = m_agents[a];
+            m_agentIndex[slot.id] = a;
+            switch(slot.kind)
+            {
+            case Sensor:
+                slot.kindIndex = m_sensors.size();
+                m_sensors.push_back(a);
+                break;
+            case Station:
+                slot.kindIndex = m_stations.size();
+                m_stations.push_back(StationSlot{a + 1, {}});
+                break;
+            case Rocket:
+                slot.kindIndex = m_missiles.size();
+                m_missiles.push_back(a);
+                break;
+            default:
+                slot.kindIndex = 0;
+                break;
+            }
+        }
+
+        // sub agents of a station follow it: the sensor, then the missiles
+        for(size_t a = 0; a < m_agents.size(); a++)
+        {
+            if(m_agents[a].kind == Station)
+            {
+                StationSlot& station = m_stations[m_agents[a].kindIndex];
+                size_t nSub = flat[a]->getSubAgents().size();
+                for(size_t k = 2; k <= nSub; k++)
+                {
+                    station.missiles.push_back(a + k);
+                }
+            }
+        }
+
+        // like Environment::update: top level agents in order, sub agents first
+        for(size_t a = 0; a < m_agents.size(); )
+        {
+            size_t nSub = flat[a]->getSubAgents().size();
+            for(size_t k = 1; k <= nSub; k++)
+            {
+                m_updateOrder.push_back({a + k, false});
+            }
+            m_updateOrder.push_back({a, m_agents[a].kind == Station});
+            a += nSub + 1;
+        }
+
+        for(size_t s: m_sensors)
+        {
+            auto sensor = std::static_pointer_cast<ProximitySensor>(flat[s]);
+            std::vector<bool> ignored(m_agents.size(), false);
+            for(unsigned int id: sensor->ignoredAgentIds())
+            {
+                auto it = m_agentIndex.find(id);
+                if(it != m_agentIndex.end())
+                {
+                    ignored[it->second] = true;
+                }
+            }
+            m_ignored.push_back(ignored);
+        }
+    }
+    else
+    {
+        // all runs have the same agents
+        if(slots.size() != m_agents.size())
+        {
+            return false;
+        }
+        for(size_t a = 0; a < slots.size(); a++)
+        {
+            if(slots[a].id != m_agents[a].id || slots[a].type != m_agents[a].type)
+            {
+                return false;
+            }
+        }
+        for(size_t si = 0; si < m_sensors.size(); si++)
+        {
+            auto sensor = std::static_pointer_cast<ProximitySensor>(flat[m_sensors[si]]);
+            std::vector<bool> ignored(m_agents.size(), false);
+            for(unsigned int id: sensor->ignoredAgentIds())
+            {
+                auto it = m_agentIndex.find(id);
+                if(it != m_agentIndex.end())
+                {
+                    ignored[it->second] = true;
+                }
+            }
+            if(ignored != m_ignored[si])
+            {
+                return false;
+            }
+        }
+    }
+
+    m_runAgents.push_back(flat);
+    m_simulationIds.push_back(sim->id());
+    build();
+    return true;
+}
+
+bool LockstepBatch::describeAgents(const std::list<std::shared_ptr<Agent>> &agents, std::vector<AgentSlot> &slots,
+                                   std::vector<std::shared_ptr<Agent>> &flat) const
+{
+    auto kindOf = [](const std::shared_ptr<Agent>& a, Kind& kind)
+    {
+        // exact classes only, derived classes may behave differently
+        const std::type_info& t = typeid(*a);
+        if(t == typeid(Agent) || t == typeid(Plane) || t == typeid(HostilePlane))
+            kind = Mover;
+        else if(t == typeid(ProximitySensor) || t == typeid(Target))
+            kind = Sensor;
+        else if(t == typeid(MissileStation))
+            kind = Station;
+        else if(t == typeid(Missile))
+            kind = Rocket;
+        else
+            return false;
+
+        return a->getActiveObjective() == nullptr;
+    };
+
+    for(const auto& a: agents)
+    {
+        Kind kind;
+        if(!kindOf(a, kind))
+        {
+            return false;
+        }
+        slots.push_back(AgentSlot{a->id(), a->type(), kind, 0});
+        flat.push_back(a);
+
+        auto& subAgents = a->getSubAgents();
+        if(kind != Station)
+        {
+            if(!subAgents.empty())
+            {
+                return false;
+            }
+            continue;
+        }
+
+        // a station as constructed: its sensor and the missiles not yet fired
+        auto station = std::static_pointer_cast<MissileStation>(a);
+        if(subAgents.empty() || station->numberOfMissiles() != subAgents.size() - 1)
+        {
+            return false;
+        }
+
+        bool first = true;
+        for(const auto& sa: subAgents)
+        {
+            Kind subKind;
+            if(!kindOf(sa, subKind) || subKind != (first ? Sensor : Rocket) || !sa->getSubAgents().empty())
+            {
+                return false;
+            }
+            if(subKind == Rocket && std::static_pointer_cast<Missile>(sa)->status() != Missile::Idle)
+            {
+                return false;
+            }
+
+            slots.push_back(AgentSlot{sa->id(), sa->type(), subKind, 0});
+            flat.push_back(sa);
+            first = false;
+        }
+    }
+
+    return true;
+}
+
+void LockstepBatch::build()
+{
+    m_nRuns = m_runAgents.size();
+    size_t nAgents = m_agents.size();
+    size_t n = nAgents * m_nRuns;
+
+    m_runningTime.assign(m_nRuns, 0.0);
+    m_active.assign(m_nRuns, 0);
+    m_finished.assign(m_nRuns, 0);
+
+    m_posX.resize(n);
+    m_posY.resize(n);
+    m_velX.resize(n);
+    m_velY.resize(n);
+    m_accX.resize(n);
+    m_accY.resize(n);
+    m_maxSpeed.resize(n);
+    m_enabled.resize(n);
+    m_inDistanceMap.assign(n, 0);
+    m_startX.resize(n);
+    m_startY.resize(n);
+    m_message.assign(n, NoMessage);
+
+    for(size_t a = 0; a < nAgents; a++)
+    {
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            const auto& agent = m_runAgents[r][a];
+            size_t idx = at(a, r);
+            m_posX[idx] = agent->getPosition().x();
+            m_posY[idx] = agent->getPosition().y();
+            m_velX[idx] = agent->getVelocity().x();
+            m_velY[idx] = agent->getVelocity().y();
+            m_accX[idx] = agent->getAcceleration().x();
+            m_accY[idx] = agent->getAcceleration().y();
+            m_maxSpeed[idx] = agent->velocityLimit();
+            m_enabled[idx] = agent->getEnabled();
+        }
+    }
+
+    m_range.resize(m_sensors.size() * m_nRuns);
+    m_inRange.assign(m_sensors.size() * m_nRuns, {});
+    for(size_t si = 0; si < m_sensors.size(); si++)
+    {
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            m_range[si * m_nRuns + r] = std::static_pointer_cast<ProximitySensor>(m_runAgents[r][m_sensors[si]])->range();
+        }
+    }
+
+    size_t nm = m_missiles.size() * m_nRuns;
+    m_missileStatus.assign(nm, Missile::Idle);
+    m_missileTarget.assign(nm, NoAgent);
+    m_targetBeforeX.assign(nm, 0.0);
+    m_targetBeforeY.assign(nm, 0.0);
+    m_targetBeforeAvailable.assign(nm, 0);
+
+    m_targeted.assign(m_stations.size() * n, 0);
+    m_nextMissile.assign(m_stations.size() * m_nRuns, 0);
+
+    m_dx.resize(m_nRuns);
+    m_dy.resize(m_nRuns);
+    m_dist.resize(m_nRuns);
+}
+
+size_t LockstepBatch::at(size_t agent, size_t run) const
+{
+    return agent * m_nRuns + run;
+}
+
+void LockstepBatch::setEvaluation(std::shared_ptr<BatchEvaluation> evaluation)
+{
+    m_evaluation = evaluation;
+}
+
+std::shared_ptr<BatchEvaluation> LockstepBatch::getEvaluation() const
+{
+    return m_evaluation;
+}
+
+void LockstepBatch::run(double timeStep, double duration)
+{
+    while(true)
+    {
+        bool any = false;
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            m_active[r] = m_runningTime[r] < duration;
+            any = any || m_active[r];
+        }
+
+        if(!any)
+        {
+            break;
+        }
+        step(timeStep);
+    }
+}
+
+void LockstepBatch::runUntilFinished(double timeStep, double maxDuration)
+{
+    while(true)
+    {
+        bool any = false;
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            if(!m_finished[r] && m_evaluation && m_evaluation->isRunFinished(*this, r))
+            {
+                m_finished[r] = 1;
+            }
+            m_active[r] = !m_finished[r] && m_runningTime[r] < maxDuration;
+            any = any || m_active[r];
+        }
+
+        if(!any)
+        {
+            break;
+        }
+        step(timeStep);
+    }
+}
+
+void LockstepBatch::step(double timeStep)
+{
+    if(!m_started)
+    {
+        // the arrays hold the state from now on
+        m_started = true;
+        m_runAgents.clear();
+    }
+
+    for(size_t r = 0; r < m_nRuns; r++)
+    {
+        if(m_active[r])
+        {
+            m_runningTime[r] += timeStep;
+        }
+    }
+
+    // the distance map of Environment::computeDistances: enabled agents at their positions
+    // when the step begins, missiles only when launched
+    for(size_t a = 0; a < m_agents.size(); a++)
+    {
+        const AgentSlot& slot = m_agents[a];
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            size_t idx = at(a, r);
+            m_inDistanceMap[idx] = slot.kind == Rocket ? m_missileStatus[slot.kindIndex * m_nRuns + r] == Missile::Launched
+                                                       : m_enabled[idx];
+        }
+    }
+    m_startX = m_posX;
+    m_startY = m_posY;
+
+    // sensors only read the distance map -> all at once
+    senseAll();
+
+    for(const auto& [agent, fire]: m_updateOrder)
+    {
+        if(fire)
+        {
+            updateStation(agent);
+            continue;
+        }
+
+        switch(m_agents[agent].kind)
+        {
+        case Mover:
+            updateMover(agent, timeStep);
+            break;
+        case Rocket:
+            updateMissile(agent, timeStep);
+            break;
+        case Sensor:
+            for(size_t r = 0; r < m_nRuns; r++)
+            {
+                if(m_active[r])
+                {
+                    move(at(agent, r), timeStep);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if(m_evaluation)
+    {
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            if(m_active[r])
+            {
+                m_evaluation->evaluate(*this, r, timeStep);
+            }
+        }
+    }
+}
+
+void LockstepBatch::senseAll()
+{
+    for(size_t si = 0; si < m_sensors.size(); si++)
+    {
+        size_t s = m_sensors[si];
+        const double* sx = m_posX.data() + at(s, 0);
+        const double* sy = m_posY.data() + at(s, 0);
+        const double* range = m_range.data() + si * m_nRuns;
+        auto* inRange = m_inRange.data() + si * m_nRuns;
+
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            inRange[r].clear();
+        }
+
+        for(size_t j = 0; j < m_agents.size(); j++)
+        {
+            if(j == s || m_ignored[si][j])
+            {
+                continue;
+            }
+
+            // distances of agent j to the sensor in all runs
+            const double* x = m_posX.data() + at(j, 0);
+            const double* y = m_posY.data() + at(j, 0);
+            for(size_t r = 0; r < m_nRuns; r++)
+            {
+                double vx = x[r] - sx[r];
+                double vy = y[r] - sy[r];
+                double sq = vx * vx;
+                sq = sq + vy * vy;
+                m_dx[r] = vx;
+                m_dy[r] = vy;
+                m_dist[r] = std::sqrt(sq);
+            }
+
+            const char* sensorInMap = m_inDistanceMap.data() + at(s, 0);
+            const char* inMap = m_inDistanceMap.data() + at(j, 0);
+            for(size_t r = 0; r < m_nRuns; r++)
+            {
+                if(m_active[r] && sensorInMap[r] && inMap[r] && m_dist[r] < range[r])
+                {
+                    inRange[r].push_back({m_dist[r], m_agents[j].id, Eigen::Vector2d(m_dx[r], m_dy[r])});
+                }
+            }
+        }
+
+        for(size_t r = 0; r < m_nRuns; r++)
+        {
+            std::stable_sort(inRange[r].begin(), inRange[r].end(), [](const EnvironmentInterface::Distance& a,
+                                                                        const EnvironmentInterface::Distance& b)
+            {
+                return a.dist < b.dist;
+            });
+        }
+    }
+}
+
+void LockstepBatch::move(size_t idx, double timeStep)
+{
+    // Agent::performMove in open space
+    double vx = m_velX[idx] + m_accX[idx] * timeStep;
+    double vy = m_velY[idx] + m_accY[idx] * timeStep;
+    correctScale(vx, vy, m_maxSpeed[idx]);
+
+    m_posX[idx] = m_posX[idx] + ((m_velX[idx] + vx) / 2.0) * timeStep;
+    m_posY[idx] = m_posY[idx] + ((m_velY[idx] + vy) / 2.0) * timeStep;
+
+    correctScale(vx, vy, m_maxSpeed[idx]);
+    m_velX[idx] = vx;
+    m_velY[idx] = vy;
+}
+
+void LockstepBatch::updateMover(size_t agent, double timeStep)
+{
+    for(size_t r = 0; r < m_nRuns; r++)
+    {
+        if(!m_active[r])
+        {
+            continue;
+        }
+
+        size_t idx = at(agent, r);
+        if(m_message[idx] == DisableMessage)
+        {
+            m_enabled[idx] = 0;
+            m_message[idx] = NoMessage;
+        }
+
+        if(m_enabled[idx])
+        {
+            move(idx, timeStep);
+        }
+    }
+}
+
+void LockstepBatch::updateMissile(size_t agent, double timeStep)
+{
+    size_t mi = m_agents[agent].kindIndex;
+    for(size_t r = 0; r < m_nRuns; r++)
+    {
+        if(!m_active[r])
+        {
+            continue;
+        }
+
+        size_t idx = at(agent, r);
+        size_t m = mi * m_nRuns + r;
+        size_t target = m_missileTarget[m];
+
+        // see Missile::update
+        if(m_missileStatus[m] == Missile::Launched && target != NoAgent && target != agent &&
+                m_inDistanceMap[idx] && m_inDistanceMap[at(target, r)])
+        {
+            size_t tIdx = at(target, r);
+            double dx = m_startX[tIdx] - m_startX[idx];
+            double dy = m_startY[tIdx] - m_startY[idx];
+            double dist = length(dx, dy);
+            double maxSpeed = m_maxSpeed[idx];
+
+            double dirX = dx;
+            double dirY = dy;
+            double targetX = m_posX[idx] + dx;
+            double targetY = m_posY[idx] + dy;
+            if(m_targetBeforeAvailable[m])
+            {
+                double targetVelX = (targetX - m_targetBeforeX[m]) / timeStep;
+                double targetVelY = (targetY - m_targetBeforeY[m]) / timeStep;
+                double timeToReach = dist / maxSpeed;
+                dirX = (targetX + targetVelX * timeToReach * 0.5) - m_posX[idx];
+                dirY = (targetY + targetVelY * timeToReach * 0.5) - m_posY[idx];
+            }
+            m_targetBeforeAvailable[m] = 1;
+            m_targetBeforeX[m] = targetX;
+            m_targetBeforeY[m] = targetY;
+
+            adjustScale(dirX, dirY, maxSpeed);
+            m_velX[idx] = dirX;
+            m_velY[idx] = dirY;
+
+            if(dist < timeStep * maxSpeed)
+            {
+                // only plain agents process messages, when they update next
+                if(m_agents[target].kind == Mover)
+                {
+                    m_message[tIdx] = DisableMessage;
+                }
+
+                m_missileStatus[m] = Missile::Detonated;
+                m_accX[idx] = 0.0;
+                m_accY[idx] = 0.0;
+                m_velX[idx] = 0.0;
+                m_velY[idx] = 0.0;
+            }
+        }
+
+        move(idx, timeStep);
+    }
+}
+
+void LockstepBatch::updateStation(size_t agent)
+{
+    size_t si = m_agents[agent].kindIndex;
+    const StationSlot& station = m_stations[si];
+    const auto* inRange = m_inRange.data() + m_agents[station.sensor].kindIndex * m_nRuns;
+    size_t nAgents = m_agents.size();
+
+    for(size_t r = 0; r < m_nRuns; r++)
+    {
+        if(!m_active[r])
+        {
+            continue;
+        }
+
+        // see MissileStation::update: fire at each new target while missiles are left
+        size_t& next = m_nextMissile[si * m_nRuns + r];
+        for(const auto& contact: inRange[r])
+        {
+            size_t j = m_agentIndex.at(contact.targetId);
+            char& targeted = m_targeted[(si * nAgents + j) * m_nRuns + r];
+            if(!targeted && next < station.missiles.size())
+            {
+                size_t m = m_agents[station.missiles[next++]].kindIndex * m_nRuns + r;
+                m_missileStatus[m] = Missile::Launched;
+                m_missileTarget[m] = j;
+                targeted = 1;
+            }
+        }
+    }
+}
+
+size_t LockstepBatch::numberOfRuns() const
+{
+    return m_nRuns;
+}
+
+size_t LockstepBatch::numberOfAgents() const
+{
+    return m_agents.size();
+}
+
+size_t LockstepBatch::agentIndex(unsigned int agentId) const
+{
+    auto it = m_agentIndex.find(agentId);
+    return it == m_agentIndex.end() ? NoAgent : it->second;
+}
+
+unsigned int LockstepBatch::agentId(size_t agent) const
+{
+    return m_agents[agent].id;
+}
+
+AgentType LockstepBatch::agentType(size_t agent) const
+{
+    return m_agents[agent].type;
+}
+
+bool LockstepBatch::enabled(size_t agent, size_t run) const
+{
+    if(m_agents[agent].kind == Rocket)
+    {
+        return m_missileStatus[m_agents[agent].kindIndex * m_nRuns + run] == Missile::Launched;
+    }
+    return m_enabled[at(agent, run)];
+}
+
+Eigen::Vector2d LockstepBatch::position(size_t agent, size_t run) const
+{
+    return Eigen::Vector2d(m_posX[at(agent, run)], m_posY[at(agent, run)]);
+}
+
+Eigen::Vector2d LockstepBatch::velocity(size_t agent, size_t run) const
+{
+    return Eigen::Vector2d(m_velX[at(agent, run)], m_velY[at(agent, run)]);
+}
+
+const std::vector<EnvironmentInterface::Distance> &LockstepBatch::agentsInSensorRange(size_t agent, size_t run) const
+{
+    return m_inRange[m_agents[agent].kindIndex * m_nRuns + run];
+}
+
+unsigned int LockstepBatch::simulationId(size_t run) const
+{
+    return m_simulationIds[run];
+}
+
+double LockstepBatch::runningTime(size_t run) const
+{
+    return m_runningTime[run];
+}
@@ -0,0 +1,276 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <cmath>
+#include <numeric>
+#include <limits>
+
+#include "lookahead_environment.h"
+#include "distance_kernel.h"
+
+std::shared_ptr<LookaheadEnvironment> LookaheadEnvironment::createLookaheadEnvironment(unsigned int id, double timeStep,
+                                                                                      double interactionRange, size_t nThreads)
+{
+    return std::shared_ptr<LookaheadEnvironment>(new LookaheadEnvironment(id, timeStep, interactionRange, nThreads));
+}
+
+LookaheadEnvironment::LookaheadEnvironment(unsigned int id, double timeStep, double interactionRange, size_t nThreads) :
+    TiledEnvironment(id, interactionRange, interactionRange, nThreads), m_timeStep(timeStep),
+    m_interactionRange(interactionRange)
+{
+
+}
+
+LookaheadEnvironment::~LookaheadEnvironment()
+{
+
+}
+
+double LookaheadEnvironment::timeStep() const
+{
+    return m_timeStep;
+}
+
+double LookaheadEnvironment::interactionRange() const
+{
+    return m_interactionRange;
+}
+
+size_t LookaheadEnvironment::numberOfLogicalProcesses() const
+{
+    return m_tiles.size();
+}
+
+double LookaheadEnvironment::speedBound(const Agent &a, double window)
+{
+    double speed = a.getVelocity().norm() + a.accelreationLimit() * window;
+    return std::min(a.velocityLimit(), speed);
+}
+
+void LookaheadEnvironment::buildLogicalProcesses(double window)
+{
+    m_tiles.clear();
+    m_tileIndex.clear();
+    m_lpMembers.clear();
+    m_lpOfAgent.clear();
+    m_slotOfAgent.clear();
+    m_slotDistances.clear();
+
+    // units are top level agents with their sub agents
+    std::vector<std::shared_ptr<Agent>> units(m_agents.begin(), m_agents.end());
+    std::vector<std::vector<Agent*>> unitMembers(units.size());
+    std::vector<double> unitBound(units.size(), 0.0);
+    double maxBound = 0.0;
+
+    for(size_t u = 0; u < units.size(); u++)
+    {
+        unitMembers[u].push_back(units[u].get());
+        for(const auto& sa: units[u]->getAllSubAgents())
+        {
+            unitMembers[u].push_back(sa.get());
+        }
+
+        for(Agent* m: unitMembers[u])
+        {
+            unitBound[u] = std::max(unitBound[u], speedBound(*m, window));
+        }
+        maxBound = std::max(maxBound, unitBound[u]);
+    }
+
+    // union find over units
+    std::vector<size_t> parent(units.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto findRoot = [&parent](size_t u)
+    {
+        while(parent[u] != u)
+        {
+            parent[u] = parent[parent[u]];
+            u = parent[u];
+        }
+        return u;
+    };
+
+    double cellSize = m_interactionRange + 2.0 * maxBound * window;
+    if(!std::isfinite(cellSize) || cellSize > std::numeric_limits<double>::max() / 4.0)
+    {
+        // unbounded agents could reach anything -> one logical process
+        for(size_t u = 0; u < units.size(); u++)
+        {
+            parent[u] = 0;
+        }
+    }
+    else
+    {
+        // bin member positions into cells, only neighbouring cells can interact
+        cellSize = std::max(cellSize, 1.0e-6);
+        std::map<TileKey, std::vector<std::pair<Eigen::Vector2d, size_t>>> cells;
+        for(size_t u = 0; u < units.size(); u++)
+        {
+            for(Agent* m: unitMembers[u])
+            {
+                Eigen::Vector2d p = m->getPosition();
+                TileKey key(static_cast<long>(std::floor(p.x() / cellSize)), static_cast<long>(std::floor(p.y() / cellSize)));
+                cells[key].push_back({p, u});
+            }
+        }
+
+        for(const auto& [key, points]: cells)
+        {
+            for(long ix = key.first - 1; ix <= key.first + 1; ix++)
+            {
+                for(long iy = key.second - 1; iy <= key.second + 1; iy++)
+                {
+                    auto other = cells.find({ix, iy});
+                    if(other == cells.end())
+                    {
+                        continue;
+                    }
+
+                    for(const auto& [p, u]: points)
+                    {
+                        for(const auto& [q, v]: other->second)
+                        {
+                            if(u != v && findRoot(u) != findRoot(v) &&
+                                    (p - q).norm() - (unitBound[u] + unitBound[v]) * window < m_interactionRange)
+                            {
+                                parent[findRoot(u)] = findRoot(v);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // logical processes numbered in agent order -> deterministic
+    std::unordered_map<size_t, size_t> lpOfRoot;
+    for(size_t u = 0; u < units.size(); u++)
+    {
+        size_t root = findRoot(u);
+        auto it = lpOfRoot.find(root);
+        if(it == lpOfRoot.end())
+        {
+            it = lpOfRoot.insert({root, m_tiles.size()}).first;
+            m_tiles.push_back(Tile());
+            m_tiles.back().key = TileKey(static_cast<long>(it->second), 0);
+            m_lpMembers.push_back(std::vector<Agent*>());
+        }
+
+        size_t lp = it->second;
+        m_tiles[lp].updateAgents.push_back(units[u]);
+        for(Agent* m: unitMembers[u])
+        {
+            m_lpMembers[lp].push_back(m);
+            m_lpOfAgent[m->id()] = lp;
+
+            size_t slot = m_slotOfAgent.size();
+            m_slotOfAgent[m->id()] = slot;
+        }
+    }
+
+    m_slotDistances.resize(m_slotOfAgent.size());
+}
+
+void LookaheadEnvironment::reset()
+{
+    TiledEnvironment::reset();
+
+    m_lpMembers.clear();
+    m_lpOfAgent.clear();
+}
+
+void LookaheadEnvironment::update(double window)
+{
+    m_messageArena.reset();
+    buildLogicalProcesses(window);
+
+    // every agent gets a message queue before the parallel update -> the map is not modified concurrently
+    for(const auto& a: getAgents())
+    {
+        m_msgMap[a->id()];
+    }
+
+    size_t nSteps = std::max<size_t>(1, static_cast<size_t>(std::ceil(window / m_timeStep - 1.0e-9)));
+
+    runParallel(m_tiles.size(), [this, window, nSteps](size_t lpIdx)
+    {
+        for(size_t s = 0; s < nSteps; s++)
+        {
+            double dt = (s + 1 < nSteps) ? m_timeStep : window - m_timeStep * (nSteps - 1);
+
+            computeProcessDistances(lpIdx);
+            updateTileAgents(m_tiles[lpIdx], dt);
+        }
+    });
+
+    // messages between logical processes, logging and listeners
+    deliverTileMessages();
+}
+
+void LookaheadEnvironment::computeProcessDistances(size_t lpIdx)
+{
+    // same as Environment::computeDistances, restricted to the logical process
+    std::vector<Agent*> enabled;
+    for(Agent* a: m_lpMembers[lpIdx])
+    {
+        m_slotDistances[m_slotOfAgent.at(a->id())] = DistanceQueue();
+        if(a->getEnabled())
+        {
+            enabled.push_back(a);
+        }
+    }
+
+    size_t n = enabled.size();
+    std::vector<double> x(n), y(n), dx(n), dy(n), d(n);
+    for(size_t k = 0; k < n; k++)
+    {
+        x[k] = enabled[k]->getPosition().x();
+        y[k] = enabled[k]->getPosition().y();
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        size_t nBlock = n - i - 1;
+        DistanceKernel::computeBlock(x[i], y[i], x.data() + i + 1, y.data() + i + 1, nBlock, dx.data(), dy.data(), d.data());
+
+        DistanceQueue& qA = m_slotDistances[m_slotOfAgent.at(enabled[i]->id())];
+        for(size_t k = 0; k < nBlock; k++)
+        {
+            Agent* b = enabled[i + 1 + k];
+            Eigen::Vector2d vDiff(dx[k], dy[k]);
+            qA.push({d[k], b->id(), vDiff});
+            m_slotDistances[m_slotOfAgent.at(b->id())].push({d[k], enabled[i]->id(), -vDiff});
+        }
+    }
+}
+
+bool LookaheadEnvironment::deliverImmediately(const Message& aMessage) const
+{
+    // messages within the sender's logical process are delivered right away
+    auto senderLp = m_lpOfAgent.find(aMessage.senderId());
+    auto receiverLp = m_lpOfAgent.find(aMessage.receiverId());
+    bool sameLp = senderLp != m_lpOfAgent.end() && receiverLp != m_lpOfAgent.end() &&
+            senderLp->second == receiverLp->second;
+
+    return sameLp || TiledEnvironment::deliverImmediately(aMessage);
+}
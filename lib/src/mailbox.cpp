@@ -0,0 +1,88 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include "mailbox.h"
+
+Mailbox::Mailbox() : m_size(0)
+{
+    Node* stub = new Node();
+    stub->next.store(nullptr, std::memory_order_relaxed);
+    m_head.store(stub, std::memory_order_relaxed);
+    m_tail = stub;
+}
+
+Mailbox::~Mailbox()
+{
+    while(!empty())
+    {
+        pop();
+    }
+
+    delete m_tail;
+}
+
+void Mailbox::push(std::shared_ptr<Message> aMessage)
+{
+    Node* n = new Node();
+    n->message = std::move(aMessage);
+    n->next.store(nullptr, std::memory_order_relaxed);
+
+    // count the message before it can be popped, so that size() never wraps
+    m_size.fetch_add(1, std::memory_order_relaxed);
+
+    // claim the position of the new head, then link the previous head to it
+    Node* prev = m_head.exchange(n, std::memory_order_acq_rel);
+    prev->next.store(n, std::memory_order_release);
+}
+
+std::shared_ptr<Message> Mailbox::front() const
+{
+    Node* next = m_tail->next.load(std::memory_order_acquire);
+    return next->message;
+}
+
+void Mailbox::pop()
+{
+    Node* next = m_tail->next.load(std::memory_order_acquire);
+    if(next == nullptr)
+    {
+        return;
+    }
+
+    // next becomes the new stub node
+    delete m_tail;
+    m_tail = next;
+    m_tail->message.reset();
+
+    m_size.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool Mailbox::empty() const
+{
+    return m_tail->next.load(std::memory_order_acquire) == nullptr;
+}
+
+size_t Mailbox::size() const
+{
+    return m_size.load(std::memory_order_relaxed);
+}
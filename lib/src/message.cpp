@@ -21,14 +21,56 @@
 **
 *****************************************************************************/
 
+#include <cstring>
+#include <sstream>
+
 #include "message.h"
 
+Message::Message(unsigned int senderId, unsigned int receiverId, Subject subject)
+    : m_senderId(senderId), m_receiverId(receiverId), m_subject(subject), m_nbrOfDoubles(0), m_nbrOfInts(0), m_textLength(0)
+{
+
+}
+
+Message::Message(unsigned int senderId, unsigned int receiverId, Subject subject, std::initializer_list<double> doubleParams)
+    : Message(senderId, receiverId, subject)
+{
+    setPayload(nullptr, 0, doubleParams.begin(), doubleParams.size(), nullptr, 0);
+}
+
 Message::Message(unsigned int senderId, unsigned int receiverId, Message::Subject subject, const std::string &textParam,
                  const std::vector<double>& vecDoubleParam, const std::vector<int> &vecIntParam)
-    : m_senderId(senderId), m_receiverId(receiverId), m_subject(subject), m_textParam(textParam),
-      m_doubleVecParam(vecDoubleParam), m_intVecParam(vecIntParam)
+    : Message(senderId, receiverId, subject)
 {
+    setPayload(textParam.data(), textParam.size(), vecDoubleParam.data(), vecDoubleParam.size(),
+               vecIntParam.data(), vecIntParam.size());
+}
 
+Message::Message(const Message &other)
+    : m_senderId(other.m_senderId), m_receiverId(other.m_receiverId), m_subject(other.m_subject),
+      m_nbrOfDoubles(other.m_nbrOfDoubles), m_nbrOfInts(other.m_nbrOfInts), m_textLength(other.m_textLength)
+{
+    std::memcpy(m_payload, other.m_payload, InlinePayloadSize);
+    if(other.m_extended)
+    {
+        m_extended.reset(new ExtendedPayload(*other.m_extended));
+    }
+}
+
+Message &Message::operator=(const Message &other)
+{
+    if(this != &other)
+    {
+        m_senderId = other.m_senderId;
+        m_receiverId = other.m_receiverId;
+        m_subject = other.m_subject;
+        m_nbrOfDoubles = other.m_nbrOfDoubles;
+        m_nbrOfInts = other.m_nbrOfInts;
+        m_textLength = other.m_textLength;
+        std::memcpy(m_payload, other.m_payload, InlinePayloadSize);
+        m_extended.reset(other.m_extended ? new ExtendedPayload(*other.m_extended) : nullptr);
+    }
+    return *this;
 }
 
 Message::~Message()
@@ -36,6 +78,59 @@ Message::~Message()
 
 }
 
+std::shared_ptr<Message> Message::createMessage(unsigned int senderId, unsigned int receiverId, Subject subject,
+                                                std::initializer_list<double> doubleParams)
+{
+    return std::allocate_shared<Message>(MessagePoolAllocator<Message>(), senderId, receiverId, subject, doubleParams);
+}
+
+std::shared_ptr<Message> Message::clone() const
+{
+    return createMessage(*this);
+}
+
+void Message::setPayload(const char *text, size_t textLength, const double *doubles, size_t nDoubles, const int *ints, size_t nInts)
+{
+    size_t size = nDoubles * sizeof(double) + nInts * sizeof(int) + textLength;
+    if(size > InlinePayloadSize)
+    {
+        m_extended.reset(new ExtendedPayload{std::string(text, textLength), std::vector<double>(doubles, doubles + nDoubles),
+                                             std::vector<int>(ints, ints + nInts)});
+        return;
+    }
+
+    m_nbrOfDoubles = static_cast<unsigned char>(nDoubles);
+    m_nbrOfInts = static_cast<unsigned char>(nInts);
+    m_textLength = static_cast<unsigned char>(textLength);
+    if(nDoubles > 0)
+    {
+        std::memcpy(m_payload, doubles, nDoubles * sizeof(double));
+    }
+    if(nInts > 0)
+    {
+        std::memcpy(m_payload + nDoubles * sizeof(double), ints, nInts * sizeof(int));
+    }
+    if(textLength > 0)
+    {
+        std::memcpy(m_payload + nDoubles * sizeof(double) + nInts * sizeof(int), text, textLength);
+    }
+}
+
+const double *Message::inlineDoubles() const
+{
+    return reinterpret_cast<const double*>(m_payload);
+}
+
+const int *Message::inlineInts() const
+{
+    return reinterpret_cast<const int*>(m_payload + m_nbrOfDoubles * sizeof(double));
+}
+
+const char *Message::inlineText() const
+{
+    return reinterpret_cast<const char*>(m_payload + m_nbrOfDoubles * sizeof(double) + m_nbrOfInts * sizeof(int));
+}
+
 unsigned int Message::senderId() const
 {
     return m_senderId;
@@ -48,17 +143,59 @@ unsigned int Message::receiverId() const
 
 std::string Message::textParam() const
 {
-    return m_textParam;
+    return std::string(textView());
 }
 
 std::vector<double> Message::doubleVecParam() const
 {
-    return m_doubleVecParam;
+    if(m_extended)
+    {
+        return m_extended->doubles;
+    }
+    return std::vector<double>(inlineDoubles(), inlineDoubles() + m_nbrOfDoubles);
 }
 
 std::vector<int> Message::intVecParam() const
 {
-    return m_intVecParam;
+    if(m_extended)
+    {
+        return m_extended->ints;
+    }
+    return std::vector<int>(inlineInts(), inlineInts() + m_nbrOfInts);
+}
+
+std::string_view Message::textView() const
+{
+    if(m_extended)
+    {
+        return m_extended->text;
+    }
+    return std::string_view(inlineText(), m_textLength);
+}
+
+size_t Message::numberOfDoubleParams() const
+{
+    return m_extended ? m_extended->doubles.size() : m_nbrOfDoubles;
+}
+
+double Message::doubleParam(size_t index) const
+{
+    return m_extended ? m_extended->doubles[index] : inlineDoubles()[index];
+}
+
+size_t Message::numberOfIntParams() const
+{
+    return m_extended ? m_extended->ints.size() : m_nbrOfInts;
+}
+
+int Message::intParam(size_t index) const
+{
+    return m_extended ? m_extended->ints[index] : inlineInts()[index];
+}
+
+bool Message::hasInlinePayload() const
+{
+    return !m_extended;
 }
 
 Message::Subject Message::subject() const
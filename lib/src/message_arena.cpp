@@ -0,0 +1,167 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#include <cstdint>
+#include <cassert>
+#include <new>
+
+#include "message_arena.h"
+
+namespace
+{
+    constexpr size_t Granularity = alignof(std::max_align_t);
+}
+
+/**
+ * A chunk starts with this header. Its references are the arena's one plus
+ * one per allocated block, and one per allocation in progress. The chunk is
+ * aligned to its size, so a block finds its chunk by masking its address.
+ */
+struct MessageArena::Chunk
+{
+    std::atomic_size_t references{1};
+    std::atomic_size_t offset{0};
+};
+
+namespace
+{
+    constexpr size_t HeaderSize = (sizeof(std::atomic_size_t) * 2 + Granularity - 1) / Granularity * Granularity;
+}
+
+MessageArena::MessageArena() : m_current(nullptr)
+{
+
+}
+
+MessageArena::~MessageArena()
+{
+    // chunks still referenced by messages are freed with their last message
+    for(Chunk* c: m_chunks)
+    {
+        if(--c->references == 0)
+        {
+            c->~Chunk();
+            ::operator delete(c, std::align_val_t(ChunkSize));
+        }
+    }
+}
+
+std::shared_ptr<Message> MessageArena::createMessage(unsigned int senderId, unsigned int receiverId, Message::Subject subject,
+                                                     std::initializer_list<double> doubleParams)
+{
+    return std::allocate_shared<Message>(ArenaAllocator<Message>(this), senderId, receiverId, subject, doubleParams);
+}
+
+bool MessageArena::tryAllocate(Chunk *chunk, size_t size, void *&block)
+{
+    // the reference is taken first, so the chunk cannot be reset meanwhile
+    chunk->references++;
+    if(m_current != chunk)
+    {
+        chunk->references--;
+        return false;
+    }
+
+    size_t offset = chunk->offset.fetch_add(size);
+    if(HeaderSize + offset + size > ChunkSize)
+    {
+        chunk->references--;
+        return false;
+    }
+
+    block = reinterpret_cast<char*>(chunk) + HeaderSize + offset;
+    return true;
+}
+
+MessageArena::Chunk *MessageArena::nextChunk(Chunk *full)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(m_current != full)
+    {
+        // another thread already replaced it
+        return m_current;
+    }
+
+    // reuse a chunk whose messages were all released, otherwise allocate one
+    Chunk* next = nullptr;
+    for(Chunk* c: m_chunks)
+    {
+        if(c != full && c->references == 1)
+        {
+            next = c;
+            break;
+        }
+    }
+
+    if(!next)
+    {
+        next = new (::operator new(ChunkSize, std::align_val_t(ChunkSize))) Chunk();
+        m_chunks.push_back(next);
+    }
+
+    next->offset = 0;
+    m_current = next;
+    return next;
+}
+
+void *MessageArena::allocate(size_t size)
+{
+    size = (size + Granularity - 1) / Granularity * Granularity;
+    assert(HeaderSize + size <= ChunkSize);
+
+    Chunk* chunk = m_current;
+    void* block = nullptr;
+    while(!chunk || !tryAllocate(chunk, size, block))
+    {
+        chunk = nextChunk(chunk);
+    }
+    return block;
+}
+
+void MessageArena::deallocate(void *block)
+{
+    auto address = reinterpret_cast<std::uintptr_t>(block);
+    Chunk* chunk = reinterpret_cast<Chunk*>(address & ~static_cast<std::uintptr_t>(ChunkSize - 1));
+
+    // only an orphaned chunk, whose arena is gone, reaches zero
+    if(--chunk->references == 0)
+    {
+        chunk->~Chunk();
+        ::operator delete(chunk, std::align_val_t(ChunkSize));
+    }
+}
+
+void MessageArena::reset()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Chunk* current = m_current;
+    if(current && current->references == 1)
+    {
+        current->offset = 0;
+    }
+}
+
+size_t MessageArena::numberOfChunks() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_chunks.size();
+}
@@ -0,0 +1,137 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+#include "message_pool.h"
+
+namespace
+{
+    constexpr size_t Granularity = alignof(std::max_align_t);
+    constexpr size_t NbrOfSizeClasses = MessagePool::MaxBlockSize / Granularity;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    // set when the free lists of the thread are gone, blocks freed later go to the global allocator
+    thread_local bool t_freeListsDestroyed = false;
+
+    // free lists of one thread, released when the thread ends
+    struct FreeLists
+    {
+        FreeBlock* heads[NbrOfSizeClasses] = {};
+        size_t counts[NbrOfSizeClasses] = {};
+
+        ~FreeLists()
+        {
+            t_freeListsDestroyed = true;
+            for(FreeBlock*& head: heads)
+            {
+                while(head)
+                {
+                    FreeBlock* b = head;
+                    head = head->next;
+                    ::operator delete(b);
+                }
+            }
+        }
+    };
+
+    FreeLists& freeLists()
+    {
+        thread_local FreeLists lists;
+        return lists;
+    }
+
+    size_t sizeClass(size_t size)
+    {
+        return (size + Granularity - 1) / Granularity - 1;
+    }
+}
+
+void* MessagePool::allocate(size_t size)
+{
+    if(size == 0 || size > MaxBlockSize)
+    {
+        return ::operator new(size);
+    }
+
+    size_t c = sizeClass(size);
+    if(t_freeListsDestroyed)
+    {
+        return ::operator new((c + 1) * Granularity);
+    }
+
+    FreeLists& lists = freeLists();
+    if(FreeBlock* b = lists.heads[c])
+    {
+        lists.heads[c] = b->next;
+        lists.counts[c]--;
+        return b;
+    }
+
+    // whole size class, so that the block can be reused for any size of it
+    return ::operator new((c + 1) * Granularity);
+}
+
+void MessagePool::deallocate(void* block, size_t size)
+{
+    if(size == 0 || size > MaxBlockSize)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    size_t c = sizeClass(size);
+    if(t_freeListsDestroyed)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    FreeLists& lists = freeLists();
+    if(lists.counts[c] >= MaxCachedBlocks)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    FreeBlock* b = static_cast<FreeBlock*>(block);
+    b->next = lists.heads[c];
+    lists.heads[c] = b;
+    lists.counts[c]++;
+}
+
+size_t MessagePool::numberOfCachedBlocks()
+{
+    size_t n = 0;
+    if(t_freeListsDestroyed)
+    {
+        return n;
+    }
+
+    for(size_t c: freeLists().counts)
+    {
+        n += c;
+    }
+    return n;
+}
@@ -59,6 +59,11 @@ void Objective::process(double timeStep)
     react(timeStep);
 }
 
+void Objective::reset()
+{
+    m_isStart = true;
+}
+
 void Objective::react(double /*timeStep*/)
 {
 
@@ -129,4 +134,10 @@ void ObjectivePriorityQueue::deleteAllObjectives()
         pop();
 }
 
-
+void ObjectivePriorityQueue::resetObjectives()
+{
+    for(ObjectiveSP& objective: c)
+    {
+        objective->reset();
+    }
+}
@@ -36,6 +36,16 @@ MaintainDistance::~MaintainDistance()
 
 }
 
+double MaintainDistance::observationDistance() const
+{
+    return m_observationDistance;
+}
+
+void MaintainDistance::setObservationDistance(double obsDistance)
+{
+    m_observationDistance = obsDistance;
+}
+
 void MaintainDistance::react(double timeStep)
 {
     // React on neighbours and environment borders. When no neigbhours, slow down.
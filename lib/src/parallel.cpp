@@ -22,18 +22,37 @@
 *****************************************************************************/
 
 #include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <iomanip>
+#include <typeinfo>
+#include <cmath>
+#include <limits>
 
 #include "parallel.h"
 #include "evaluation.h"
+#include "cpu_topology.h"
 
 std::shared_ptr<Parallel> Parallel::createParallel(size_t nThreads)
 {
     return std::shared_ptr<Parallel>(new Parallel(nThreads));
 }
 
-Parallel::Parallel(size_t nThreads) : m_nbrThreads(nThreads), m_nbrOfFinishedSimulations(0)
+Parallel::Parallel(size_t nThreads) : m_nbrThreads(std::max<size_t>(1, nThreads)), m_nextQueue(0), m_chunkSize(1), m_stopWhenFinished(false),
+    m_pinThreads(false), m_recycleSimulations(false), m_started(false),
+    m_nbrOfQueuedSimulations(0), m_nbrOfFinishedSimulations(0), m_nbrOfAddedSimulations(0), m_nbrOfFailedSimulations(0),
+    m_wallNanosecondsSum(0), m_minWallNanoseconds(std::numeric_limits<int64_t>::max()), m_maxWallNanoseconds(0),
+    m_nbrOfReturnedSimulations(0)
 {
+    for(auto& bucket: m_wallTimeBuckets)
+    {
+        bucket = 0;
+    }
 
+    for(size_t k = 0; k < m_nbrThreads; k++)
+    {
+        m_workerQueues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
 }
 
 Parallel::~Parallel()
@@ -42,55 +61,648 @@ Parallel::~Parallel()
     {
         t.join();
     }
+
+    if(m_resultSink)
+    {
+        m_resultSink->flush();
+    }
 }
 
-void Parallel::addSimulation(std::shared_ptr<Simulation> aSimulation, double timeSteps, double simulationTime)
+Parallel::SimulationFuture Parallel::addSimulation(std::shared_ptr<Simulation> aSimulation, double timeSteps, double simulationTime)
 {
-    m_simQueue.push({aSimulation, timeSteps, simulationTime});
+    Job job{{aSimulation, timeSteps, simulationTime}, 0.0, std::make_shared<std::promise<std::shared_ptr<Simulation>>>(), nullptr};
+    SimulationFuture future = job.promise->get_future().share();
+
+    m_nbrOfAddedSimulations++;
+    m_nbrOfQueuedSimulations++;
+
+    // distribute round robin over the worker queues
+    WorkerQueue& q = *m_workerQueues[m_nextQueue++ % m_nbrThreads];
+    {
+        std::unique_lock<std::mutex> lock(q.mutex);
+        q.simulations.push_back(job);
+    }
+
+    return future;
 }
 
-void Parallel::doWork()
+void Parallel::addSimulationGenerator(size_t count, SimulationGenerator generator, double timeSteps, double simulationTime,
+                                      IndexCostEstimator cost)
 {
-    while (true)
+    auto range = std::unique_ptr<GeneratorRange>(new GeneratorRange());
+    range->generator = generator;
+    range->count = count;
+    range->timeSteps = timeSteps;
+    range->simulationTime = simulationTime;
+    range->cost = cost;
+    range->next = 0;
+    m_generators.push_back(std::move(range));
+
+    m_nbrOfAddedSimulations += count;
+    m_nbrOfQueuedSimulations += count;
+}
+
+void Parallel::setCostEstimator(CostEstimator estimator)
+{
+    m_costEstimator = estimator;
+}
+
+void Parallel::setStopWhenFinished(bool stop)
+{
+    m_stopWhenFinished = stop;
+}
+
+bool Parallel::stopWhenFinished() const
+{
+    return m_stopWhenFinished;
+}
+
+void Parallel::setRecycleSimulations(bool recycle)
+{
+    m_recycleSimulations = recycle;
+}
+
+bool Parallel::recycleSimulations() const
+{
+    return m_recycleSimulations;
+}
+
+void Parallel::setResultCache(std::shared_ptr<ResultCache> cache)
+{
+    m_resultCache = cache;
+}
+
+void Parallel::setCompletionCallback(CompletionCallback callback)
+{
+    m_completionCallback = callback;
+}
+
+void Parallel::setResultSink(std::shared_ptr<ResultSink> sink)
+{
+    m_resultSink = sink;
+}
+
+bool Parallel::claimOwn(size_t workerIdx, std::deque<Job>& claimed)
+{
+    WorkerQueue& q = *m_workerQueues[workerIdx];
+    std::unique_lock<std::mutex> lock(q.mutex);
+
+    size_t n = std::min<size_t>(m_chunkSize, q.simulations.size());
+    for(size_t k = 0; k < n; k++)
     {
-        SimQueueElement sq;
-        bool gotSim = false;
+        claimed.push_back(q.simulations.front());
+        q.simulations.pop_front();
+    }
+
+    return n > 0;
+}
+
+bool Parallel::steal(size_t workerIdx, std::deque<Job>& claimed)
+{
+    // try the other workers in turn, take half of a victim's queue from its back
+    for(size_t k = 1; k < m_nbrThreads; k++)
+    {
+        WorkerQueue& victim = *m_workerQueues[(workerIdx + k) % m_nbrThreads];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+
+        size_t n = (victim.simulations.size() + 1) / 2;
+        for(size_t s = 0; s < n; s++)
         {
-            std::unique_lock<std::mutex> lock(m_queueMutex);
+            claimed.push_front(victim.simulations.back());
+            victim.simulations.pop_back();
+        }
+
+        if(n > 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Parallel::claimGenerated(std::deque<Job>& claimed)
+{
+    for(auto& range: m_generators)
+    {
+        size_t first = range->next.fetch_add(m_chunkSize);
+        if(first >= range->count)
+        {
+            continue;
+        }
+
+        size_t last = std::min<size_t>(first + m_chunkSize, range->count);
+        for(size_t k = first; k < last; k++)
+        {
+            size_t idx = range->order.empty() ? k : range->order[k];
+
+            // a throwing generator fails this index only, runJob reports it
+            std::shared_ptr<Simulation> sim;
+            std::exception_ptr error;
+            try
+            {
+                sim = range->generator(idx);
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+            claimed.push_back({{sim, range->timeSteps, range->simulationTime}, 0.0, nullptr, error});
+        }
+
+        return true;
+    }
 
-            if( m_simQueue.empty() )
+    return false;
+}
+
+void Parallel::doWork(size_t workerIdx)
+{
+    WorkerQueue& own = *m_workerQueues[workerIdx];
+    if(own.cpu >= 0 && !CpuTopology::pinCurrentThread(own.cpu))
+    {
+        own.cpu = -1;
+        own.node = -1;
+    }
+
+    std::deque<Job> claimed;
+
+    while (true)
+    {
+        if(claimed.empty())
+        {
+            if( !claimOwn(workerIdx, claimed) && !steal(workerIdx, claimed) && !claimGenerated(claimed) )
             {
+                own.finishedNanoseconds = elapsedNanoseconds();
                 return;
             }
 
-            sq = m_simQueue.front();
-            gotSim = true;
-            m_simQueue.pop();
+            // stolen simulations go to the own queue, claimed in chunks from there
+            if(claimed.size() > m_chunkSize)
+            {
+                std::unique_lock<std::mutex> lock(own.mutex);
+                while(claimed.size() > m_chunkSize)
+                {
+                    own.simulations.push_front(claimed.back());
+                    claimed.pop_back();
+                }
+            }
+        }
+
+        Job job = claimed.front();
+        claimed.pop_front();
+        m_nbrOfQueuedSimulations--;
+
+        runJob(own, job);
+    }
+}
+
+std::shared_ptr<Simulation> Parallel::prepareRunner(WorkerQueue &own, const std::shared_ptr<Simulation> &sim)
+{
+    if(!own.runner)
+    {
+        own.runner = Simulation::createSimulation(sim->id());
+    }
+    std::shared_ptr<Simulation>& runner = own.runner;
+
+    // another kind of environment cannot be reset into the needed one
+    auto previousFactory = runner->environmentFactory();
+    if(previousFactory && typeid(*previousFactory) != typeid(*sim->environmentFactory()))
+    {
+        runner->releaseEnvironment();
+    }
+
+    runner->reset(sim->id(), sim->masterSeed());
+    runner->setStreamId(sim->streamId());
+    runner->setScenarioKey(sim->scenarioKey());
+    runner->setEnvironmentFactory(sim->environmentFactory());
+    runner->setAgentFactory(sim->agentFactory());
+    runner->setEvaluation(sim->getEvaluation());
+    runner->setDescription(sim->description());
+    runner->setEnableLogMessages(sim->enableLogMessages());
+    runner->setLogger(sim->logger());
+    runner->setEventLogDirectory(sim->eventLogDirectory());
+
+    return runner;
+}
+
+void Parallel::runJob(WorkerQueue &own, Job &job)
+{
+    auto[sim, ts, dur] = job.element;
+    auto start = std::chrono::steady_clock::now();
 
-            // lock is unlocked when leaving scope
+    try
+    {
+        if(job.error)
+        {
+            std::rethrow_exception(job.error);
+        }
+
+        // streaming mode only needs the result values -> they may come from the cache
+        std::string cacheKey;
+        Evaluation::ResultValues values;
+        bool cached = false;
+        if(m_resultSink && m_resultCache)
+        {
+            cacheKey = ResultCache::key(sim, ts, dur, m_stopWhenFinished);
+            cached = m_resultCache->lookup(cacheKey, values);
+        }
+
+        if(!cached)
+        {
+            std::shared_ptr<Simulation> running = m_recycleSimulations ? prepareRunner(own, sim) : sim;
+
+            running->initEnvironment();
+            running->initAgents();
+            if(m_stopWhenFinished)
+            {
+                running->runSimulationUntilFinished(ts, dur);
+            }
+            else
+            {
+                running->runSimulation(ts, dur);
+            }
+            own.nbrOfSteps += static_cast<size_t>(std::llround(running->getSimulationRunningTime() / ts));
+
+            if(m_resultSink)
+            {
+                values = sim->getEvaluation()->getResultValues();
+                if(!m_recycleSimulations)
+                {
+                    sim->releaseEnvironment();
+                }
+
+                if(m_resultCache && !values.empty())
+                {
+                    m_resultCache->store(cacheKey, values);
+                }
+            }
         }
 
-        if(gotSim)
+        if(m_resultSink)
         {
-            // run the simulation
-            auto[sim, ts, dur] = sq;
-            sim->initEnvironment();
-            sim->initAgents();
-            sim->runSimulation(ts, dur);
-            m_nbrOfFinishedSimulations++;
+            double seconds = cached ? 0.0 : std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            SimulationResult result{sim->id(), sim->description(), values, seconds};
+            std::unique_lock<std::mutex> lock(m_resultSinkMutex);
+            m_resultSink->write(result);
+        }
+
+        if(job.promise)
+        {
+            job.promise->set_value(sim);
+        }
+    }
+    catch(...)
+    {
+        m_nbrOfFailedSimulations++;
+        if(job.promise)
+        {
+            job.promise->set_exception(std::current_exception());
+        }
+    }
+
+    // statistics are complete before anybody waiting learns about the simulation
+    int64_t wallNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    own.busyNanoseconds += wallNanoseconds;
+    own.nbrOfSimulations++;
+    recordWallTime(wallNanoseconds);
+
+    if(m_completionCallback && sim)
+    {
+        // a throwing callback must neither end the worker nor leave the simulation unfinished
+        try
+        {
+            m_completionCallback(sim);
+        }
+        catch(...)
+        {
+            m_nbrOfFailedSimulations++;
         }
     }
+
+    {
+        std::unique_lock<std::mutex> lock(m_completionMutex);
+        if(m_resultSink || !sim)
+        {
+            // streaming mode: finished simulations are not kept; nothing to return if generation failed
+            m_nbrOfReturnedSimulations++;
+        }
+        else
+        {
+            m_completed.push_back(sim);
+        }
+        m_nbrOfFinishedSimulations++;
+    }
+    m_completionCondition.notify_all();
+}
+
+void Parallel::wait()
+{
+    std::unique_lock<std::mutex> lock(m_completionMutex);
+    m_completionCondition.wait(lock, [this] { return m_nbrOfFinishedSimulations == m_nbrOfAddedSimulations; });
+
+    if(m_resultSink)
+    {
+        std::unique_lock<std::mutex> sinkLock(m_resultSinkMutex);
+        m_resultSink->flush();
+    }
+}
+
+std::shared_ptr<Simulation> Parallel::waitAny()
+{
+    std::unique_lock<std::mutex> lock(m_completionMutex);
+    m_completionCondition.wait(lock, [this]
+    {
+        return !m_completed.empty() || m_nbrOfReturnedSimulations == m_nbrOfAddedSimulations;
+    });
+
+    if(m_completed.empty())
+    {
+        return nullptr;
+    }
+
+    auto sim = m_completed.front();
+    m_completed.pop_front();
+    m_nbrOfReturnedSimulations++;
+    return sim;
+}
+
+void Parallel::setPinThreads(bool pin)
+{
+    m_pinThreads = pin;
+}
+
+void Parallel::scheduleLongestFirst()
+{
+    std::vector<Job> jobs;
+    for(auto& q: m_workerQueues)
+    {
+        std::unique_lock<std::mutex> lock(q->mutex);
+        for(Job& job: q->simulations)
+        {
+            job.cost = m_costEstimator(std::get<0>(job.element));
+            jobs.push_back(job);
+        }
+        q->simulations.clear();
+    }
+
+    // LPT: the most expensive simulation next goes to the least loaded queue
+    std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.cost > b.cost; });
+
+    std::vector<double> load(m_nbrThreads, 0.0);
+    for(const Job& job: jobs)
+    {
+        size_t k = std::min_element(load.begin(), load.end()) - load.begin();
+        load[k] += job.cost;
+        m_workerQueues[k]->simulations.push_back(job);
+    }
 }
 
 void Parallel::run()
 {
+    if(m_pinThreads)
+    {
+        std::vector<int> cpus = CpuTopology::workerCpus(m_nbrThreads);
+        for(size_t k = 0; k < cpus.size(); k++)
+        {
+            m_workerQueues[k]->cpu = cpus[k];
+            m_workerQueues[k]->node = CpuTopology::nodeOfCpu(cpus[k]);
+        }
+    }
+
+    if(m_costEstimator)
+    {
+        scheduleLongestFirst();
+    }
+
+    for(auto& range: m_generators)
+    {
+        if(range->cost)
+        {
+            std::vector<double> costs(range->count);
+            for(size_t idx = 0; idx < range->count; idx++)
+            {
+                costs[idx] = range->cost(idx);
+            }
+
+            range->order.resize(range->count);
+            std::iota(range->order.begin(), range->order.end(), 0);
+            std::stable_sort(range->order.begin(), range->order.end(), [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+        }
+    }
+
+    m_runStart = std::chrono::steady_clock::now();
+    m_started = true;
     for(size_t k = 0; k < m_nbrThreads; k++)
     {
-        m_threadPool.push_back(std::thread([this] { this->doWork(); } ));
+        m_threadPool.push_back(std::thread([this, k] { this->doWork(k); } ));
     }
 }
 
 std::pair<double, double> Parallel::getProgress() const
 {
-    return {m_nbrOfFinishedSimulations, m_simQueue.size()};
+    return {m_nbrOfFinishedSimulations, m_nbrOfQueuedSimulations};
+}
+
+size_t Parallel::numberOfFailedSimulations() const
+{
+    return m_nbrOfFailedSimulations;
+}
+
+void Parallel::setChunkSize(size_t chunkSize)
+{
+    m_chunkSize = std::max<size_t>(1, chunkSize);
+}
+
+double Parallel::WorkerStatistics::simulationsPerSecond() const
+{
+    return wallSeconds > 0.0 ? simulations / wallSeconds : 0.0;
+}
+
+std::vector<Parallel::WorkerStatistics> Parallel::getWorkerStatistics() const
+{
+    int64_t now = elapsedNanoseconds();
+    bool running = now >= 0;
+
+    std::vector<WorkerStatistics> stats;
+    for(const auto& q: m_workerQueues)
+    {
+        int64_t finished = q->finishedNanoseconds;
+        int64_t wall = !running ? 0 : (finished >= 0 ? finished : now);
+
+        WorkerStatistics s;
+        s.cpu = q->cpu;
+        s.node = q->node;
+        s.simulations = q->nbrOfSimulations;
+        s.steps = q->nbrOfSteps;
+        s.busySeconds = q->busyNanoseconds * 1e-9;
+        s.wallSeconds = wall * 1e-9;
+        s.idleSeconds = std::max(0.0, s.wallSeconds - s.busySeconds);
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+std::string Parallel::workerReport() const
+{
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(2);
+    s << "worker, cpu, node, simulations, steps, busy s, idle s, wall s, sims/s" << std::endl;
+
+    auto stats = getWorkerStatistics();
+    for(size_t k = 0; k < stats.size(); k++)
+    {
+        const auto& w = stats[k];
+        s << k << ", " << w.cpu << ", " << w.node << ", " << w.simulations << ", " << w.steps << ", " << w.busySeconds
+          << ", " << w.idleSeconds << ", " << w.wallSeconds << ", " << w.simulationsPerSecond() << std::endl;
+    }
+    s << "tail idle s: " << tailIdleSeconds() << std::endl;
+    return s.str();
+}
+
+double Parallel::tailIdleSeconds() const
+{
+    int64_t now = elapsedNanoseconds();
+    if(now < 0)
+    {
+        return 0.0;
+    }
+
+    // the run ends with the last worker, or now if one still works
+    int64_t end = 0;
+    std::vector<int64_t> finished;
+    for(const auto& q: m_workerQueues)
+    {
+        int64_t f = q->finishedNanoseconds;
+        finished.push_back(f);
+        end = std::max(end, f >= 0 ? f : now);
+    }
+
+    int64_t idle = 0;
+    for(int64_t f: finished)
+    {
+        if(f >= 0)
+        {
+            idle += end - f;
+        }
+    }
+    return idle * 1e-9;
+}
+
+size_t Parallel::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+int64_t Parallel::elapsedNanoseconds() const
+{
+    if(!m_started)
+    {
+        return -1;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_runStart).count();
+}
+
+void Parallel::recordWallTime(int64_t nanoseconds)
+{
+    size_t bucket = 0;
+    if(nanoseconds >= 1000)
+    {
+        bucket = std::min<size_t>(NbrOfWallTimeBuckets - 1, 1 + static_cast<size_t>(4.0 * std::log2(nanoseconds / 1000.0)));
+    }
+    m_wallTimeBuckets[bucket]++;
+    m_wallNanosecondsSum += nanoseconds;
+
+    int64_t min = m_minWallNanoseconds;
+    while(nanoseconds < min && !m_minWallNanoseconds.compare_exchange_weak(min, nanoseconds));
+    int64_t max = m_maxWallNanoseconds;
+    while(nanoseconds > max && !m_maxWallNanoseconds.compare_exchange_weak(max, nanoseconds));
+}
+
+double Parallel::wallTimeQuantile(double q, size_t count) const
+{
+    size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(q * count)));
+    size_t cumulated = 0;
+    size_t bucket = 0;
+    for(; bucket < NbrOfWallTimeBuckets - 1; bucket++)
+    {
+        cumulated += m_wallTimeBuckets[bucket];
+        if(cumulated >= rank)
+        {
+            break;
+        }
+    }
+
+    // geometric middle of the bucket, within the observed range
+    double seconds = bucket == 0 ? 0.5e-6 : 1e-6 * std::exp2((bucket - 0.5) / 4.0);
+    return std::min(std::max(seconds, m_minWallNanoseconds * 1e-9), m_maxWallNanoseconds * 1e-9);
+}
+
+Parallel::LiveStatistics Parallel::getLiveStatistics() const
+{
+    LiveStatistics s{};
+    int64_t elapsed = elapsedNanoseconds();
+    s.queued = m_nbrOfQueuedSimulations;
+    if(elapsed < 0)
+    {
+        return s;
+    }
+
+    s.elapsedSeconds = elapsed * 1e-9;
+    s.workers = getWorkerStatistics();
+
+    // counted per worker, so that the histogram, sum and worker counts match closely
+    size_t steps = 0;
+    for(const auto& w: s.workers)
+    {
+        s.finished += w.simulations;
+        steps += w.steps;
+    }
+    size_t added = m_nbrOfAddedSimulations;
+    s.queued = std::min(s.queued, added - s.finished);
+    s.running = added - s.finished - s.queued;
+
+    if(s.elapsedSeconds > 0.0)
+    {
+        s.simulationsPerSecond = s.finished / s.elapsedSeconds;
+        s.stepsPerSecond = steps / s.elapsedSeconds;
+    }
+    s.etaSeconds = s.finished == added ? 0.0 : (s.finished > 0 ? (added - s.finished) / s.simulationsPerSecond : -1.0);
+
+    size_t count = 0;
+    for(const auto& bucket: m_wallTimeBuckets)
+    {
+        count += bucket;
+    }
+    if(count > 0)
+    {
+        s.meanWallSeconds = m_wallNanosecondsSum * 1e-9 / count;
+        s.minWallSeconds = m_minWallNanoseconds * 1e-9;
+        s.maxWallSeconds = m_maxWallNanoseconds * 1e-9;
+        s.medianWallSeconds = wallTimeQuantile(0.5, count);
+        s.p90WallSeconds = wallTimeQuantile(0.9, count);
+        s.p99WallSeconds = wallTimeQuantile(0.99, count);
+    }
+
+    return s;
+}
+
+std::string Parallel::liveReport() const
+{
+    LiveStatistics l = getLiveStatistics();
+
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(2);
+    s << l.finished << " / " << (l.finished + l.running + l.queued) << " finished, " << l.running << " running, "
+      << l.simulationsPerSecond << " sims/s, " << l.stepsPerSecond << " steps/s, wall s median " << l.medianWallSeconds
+      << " p90 " << l.p90WallSeconds << " max " << l.maxWallSeconds << ", ETA ";
+    if(l.etaSeconds < 0.0)
+    {
+        s << "unknown";
+    }
+    else
+    {
+        s << l.etaSeconds << " s";
+    }
+    return s.str();
 }
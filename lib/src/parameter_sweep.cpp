@@ -0,0 +1,657 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <cassert>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <thread>
+
+#include "parameter_sweep.h"
+
+double ParameterPoint::operator[](const std::string &name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    assert(it != names.end());
+    return values[std::distance(names.begin(), it)];
+}
+
+std::shared_ptr<ParameterSweep> ParameterSweep::createParameterSweep()
+{
+    return std::shared_ptr<ParameterSweep>(new ParameterSweep());
+}
+
+ParameterSweep::ParameterSweep() : m_sampling(Grid), m_nbrOfSamples(0), m_seed(0), m_replications(1),
+    m_reduction(meanReduction), m_nbrOfResumedPoints(0), m_stopWhenFinished(false)
+{
+
+}
+
+ParameterSweep::~ParameterSweep()
+{
+
+}
+
+void ParameterSweep::addAxis(const std::string &name, const std::vector<double> &values)
+{
+    assert(!values.empty());
+    auto[min, max] = std::minmax_element(values.begin(), values.end());
+    m_axes.push_back({name, values, *min, *max});
+
+    // the latin hypercube strata depend on the number of axes
+    setSampling(m_sampling, m_nbrOfSamples, m_seed);
+}
+
+void ParameterSweep::addLinearAxis(const std::string &name, double first, double step, size_t count)
+{
+    std::vector<double> values(count);
+    for(size_t k = 0; k < count; k++)
+    {
+        values[k] = first + k * step;
+    }
+    addAxis(name, values);
+}
+
+std::vector<std::string> ParameterSweep::axisNames() const
+{
+    std::vector<std::string> names;
+    for(const auto& axis: m_axes)
+    {
+        names.push_back(axis.name);
+    }
+    return names;
+}
+
+void ParameterSweep::setSampling(Sampling sampling, size_t nbrOfSamples, uint64_t seed)
+{
+    m_sampling = sampling;
+    m_nbrOfSamples = nbrOfSamples;
+    m_seed = seed;
+    m_strata.clear();
+
+    if(m_sampling == LatinHypercube)
+    {
+        // independent random permutation of the strata for each axis (Fisher-Yates)
+        auto service = RandomService::createRandomService(m_seed, 0);
+        for(size_t a = 0; a < m_axes.size(); a++)
+        {
+            RandomStream stream = service->getStream(RandomService::UserDomain, a);
+            std::vector<size_t> strata(m_nbrOfSamples);
+            for(size_t k = 0; k < m_nbrOfSamples; k++)
+            {
+                strata[k] = k;
+            }
+            for(size_t k = m_nbrOfSamples; k > 1; k--)
+            {
+                size_t j = std::min<size_t>(stream.uniform() * k, k - 1);
+                std::swap(strata[k - 1], strata[j]);
+            }
+            m_strata.push_back(strata);
+        }
+    }
+}
+
+size_t ParameterSweep::numberOfPoints() const
+{
+    if(m_axes.empty())
+    {
+        return 0;
+    }
+
+    if(m_sampling != Grid)
+    {
+        return m_nbrOfSamples;
+    }
+
+    size_t n = 1;
+    for(const auto& axis: m_axes)
+    {
+        n *= axis.values.size();
+    }
+    return n;
+}
+
+ParameterPoint ParameterSweep::point(size_t index) const
+{
+    ParameterPoint p;
+    p.index = index;
+    p.names = axisNames();
+    p.values.resize(m_axes.size());
+
+    if(m_sampling == Grid)
+    {
+        // mixed radix, the last axis changes fastest
+        size_t rest = index;
+        for(size_t a = m_axes.size(); a > 0; a--)
+        {
+            const auto& values = m_axes[a - 1].values;
+            p.values[a - 1] = values[rest % values.size()];
+            rest /= values.size();
+        }
+    }
+    else
+    {
+        // the point's own stream -> points can be computed in any order
+        auto service = RandomService::createRandomService(m_seed, 0);
+        RandomStream stream = service->getStream(RandomService::UserDomain, m_axes.size() + index);
+        for(size_t a = 0; a < m_axes.size(); a++)
+        {
+            double u = stream.uniform();
+            if(m_sampling == LatinHypercube)
+            {
+                u = (m_strata[a][index] + u) / m_nbrOfSamples;
+            }
+            p.values[a] = m_axes[a].min + u * (m_axes[a].max - m_axes[a].min);
+        }
+    }
+
+    return p;
+}
+
+void ParameterSweep::setReplications(size_t replications)
+{
+    m_replications = std::max<size_t>(1, replications);
+}
+
+size_t ParameterSweep::replications() const
+{
+    return m_replications;
+}
+
+void ParameterSweep::setScenarioBuilder(ScenarioBuilder builder)
+{
+    m_builder = builder;
+}
+
+void ParameterSweep::setReduction(Reduction reduction)
+{
+    m_reduction = reduction;
+}
+
+Evaluation::ResultValues ParameterSweep::meanReduction(const std::vector<Evaluation::ResultValues> &replications)
+{
+    Evaluation::ResultValues mean = replications.front();
+    for(size_t r = 1; r < replications.size(); r++)
+    {
+        for(size_t k = 0; k < mean.size(); k++)
+        {
+            mean[k].second += replications[r][k].second;
+        }
+    }
+
+    for(auto& [name, value]: mean)
+    {
+        value /= replications.size();
+    }
+
+    return mean;
+}
+
+void ParameterSweep::setJournal(const std::string &path)
+{
+    m_journalPath = path;
+}
+
+size_t ParameterSweep::numberOfResumedPoints() const
+{
+    return m_nbrOfResumedPoints;
+}
+
+std::string ParameterSweep::journalHeader() const
+{
+    std::ostringstream s;
+    s << "H," << numberOfPoints() << "," << m_replications << "," << m_sampling << "," << m_seed;
+    for(const auto& axis: m_axes)
+    {
+        s << "," << axis.name;
+    }
+    return s.str();
+}
+
+bool ParameterSweep::readJournal(ResultTable &table, std::vector<bool> &finished) const
+{
+    // Line based: header, column names, one row per finished point. A line
+    // without newline was interrupted while writing and is ignored.
+    std::ifstream f(m_journalPath);
+    std::string line;
+    if(!std::getline(f, line) || f.eof() || line != journalHeader())
+    {
+        return false;
+    }
+
+    while(std::getline(f, line) && !f.eof())
+    {
+        std::istringstream fields(line);
+        std::string type, field;
+        std::getline(fields, type, ',');
+
+        if(type == "C")
+        {
+            std::vector<std::string> columns;
+            while(std::getline(fields, field, ','))
+            {
+                columns.push_back(field);
+            }
+            table = ResultTable(columns);
+        }
+        else if(type == "R" && table.numberOfColumns() > 0)
+        {
+            std::vector<double> row;
+            while(std::getline(fields, field, ','))
+            {
+                row.push_back(std::strtod(field.c_str(), nullptr));
+            }
+
+            size_t pointIdx = size_t(row.front());
+            if(row.size() == table.numberOfColumns() && pointIdx < finished.size() && !finished[pointIdx])
+            {
+                table.addRow(row);
+                finished[pointIdx] = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+void ParameterSweep::writeJournalRow(std::ofstream &journal, const ResultTable &table, size_t row) const
+{
+    if(row == 0)
+    {
+        journal << "C";
+        for(const auto& name: table.columnNames())
+        {
+            journal << "," << name;
+        }
+        journal << "\n";
+    }
+
+    journal << "R";
+    for(const auto& name: table.columnNames())
+    {
+        journal << "," << table.value(row, name);
+    }
+    journal << "\n";
+    journal.flush();
+}
+
+void ParameterSweep::setStopWhenFinished(bool stop)
+{
+    m_stopWhenFinished = stop;
+}
+
+void ParameterSweep::setCostEstimator(PointCostEstimator estimator)
+{
+    m_costEstimator = estimator;
+}
+
+void ParameterSweep::setCostModel(std::shared_ptr<CostModel> model)
+{
+    m_costModel = model;
+}
+
+void ParameterSweep::setResultCache(std::shared_ptr<ResultCache> cache)
+{
+    m_resultCache = cache;
+}
+
+const std::vector<size_t> &ParameterSweep::failedPoints() const
+{
+    return m_failedPoints;
+}
+
+void ParameterSweep::beginRun(RunState &state)
+{
+    assert(m_builder);
+
+    std::vector<bool> finished(numberOfPoints(), false);
+    m_nbrOfResumedPoints = 0;
+    m_failedPoints.clear();
+
+    if(!m_journalPath.empty())
+    {
+        if(!readJournal(state.table, finished))
+        {
+            state.table = ResultTable();
+        }
+
+        // rewrite the journal with the valid content only, then append to it
+        std::string tmpPath = m_journalPath + ".tmp";
+        state.journal.open(tmpPath);
+        state.journal.precision(17);
+        state.journal << journalHeader() << "\n";
+        for(size_t r = 0; r < state.table.numberOfRows(); r++)
+        {
+            writeJournalRow(state.journal, state.table, r);
+        }
+        state.journal.close();
+        std::rename(tmpPath.c_str(), m_journalPath.c_str());
+        state.journal.open(m_journalPath, std::ios::app);
+
+        m_nbrOfResumedPoints = state.table.numberOfRows();
+    }
+
+    // the points still to simulate
+    for(size_t k = 0; k < finished.size(); k++)
+    {
+        if(!finished[k])
+        {
+            state.todo.push_back(k);
+        }
+    }
+}
+
+unsigned int ParameterSweep::simulationId(const RunState &state, size_t idx) const
+{
+    // simulation ids do not depend on resuming -> same random streams
+    return state.todo[idx / m_replications] * m_replications + idx % m_replications;
+}
+
+std::string ParameterSweep::scenarioKey(const ParameterPoint &point, size_t replication)
+{
+    std::ostringstream key;
+    key << std::setprecision(17);
+    for(size_t k = 0; k < point.names.size(); k++)
+    {
+        key << point.names[k] << "=" << point.values[k] << " ";
+    }
+    key << "replication=" << replication;
+    return key.str();
+}
+
+std::shared_ptr<Simulation> ParameterSweep::buildSimulation(unsigned int simId) const
+{
+    ParameterPoint p = point(simId / m_replications);
+    auto sim = m_builder(p, simId);
+    assert(sim->id() == simId);
+
+    // equal points of other sweeps get the same random streams and cached results
+    std::string key = scenarioKey(p, simId % m_replications);
+    sim->setScenarioKey(key);
+    sim->setStreamId(RandomService::streamIdOf(key));
+    return sim;
+}
+
+Evaluation::ResultValues ParameterSweep::simulate(std::shared_ptr<Simulation> sim, double timeStep, double duration, bool lookupCache) const
+{
+    std::string cacheKey;
+    Evaluation::ResultValues values;
+    if(m_resultCache)
+    {
+        cacheKey = ResultCache::key(sim, timeStep, duration, m_stopWhenFinished);
+        if(lookupCache && m_resultCache->lookup(cacheKey, values))
+        {
+            return values;
+        }
+    }
+
+    sim->initEnvironment();
+    sim->initAgents();
+    if(m_stopWhenFinished)
+    {
+        sim->runSimulationUntilFinished(timeStep, duration);
+    }
+    else
+    {
+        sim->runSimulation(timeStep, duration);
+    }
+    values = sim->getEvaluation()->getResultValues();
+
+    if(m_resultCache && !values.empty())
+    {
+        m_resultCache->store(cacheKey, values);
+    }
+    return values;
+}
+
+void ParameterSweep::addResult(RunState &state, unsigned int simId, const Evaluation::ResultValues &values)
+{
+    size_t pointIdx = simId / m_replications;
+    auto& replications = state.pending[pointIdx];
+    replications.push_back(values);
+    if(replications.size() < m_replications)
+    {
+        return;
+    }
+
+    Evaluation::ResultValues reduced = m_reduction(replications);
+    state.pending.erase(pointIdx);
+
+    // values already given by the point are not repeated
+    ParameterPoint p = point(pointIdx);
+    reduced.erase(std::remove_if(reduced.begin(), reduced.end(), [&p](const auto& v)
+    {
+        return std::find(p.names.begin(), p.names.end(), v.first) != p.names.end();
+    }), reduced.end());
+
+    ResultTable& table = state.table;
+    if(table.numberOfColumns() == 0)
+    {
+        std::vector<std::string> columns = {"point"};
+        columns.insert(columns.end(), p.names.begin(), p.names.end());
+        for(const auto& [name, value]: reduced)
+        {
+            columns.push_back(name);
+        }
+        table = ResultTable(columns);
+    }
+
+    std::vector<double> row = {double(pointIdx)};
+    row.insert(row.end(), p.values.begin(), p.values.end());
+    for(const auto& [name, value]: reduced)
+    {
+        row.push_back(value);
+    }
+    table.addRow(row);
+
+    if(state.journal.is_open())
+    {
+        writeJournalRow(state.journal, table, table.numberOfRows() - 1);
+    }
+}
+
+void ParameterSweep::endRun(RunState &state)
+{
+    // points of which not all replications succeeded
+    std::vector<bool> done(numberOfPoints(), false);
+    if(state.table.numberOfRows() > 0)
+    {
+        for(double pointIdx: state.table.column("point"))
+        {
+            done[size_t(pointIdx)] = true;
+        }
+    }
+
+    for(size_t pointIdx: state.todo)
+    {
+        if(!done[pointIdx])
+        {
+            m_failedPoints.push_back(pointIdx);
+        }
+    }
+}
+
+ResultTable ParameterSweep::run(std::shared_ptr<Parallel> parallel, double timeStep, double duration)
+{
+    RunState state;
+    beginRun(state);
+
+    // the sink is never called concurrently
+    parallel->setResultSink(CallbackResultSink::createCallbackResultSink([this, &state](const SimulationResult& result)
+    {
+        if(m_costModel && result.wallSeconds > 0.0)
+        {
+            m_costModel->addObservation(point(result.simulationId / m_replications).values, result.wallSeconds);
+        }
+        addResult(state, result.simulationId, result.values);
+    }));
+
+    Parallel::IndexCostEstimator cost;
+    if(m_costEstimator)
+    {
+        cost = [this, &state](size_t idx) { return m_costEstimator(point(state.todo[idx / m_replications])); };
+    }
+    else if(m_costModel && m_costModel->numberOfObservations() > 0)
+    {
+        cost = [this, &state](size_t idx) { return m_costModel->estimate(point(state.todo[idx / m_replications]).values); };
+    }
+
+    parallel->addSimulationGenerator(state.todo.size() * m_replications, [this, &state](size_t idx)
+    {
+        return buildSimulation(simulationId(state, idx));
+    }, timeStep, duration, cost);
+
+    if(m_stopWhenFinished)
+    {
+        parallel->setStopWhenFinished(true);
+    }
+
+    if(m_resultCache)
+    {
+        parallel->setResultCache(m_resultCache);
+    }
+
+    parallel->run();
+    parallel->wait();
+    parallel->setResultSink(nullptr);
+    parallel->setResultCache(nullptr);
+
+    endRun(state);
+    return state.table;
+}
+
+ResultTable ParameterSweep::runProcesses(size_t nProcesses, double timeStep, double duration, size_t maxRetries)
+{
+    RunState state;
+    beginRun(state);
+
+    ProcessPool pool(nProcesses);
+    pool.setMaxRetries(maxRetries);
+
+    // each task is one simulation, run in a worker process
+    pool.run(state.todo.size() * m_replications, [this, &state, timeStep, duration](size_t idx)
+    {
+        // the cache is shared by the worker processes through the file system
+        return simulate(buildSimulation(simulationId(state, idx)), timeStep, duration);
+    },
+    [this, &state](size_t idx, const Evaluation::ResultValues& values)
+    {
+        addResult(state, simulationId(state, idx), values);
+    });
+
+    endRun(state);
+    return state.table;
+}
+
+ResultTable ParameterSweep::runLockstep(size_t nThreads, size_t batchSize, BatchEvaluationBuilder evaluationBuilder,
+                                        double timeStep, double duration)
+{
+    RunState state;
+    beginRun(state);
+
+    size_t nSimulations = state.todo.size() * m_replications;
+    batchSize = std::max<size_t>(1, batchSize);
+    size_t nBatches = (nSimulations + batchSize - 1) / batchSize;
+
+    std::atomic_size_t nextBatch(0);
+    std::mutex resultMutex;
+    auto work = [&]()
+    {
+        for(size_t b = nextBatch++; b < nBatches; b = nextBatch++)
+        {
+            auto batch = LockstepBatch::createLockstepBatch();
+            std::vector<std::string> cacheKeys; // of the batch runs
+            size_t end = std::min(nSimulations, (b + 1) * batchSize);
+            for(size_t idx = b * batchSize; idx < end; idx++)
+            {
+                auto sim = buildSimulation(simulationId(state, idx));
+
+                std::string cacheKey;
+                Evaluation::ResultValues values;
+                bool cached = false;
+                if(m_resultCache)
+                {
+                    cacheKey = ResultCache::key(sim, timeStep, duration, m_stopWhenFinished);
+                    cached = m_resultCache->lookup(cacheKey, values);
+                }
+
+                if(!cached && batch->addRun(sim))
+                {
+                    cacheKeys.push_back(cacheKey);
+                    continue;
+                }
+
+                // cached, or not fit for the batch
+                if(!cached)
+                {
+                    values = simulate(sim, timeStep, duration, false);
+                }
+                std::unique_lock<std::mutex> lock(resultMutex);
+                addResult(state, sim->id(), values);
+            }
+
+            if(batch->numberOfRuns() == 0)
+            {
+                continue;
+            }
+
+            auto evaluation = evaluationBuilder(batch->numberOfRuns());
+            batch->setEvaluation(evaluation);
+            if(m_stopWhenFinished)
+            {
+                batch->runUntilFinished(timeStep, duration);
+            }
+            else
+            {
+                batch->run(timeStep, duration);
+            }
+
+            for(size_t r = 0; r < batch->numberOfRuns(); r++)
+            {
+                auto values = evaluation->getResultValues(*batch, r);
+                if(m_resultCache && !values.empty())
+                {
+                    m_resultCache->store(cacheKeys[r], values);
+                }
+
+                std::unique_lock<std::mutex> lock(resultMutex);
+                addResult(state, batch->simulationId(r), values);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t k = 1; k < std::max<size_t>(1, nThreads); k++)
+    {
+        threads.push_back(std::thread(work));
+    }
+    work();
+    for(auto& t: threads)
+    {
+        t.join();
+    }
+
+    endRun(state);
+    return state.table;
+}
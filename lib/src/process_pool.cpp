@@ -0,0 +1,402 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <deque>
+#include <string>
+#include <cerrno>
+#include <cstdint>
+#include <algorithm>
+
+#include "process_pool.h"
+
+#if defined(__unix__)
+#define MAF_PROCESS_POOL
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#endif
+
+ProcessPool::ProcessPool(size_t nProcesses) : m_nbrProcesses(std::max<size_t>(1, nProcesses)), m_maxRetries(1),
+    m_nbrOfLostWorkers(0)
+{
+
+}
+
+ProcessPool::~ProcessPool()
+{
+
+}
+
+void ProcessPool::setMaxRetries(size_t retries)
+{
+    m_maxRetries = retries;
+}
+
+const std::vector<size_t> &ProcessPool::failedTasks() const
+{
+    return m_failedTasks;
+}
+
+size_t ProcessPool::numberOfLostWorkers() const
+{
+    return m_nbrOfLostWorkers;
+}
+
+#ifdef MAF_PROCESS_POOL
+
+namespace
+{
+    bool writeAll(int fd, const void* data, size_t size)
+    {
+        const char* p = static_cast<const char*>(data);
+        while(size > 0)
+        {
+            // no SIGPIPE if the other side died
+            ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                return false;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool readAll(int fd, void* data, size_t size)
+    {
+        char* p = static_cast<char*>(data);
+        while(size > 0)
+        {
+            ssize_t n = read(fd, p, size);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                return false;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // result message: task index, success flag, number of values, (name length, name, value)...
+    std::string encodeResult(uint64_t taskIdx, bool ok, const Evaluation::ResultValues& values)
+    {
+        std::string msg;
+        auto append = [&msg](const void* data, size_t size) { msg.append(static_cast<const char*>(data), size); };
+
+        uint8_t okFlag = ok ? 1 : 0;
+        uint32_t nValues = values.size();
+        append(&taskIdx, sizeof(taskIdx));
+        append(&okFlag, sizeof(okFlag));
+        append(&nValues, sizeof(nValues));
+        for(const auto& [name, value]: values)
+        {
+            uint32_t nameLength = name.size();
+            append(&nameLength, sizeof(nameLength));
+            append(name.data(), name.size());
+            append(&value, sizeof(value));
+        }
+        return msg;
+    }
+
+    bool readResult(int fd, uint64_t& taskIdx, bool& ok, Evaluation::ResultValues& values)
+    {
+        uint8_t okFlag;
+        uint32_t nValues;
+        if(!readAll(fd, &taskIdx, sizeof(taskIdx)) || !readAll(fd, &okFlag, sizeof(okFlag)) ||
+           !readAll(fd, &nValues, sizeof(nValues)))
+        {
+            return false;
+        }
+
+        ok = okFlag != 0;
+        values.resize(nValues);
+        for(auto& [name, value]: values)
+        {
+            uint32_t nameLength;
+            if(!readAll(fd, &nameLength, sizeof(nameLength)))
+                return false;
+
+            name.resize(nameLength);
+            if((nameLength > 0 && !readAll(fd, &name[0], nameLength)) || !readAll(fd, &value, sizeof(value)))
+                return false;
+        }
+        return true;
+    }
+
+    struct Worker
+    {
+        pid_t pid = -1;
+        int fd = -1;
+        bool busy = false;
+        size_t taskIdx = 0;
+    };
+
+    void workerMain(int fd, ProcessPool::Task& task)
+    {
+        uint64_t taskIdx;
+        while(readAll(fd, &taskIdx, sizeof(taskIdx)))
+        {
+            std::string msg;
+            try
+            {
+                msg = encodeResult(taskIdx, true, task(taskIdx));
+            }
+            catch(...)
+            {
+                msg = encodeResult(taskIdx, false, {});
+            }
+
+            if(!writeAll(fd, msg.data(), msg.size()))
+                break;
+        }
+    }
+
+    bool spawn(Worker& w, std::vector<Worker>& workers, ProcessPool::Task& task)
+    {
+        int fds[2];
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            return false;
+
+        pid_t pid = fork();
+        if(pid < 0)
+        {
+            close(fds[0]);
+            close(fds[1]);
+            return false;
+        }
+
+        if(pid == 0)
+        {
+            // worker: keep only the own socket, so that the parent notices
+            // when another worker dies
+            close(fds[0]);
+            for(const auto& other: workers)
+            {
+                if(other.fd >= 0)
+                    close(other.fd);
+            }
+
+            workerMain(fds[1], task);
+
+            // skip atexit handlers and destructors of the parent's objects
+            _exit(0);
+        }
+
+        close(fds[1]);
+        w.pid = pid;
+        w.fd = fds[0];
+        w.busy = false;
+        return true;
+    }
+
+    void shutdown(Worker& w)
+    {
+        if(w.fd >= 0)
+        {
+            close(w.fd); // the worker leaves its loop
+            w.fd = -1;
+        }
+
+        if(w.pid > 0)
+        {
+            int status;
+            while(waitpid(w.pid, &status, 0) < 0 && errno == EINTR) {}
+            w.pid = -1;
+        }
+    }
+}
+
+size_t ProcessPool::run(size_t count, Task task, ResultCallback callback)
+{
+    m_failedTasks.clear();
+    m_nbrOfLostWorkers = 0;
+
+    std::deque<size_t> todo;
+    for(size_t k = 0; k < count; k++)
+    {
+        todo.push_back(k);
+    }
+    std::vector<size_t> attempts(count, 0);
+    size_t nSucceeded = 0;
+
+    std::vector<Worker> workers(std::min(m_nbrProcesses, std::max<size_t>(1, count)));
+    for(auto& w: workers)
+    {
+        spawn(w, workers, task);
+    }
+
+    auto failedAttempt = [&](size_t taskIdx)
+    {
+        if(attempts[taskIdx] <= m_maxRetries)
+            todo.push_back(taskIdx);
+        else
+            m_failedTasks.push_back(taskIdx);
+    };
+
+    auto assign = [&](Worker& w)
+    {
+        while(!w.busy && !todo.empty() && w.fd >= 0)
+        {
+            uint64_t taskIdx = todo.front();
+            if(!writeAll(w.fd, &taskIdx, sizeof(taskIdx)))
+                return false;
+
+            todo.pop_front();
+            attempts[taskIdx]++;
+            w.busy = true;
+            w.taskIdx = taskIdx;
+        }
+        return true;
+    };
+
+    while(true)
+    {
+        // hand out tasks, replace workers which could not be reached
+        for(auto& w: workers)
+        {
+            if(w.fd < 0 && !todo.empty())
+            {
+                spawn(w, workers, task);
+            }
+
+            if(!assign(w))
+            {
+                shutdown(w);
+                m_nbrOfLostWorkers++;
+            }
+        }
+
+        std::vector<pollfd> pfds;
+        std::vector<Worker*> polled;
+        for(auto& w: workers)
+        {
+            if(w.busy)
+            {
+                pfds.push_back({w.fd, POLLIN, 0});
+                polled.push_back(&w);
+            }
+        }
+
+        if(pfds.empty())
+        {
+            // nothing running: either all done or no worker could be started
+            for(size_t taskIdx: todo)
+            {
+                m_failedTasks.push_back(taskIdx);
+            }
+            break;
+        }
+
+        if(poll(pfds.data(), pfds.size(), -1) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        for(size_t k = 0; k < pfds.size(); k++)
+        {
+            if(pfds[k].revents == 0)
+                continue;
+
+            Worker& w = *polled[k];
+            uint64_t taskIdx;
+            bool ok;
+            Evaluation::ResultValues values;
+            if(readResult(w.fd, taskIdx, ok, values) && taskIdx == w.taskIdx)
+            {
+                w.busy = false;
+                if(ok)
+                {
+                    nSucceeded++;
+                    callback(taskIdx, values);
+                }
+                else
+                {
+                    failedAttempt(taskIdx);
+                }
+            }
+            else
+            {
+                // the worker died while running its task
+                w.busy = false;
+                shutdown(w);
+                m_nbrOfLostWorkers++;
+                failedAttempt(w.taskIdx);
+            }
+        }
+    }
+
+    for(auto& w: workers)
+    {
+        shutdown(w);
+    }
+
+    std::sort(m_failedTasks.begin(), m_failedTasks.end());
+    return nSucceeded;
+}
+
+#else
+
+size_t ProcessPool::run(size_t count, Task task, ResultCallback callback)
+{
+    // no worker processes: run the tasks here, one after the other
+    m_failedTasks.clear();
+    m_nbrOfLostWorkers = 0;
+    size_t nSucceeded = 0;
+
+    for(size_t taskIdx = 0; taskIdx < count; taskIdx++)
+    {
+        bool ok = false;
+        Evaluation::ResultValues values;
+        for(size_t attempt = 0; attempt <= m_maxRetries && !ok; attempt++)
+        {
+            try
+            {
+                values = task(taskIdx);
+                ok = true;
+            }
+            catch(...)
+            {
+            }
+        }
+
+        if(ok)
+        {
+            nSucceeded++;
+            callback(taskIdx, values);
+        }
+        else
+        {
+            m_failedTasks.push_back(taskIdx);
+        }
+    }
+
+    return nSucceeded;
+}
+
+#endif
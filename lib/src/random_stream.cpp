@@ -0,0 +1,181 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include "random_stream.h"
+
+namespace
+{
+    // splitmix64 finalizer, used to derive keys from seeds
+    uint64_t mixBits(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+}
+
+RandomStream::RandomStream(uint64_t key, uint64_t streamId) : m_key(key), m_streamId(streamId),
+    m_blockCounter(0), m_block({0, 0, 0, 0}), m_blockPos(4)
+{
+
+}
+
+RandomStream::~RandomStream()
+{
+
+}
+
+RandomStream::result_type RandomStream::operator()()
+{
+    if(m_blockPos >= 4)
+    {
+        generateBlock();
+    }
+
+    return m_block[m_blockPos++];
+}
+
+double RandomStream::uniform()
+{
+    // 53 random bits -> [0, 1)
+    uint64_t a = (*this)() >> 5;
+    uint64_t b = (*this)() >> 6;
+    return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+}
+
+void RandomStream::discard(uint64_t n)
+{
+    // consume what is left in the current block, then jump over whole blocks
+    while(n > 0 && m_blockPos < 4)
+    {
+        m_blockPos++;
+        n--;
+    }
+
+    m_blockCounter += n / 4;
+    if(n % 4 > 0)
+    {
+        generateBlock();
+        m_blockPos = n % 4;
+    }
+}
+
+uint64_t RandomStream::key() const
+{
+    return m_key;
+}
+
+uint64_t RandomStream::streamId() const
+{
+    return m_streamId;
+}
+
+void RandomStream::generateBlock()
+{
+    std::array<uint32_t, 4> counter = {static_cast<uint32_t>(m_blockCounter), static_cast<uint32_t>(m_blockCounter >> 32),
+                                       static_cast<uint32_t>(m_streamId), static_cast<uint32_t>(m_streamId >> 32)};
+    std::array<uint32_t, 2> key = {static_cast<uint32_t>(m_key), static_cast<uint32_t>(m_key >> 32)};
+
+    m_block = philox(counter, key);
+    m_blockCounter++;
+    m_blockPos = 0;
+}
+
+std::array<uint32_t, 4> RandomStream::philox(const std::array<uint32_t, 4>& counter, const std::array<uint32_t, 2>& key)
+{
+    const uint64_t m0 = 0xD2511F53;
+    const uint64_t m1 = 0xCD9E8D57;
+    const uint32_t w0 = 0x9E3779B9;
+    const uint32_t w1 = 0xBB67AE85;
+
+    std::array<uint32_t, 4> c = counter;
+    std::array<uint32_t, 2> k = key;
+
+    for(int round = 0; round < 10; round++)
+    {
+        uint64_t p0 = m0 * c[0];
+        uint64_t p1 = m1 * c[2];
+
+        c = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0], static_cast<uint32_t>(p1),
+             static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1], static_cast<uint32_t>(p0)};
+
+        k[0] += w0;
+        k[1] += w1;
+    }
+
+    return c;
+}
+
+
+// Random service
+
+std::shared_ptr<RandomService> RandomService::createRandomService(uint64_t masterSeed, unsigned int simulationId)
+{
+    return std::shared_ptr<RandomService>(new RandomService(masterSeed, simulationId));
+}
+
+RandomService::RandomService(uint64_t masterSeed, unsigned int simulationId) : m_masterSeed(masterSeed),
+    m_simulationId(simulationId)
+{
+    m_key = mixBits(mixBits(masterSeed) ^ simulationId);
+}
+
+RandomService::~RandomService()
+{
+
+}
+
+uint64_t RandomService::masterSeed() const
+{
+    return m_masterSeed;
+}
+
+unsigned int RandomService::simulationId() const
+{
+    return m_simulationId;
+}
+
+unsigned int RandomService::streamIdOf(const std::string &text)
+{
+    // FNV-1a, folded to the width of the id
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c: text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash = mixBits(hash);
+    return static_cast<unsigned int>(hash ^ (hash >> 32));
+}
+
+RandomStream RandomService::getStream(StreamDomain domain, unsigned int id) const
+{
+    uint64_t streamId = (static_cast<uint64_t>(domain) << 32) | id;
+    return RandomStream(m_key, streamId);
+}
+
+RandomStream RandomService::getAgentStream(unsigned int agentId) const
+{
+    return getStream(AgentDomain, agentId);
+}
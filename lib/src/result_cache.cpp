@@ -0,0 +1,211 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <random>
+#include <typeinfo>
+#include <filesystem>
+
+#include "result_cache.h"
+
+#ifndef MAF_VERSION
+#define MAF_VERSION "unknown"
+#endif
+
+namespace
+{
+    const std::string CacheFileHeader = "MAFC 2";
+
+    uint64_t fnv1a(const std::string& text)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for(unsigned char c: text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+std::shared_ptr<ResultCache> ResultCache::createResultCache(const std::string &directory)
+{
+    return std::shared_ptr<ResultCache>(new ResultCache(directory));
+}
+
+ResultCache::ResultCache(const std::string &directory) : m_directory(directory), m_hits(0), m_misses(0)
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    m_isOpen = std::filesystem::is_directory(m_directory, error);
+}
+
+bool ResultCache::isOpen() const
+{
+    return m_isOpen;
+}
+
+std::string ResultCache::key(std::shared_ptr<Simulation> sim, double timeStep, double duration, bool stopWhenFinished)
+{
+    // the key is stored in the cache file as well -> one line per entry
+    std::ostringstream key;
+    key << std::setprecision(17);
+    key << "version " << libraryVersion() << "\n";
+    if(sim->scenarioKey().empty())
+    {
+        key << "simulation " << sim->id() << "\n";
+    }
+    else
+    {
+        key << "scenario " << sim->scenarioKey() << "\n";
+    }
+    key << "stream " << sim->streamId() << "\n";
+    key << "seed " << sim->masterSeed() << "\n";
+    key << "time_step " << timeStep << "\n";
+    key << "duration " << duration << "\n";
+    key << "stop_when_finished " << stopWhenFinished << "\n";
+
+    auto agentFactory = sim->agentFactory();
+    key << "agent_factory " << typeid(*agentFactory).name() << " " << agentFactory->configuration() << "\n";
+
+    auto environmentFactory = sim->environmentFactory();
+    key << "environment_factory " << typeid(*environmentFactory).name() << " " << environmentFactory->configuration() << "\n";
+
+    auto evaluation = sim->getEvaluation();
+    key << "evaluation " << typeid(*evaluation).name() << "\n";
+
+    return key.str();
+}
+
+bool ResultCache::lookup(const std::string &key, Evaluation::ResultValues &values)
+{
+    std::ifstream f(filePath(key));
+
+    std::string line;
+    bool found = f.is_open() && std::getline(f, line) && line == CacheFileHeader;
+
+    // the stored key must match, not only its hash
+    std::istringstream keyLines(key);
+    std::string keyLine;
+    while(found && std::getline(keyLines, keyLine))
+    {
+        found = std::getline(f, line) && line == keyLine;
+    }
+
+    size_t nValues = 0;
+    found = found && std::getline(f, line) && (std::istringstream(line) >> nValues);
+
+    Evaluation::ResultValues read;
+    while(found && read.size() < nValues)
+    {
+        // value first, the name may contain anything
+        double value;
+        std::string name;
+        std::istringstream fields;
+        found = static_cast<bool>(std::getline(f, line));
+        fields.str(line);
+        found = found && (fields >> value) && fields.get() == ' ' && std::getline(fields, name);
+        if(found)
+        {
+            read.emplace_back(name, value);
+        }
+    }
+
+    if(found)
+    {
+        values = read;
+        m_hits++;
+    }
+    else
+    {
+        m_misses++;
+    }
+    return found;
+}
+
+bool ResultCache::store(const std::string &key, const Evaluation::ResultValues &values)
+{
+    if(!m_isOpen)
+    {
+        return false;
+    }
+
+    // unique temporary file -> concurrent writers of the same key do not interfere
+    std::string path = filePath(key);
+    std::string tmpPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream f(tmpPath);
+        if(!f.is_open())
+        {
+            return false;
+        }
+
+        f << std::setprecision(17);
+        f << CacheFileHeader << "\n" << key << values.size() << "\n";
+        for(const auto& [name, value]: values)
+        {
+            f << value << " " << name << "\n";
+        }
+
+        if(!f.good())
+        {
+            f.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if(error)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+size_t ResultCache::hits() const
+{
+    return m_hits;
+}
+
+size_t ResultCache::misses() const
+{
+    return m_misses;
+}
+
+std::string ResultCache::libraryVersion()
+{
+    return MAF_VERSION;
+}
+
+std::string ResultCache::filePath(const std::string &key) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(key) << ".result";
+    return (std::filesystem::path(m_directory) / name.str()).string();
+}
@@ -0,0 +1,196 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <cstring>
+
+#include "result_sink.h"
+
+namespace
+{
+    const char BinaryMagic[4] = {'M', 'A', 'F', 'R'};
+    const uint32_t BinaryVersion = 1;
+
+    template<typename T>
+    void writeValue(std::ofstream& f, const T& value)
+    {
+        f.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(std::ofstream& f, const std::string& str)
+    {
+        writeValue<uint32_t>(f, str.size());
+        f.write(str.data(), str.size());
+    }
+
+    template<typename T>
+    bool readValue(std::ifstream& f, T& value)
+    {
+        return bool(f.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    bool readString(std::ifstream& f, std::string& str)
+    {
+        uint32_t size;
+        if(!readValue(f, size))
+            return false;
+
+        str.resize(size);
+        return size == 0 || bool(f.read(&str[0], size));
+    }
+
+    std::string csvQuoted(const std::string& str)
+    {
+        std::string quoted = "\"";
+        for(char c: str)
+        {
+            if(c == '"')
+                quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+}
+
+std::shared_ptr<CallbackResultSink> CallbackResultSink::createCallbackResultSink(Callback callback)
+{
+    return std::shared_ptr<CallbackResultSink>(new CallbackResultSink(callback));
+}
+
+CallbackResultSink::CallbackResultSink(Callback callback) : m_callback(callback)
+{
+
+}
+
+void CallbackResultSink::write(const SimulationResult &result)
+{
+    m_callback(result);
+}
+
+std::shared_ptr<CsvResultSink> CsvResultSink::createCsvResultSink(const std::string &path)
+{
+    return std::shared_ptr<CsvResultSink>(new CsvResultSink(path));
+}
+
+CsvResultSink::CsvResultSink(const std::string &path) : m_file(path), m_headerWritten(false)
+{
+    m_file.precision(17);
+}
+
+bool CsvResultSink::isOpen() const
+{
+    return m_file.is_open();
+}
+
+void CsvResultSink::write(const SimulationResult &result)
+{
+    if(!m_headerWritten)
+    {
+        m_file << "simulation_id,description";
+        for(const auto& [name, value]: result.values)
+        {
+            m_file << "," << csvQuoted(name);
+        }
+        m_file << "\n";
+        m_headerWritten = true;
+    }
+
+    m_file << result.simulationId << "," << csvQuoted(result.description);
+    for(const auto& [name, value]: result.values)
+    {
+        m_file << "," << value;
+    }
+    m_file << "\n";
+}
+
+void CsvResultSink::flush()
+{
+    m_file.flush();
+}
+
+std::shared_ptr<BinaryResultSink> BinaryResultSink::createBinaryResultSink(const std::string &path)
+{
+    return std::shared_ptr<BinaryResultSink>(new BinaryResultSink(path));
+}
+
+BinaryResultSink::BinaryResultSink(const std::string &path) : m_file(path, std::ios::binary)
+{
+    m_file.write(BinaryMagic, sizeof(BinaryMagic));
+    writeValue(m_file, BinaryVersion);
+}
+
+bool BinaryResultSink::isOpen() const
+{
+    return m_file.is_open();
+}
+
+void BinaryResultSink::write(const SimulationResult &result)
+{
+    // record: id, description, number of values, (name, value)...
+    writeValue<uint32_t>(m_file, result.simulationId);
+    writeString(m_file, result.description);
+    writeValue<uint32_t>(m_file, result.values.size());
+    for(const auto& [name, value]: result.values)
+    {
+        writeString(m_file, name);
+        writeValue<double>(m_file, value);
+    }
+}
+
+void BinaryResultSink::flush()
+{
+    m_file.flush();
+}
+
+bool BinaryResultSink::read(const std::string &path, CallbackResultSink::Callback callback)
+{
+    std::ifstream f(path, std::ios::binary);
+
+    char magic[4];
+    uint32_t version;
+    if(!f.read(magic, sizeof(magic)) || std::memcmp(magic, BinaryMagic, sizeof(magic)) != 0 ||
+       !readValue(f, version) || version != BinaryVersion)
+    {
+        return false;
+    }
+
+    SimulationResult result;
+    uint32_t id;
+    while(readValue(f, id))
+    {
+        uint32_t nValues;
+        result.simulationId = id;
+        if(!readString(f, result.description) || !readValue(f, nValues))
+            return false;
+
+        result.values.resize(nValues);
+        for(auto& [name, value]: result.values)
+        {
+            if(!readString(f, name) || !readValue(f, value))
+                return false;
+        }
+
+        callback(result);
+    }
+
+    return true;
+}
@@ -0,0 +1,132 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <cassert>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+
+#include "result_table.h"
+
+ResultTable::ResultTable(const std::vector<std::string> &columnNames) : m_columnNames(columnNames),
+    m_columns(columnNames.size())
+{
+
+}
+
+ResultTable::~ResultTable()
+{
+
+}
+
+const std::vector<std::string> &ResultTable::columnNames() const
+{
+    return m_columnNames;
+}
+
+size_t ResultTable::numberOfColumns() const
+{
+    return m_columnNames.size();
+}
+
+size_t ResultTable::numberOfRows() const
+{
+    return m_columns.empty() ? 0 : m_columns.front().size();
+}
+
+size_t ResultTable::columnIndex(const std::string &name) const
+{
+    auto it = std::find(m_columnNames.begin(), m_columnNames.end(), name);
+    return it == m_columnNames.end() ? NoColumn : std::distance(m_columnNames.begin(), it);
+}
+
+const std::vector<double> &ResultTable::column(const std::string &name) const
+{
+    size_t idx = columnIndex(name);
+    assert(idx != NoColumn);
+    return m_columns[idx];
+}
+
+double ResultTable::value(size_t row, const std::string &name) const
+{
+    return column(name).at(row);
+}
+
+void ResultTable::addRow(const std::vector<double> &values)
+{
+    assert(values.size() == m_columns.size());
+    for(size_t c = 0; c < m_columns.size(); c++)
+    {
+        m_columns[c].push_back(values[c]);
+    }
+}
+
+void ResultTable::sortByColumn(const std::string &name, bool ascending)
+{
+    const std::vector<double>& key = column(name);
+
+    std::vector<size_t> order(numberOfRows());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&key, ascending](size_t a, size_t b)
+    {
+        return ascending ? key[a] < key[b] : key[a] > key[b];
+    });
+
+    // apply the permutation column by column
+    std::vector<double> sorted(order.size());
+    for(auto& col: m_columns)
+    {
+        for(size_t r = 0; r < order.size(); r++)
+        {
+            sorted[r] = col[order[r]];
+        }
+        col.swap(sorted);
+    }
+}
+
+bool ResultTable::writeCsv(const std::string &path) const
+{
+    std::ofstream f(path);
+    if(!f.is_open())
+    {
+        return false;
+    }
+
+    f.precision(17);
+    for(size_t c = 0; c < m_columnNames.size(); c++)
+    {
+        f << (c > 0 ? "," : "") << m_columnNames[c];
+    }
+    f << "\n";
+
+    for(size_t r = 0; r < numberOfRows(); r++)
+    {
+        for(size_t c = 0; c < m_columns.size(); c++)
+        {
+            f << (c > 0 ? "," : "") << m_columns[c][r];
+        }
+        f << "\n";
+    }
+
+    return bool(f);
+}
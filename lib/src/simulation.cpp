@@ -23,6 +23,7 @@
 
 #include <iostream>
 #include <chrono>
+#include <typeinfo>
 using namespace std::chrono_literals;
 
 #include "simulation.h"
@@ -33,11 +34,12 @@ std::shared_ptr<Simulation> Simulation::createSimulation(unsigned int id)
     return std::shared_ptr<Simulation>(new Simulation(id));
 }
 
-Simulation::Simulation(unsigned int id): m_id(id), m_simulationRunningTime(0.0)
+Simulation::Simulation(unsigned int id): m_id(id), m_streamId(id), m_simulationRunningTime(0.0)
 {
     // set default dummy evaluation
     m_evaluation = std::shared_ptr<Evaluation>(new Evaluation());
     m_description = "";
+    m_randomService = RandomService::createRandomService(0, id);
 }
 
 Simulation::~Simulation()
@@ -92,13 +94,40 @@ std::shared_ptr<Evaluation> Simulation::getEvaluation()
 
 void Simulation::initEnvironment()
 {
-    m_environment = m_environmentFactory->createEnvironment();
+    // each run gets its own event log
+    m_eventLog.reset();
+    if(!m_eventLogDirectory.empty())
+    {
+        m_eventLog = EventLog::createEventLog(m_eventLogDirectory + "/events_" + std::to_string(m_id) + ".mafe");
+    }
+
+    if(m_environment && m_environmentReset)
+    {
+        // reset in place -> just apply the settings of this run
+        m_environmentReset = false;
+    }
+    else
+    {
+        m_environment = m_environmentFactory->createEnvironment();
+    }
+
     m_environment->setEnableLogMessages(m_enableLogMessages);
+    m_environment->setLogger(m_logger);
+    m_environment->setEventLog(m_eventLog);
+    m_environment->setRandomService(m_randomService);
 }
 
 void Simulation::initAgents()
 {
-    auto agents = m_agentFactory->createAgents();
+    m_agentFactory->setRandomStream(m_randomService->getStream(RandomService::FactoryDomain, 0));
+
+    // agents of the previous run are reused by a factory of the same kind
+    bool reuse = m_agentsReset && m_agentsFactory && typeid(*m_agentsFactory) == typeid(*m_agentFactory);
+    auto agents = reuse ? m_agentFactory->resetAgents(m_agents) : m_agentFactory->createAgents();
+    m_agentsReset = false;
+    m_agents = agents;
+    m_agentsFactory = m_agentFactory;
+
     std::for_each(agents.begin(), agents.end(), [=] (std::shared_ptr<Agent>& a)
     {
         a->setEnvironment(m_environment);
@@ -112,6 +141,10 @@ void Simulation::doTimeStep(double time)
 
     {
         m_simulationRunningTime += time;
+        if(m_eventLog)
+        {
+            m_eventLog->setTime(m_simulationRunningTime);
+        }
         m_environment->update(time);
         m_evaluation->evaluate(shared_from_this(), time);
     }
@@ -126,6 +159,32 @@ std::shared_ptr<Environment> Simulation::getEnvironment()
     return m_environment;
 }
 
+void Simulation::releaseEnvironment()
+{
+    m_environment.reset();
+    m_agents.clear();
+    m_agentsFactory.reset();
+    m_agentsReset = false;
+    m_environmentReset = false;
+}
+
+void Simulation::reset(unsigned int id, uint64_t masterSeed)
+{
+    m_id = id;
+    m_streamId = id;
+    m_scenarioKey.clear();
+    m_simulationRunningTime = 0.0;
+    m_computationTime = 0;
+    m_randomService = RandomService::createRandomService(masterSeed, id);
+
+    if(m_environment)
+    {
+        m_environment->reset();
+        m_environmentReset = true;
+        m_agentsReset = !m_agents.empty();
+    }
+}
+
 double Simulation::getSimulationRunningTime() const
 {
     return m_simulationRunningTime;
@@ -137,6 +196,7 @@ void Simulation::runSimulation(double timeStep, double simulationDuration)
     {
         doTimeStep(timeStep);
     }
+    flushEventLog();
 }
 
 void Simulation::runSimulation(double timeStep)
@@ -145,6 +205,16 @@ void Simulation::runSimulation(double timeStep)
     {
         doTimeStep(timeStep);
     }
+    flushEventLog();
+}
+
+void Simulation::runSimulationUntilFinished(double timeStep, double maxDuration)
+{
+    while( m_simulationRunningTime < maxDuration && !m_evaluation->isSimulationFinished(this->shared_from_this()) )
+    {
+        doTimeStep(timeStep);
+    }
+    flushEventLog();
 }
 
 int Simulation::getComputationTime() const
@@ -152,7 +222,82 @@ int Simulation::getComputationTime() const
     return m_computationTime;
 }
 
+void Simulation::setLogger(std::shared_ptr<AsyncLogger> logger)
+{
+    m_logger = logger;
+}
+
+std::shared_ptr<AsyncLogger> Simulation::logger() const
+{
+    return m_logger;
+}
+
+void Simulation::setEventLogDirectory(const std::string &directory)
+{
+    m_eventLogDirectory = directory;
+}
+
+std::string Simulation::eventLogDirectory() const
+{
+    return m_eventLogDirectory;
+}
+
+std::shared_ptr<EventLog> Simulation::eventLog() const
+{
+    return m_eventLog;
+}
+
+void Simulation::flushEventLog()
+{
+    // the run is complete -> readers see all events
+    if(m_eventLog)
+    {
+        m_eventLog->flush();
+    }
+}
+
 void Simulation::setEnableLogMessages(bool enable)
 {
     m_enableLogMessages = enable;
 }
+
+bool Simulation::enableLogMessages() const
+{
+    return m_enableLogMessages;
+}
+
+void Simulation::setMasterSeed(uint64_t seed)
+{
+    m_randomService = RandomService::createRandomService(seed, m_streamId);
+}
+
+void Simulation::setStreamId(unsigned int streamId)
+{
+    m_streamId = streamId;
+    m_randomService = RandomService::createRandomService(masterSeed(), m_streamId);
+}
+
+unsigned int Simulation::streamId() const
+{
+    return m_streamId;
+}
+
+void Simulation::setScenarioKey(const std::string &key)
+{
+    m_scenarioKey = key;
+}
+
+std::string Simulation::scenarioKey() const
+{
+    return m_scenarioKey;
+}
+
+uint64_t Simulation::masterSeed() const
+{
+    return m_randomService->masterSeed();
+}
+
+std::shared_ptr<RandomService> Simulation::getRandomService() const
+{
+    return m_randomService;
+}
@@ -0,0 +1,404 @@
+/****************************************************************************
+** Copyright (c) 2021 Adrian Schneider
+**
+** Permission is hereby granted, free of charge, to any person obtaining a
+** copy of this software and associated documentation files (the "Software"),
+** to deal in the Software without restriction, including without limitation
+** the rights to use, copy, modify, merge, publish, distribute, sublicense,
+** and/or sell copies of the Software, and to permit persons to whom the
+** Software is furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in
+** all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+** FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+** DEALINGS IN THE SOFTWARE.
+**
+*****************************************************************************/
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+#include "tiled_environment.h"
+#include "distance_kernel.h"
+
+namespace
+{
+    // Message lists of the tile which is updated by the current thread
+    thread_local std::vector<std::shared_ptr<Message>>* t_outbox = nullptr;
+    thread_local std::vector<std::shared_ptr<Message>>* t_delivered = nullptr;
+}
+
+std::shared_ptr<TiledEnvironment> TiledEnvironment::createTiledEnvironment(unsigned int id, double tileSize,
+                                                                           double haloWidth, size_t nThreads)
+{
+    return std::shared_ptr<TiledEnvironment>(new TiledEnvironment(id, tileSize, haloWidth, nThreads));
+}
+
+TiledEnvironment::TiledEnvironment(unsigned int id, double tileSize, double haloWidth, size_t nThreads) :
+    Environment(id), m_tileSize(tileSize), m_haloWidth(haloWidth), m_nThreads(std::max<size_t>(1, nThreads)),
+    m_messageDelivery(EndOfStep), m_nMigrations(0), m_job(nullptr), m_nJobs(0), m_nextJob(0),
+    m_jobGeneration(0), m_nBusyWorkers(0), m_stopWorkers(false)
+{
+
+}
+
+TiledEnvironment::~TiledEnvironment()
+{
+    stopWorkers();
+}
+
+double TiledEnvironment::tileSize() const
+{
+    return m_tileSize;
+}
+
+double TiledEnvironment::haloWidth() const
+{
+    return m_haloWidth;
+}
+
+size_t TiledEnvironment::numberOfThreads() const
+{
+    return m_nThreads;
+}
+
+size_t TiledEnvironment::numberOfTiles() const
+{
+    return m_tiles.size();
+}
+
+size_t TiledEnvironment::numberOfMigrations() const
+{
+    return m_nMigrations;
+}
+
+void TiledEnvironment::setMessageDelivery(MessageDelivery delivery)
+{
+    m_messageDelivery = delivery;
+}
+
+TiledEnvironment::MessageDelivery TiledEnvironment::messageDelivery() const
+{
+    return m_messageDelivery;
+}
+
+TiledEnvironment::TileKey TiledEnvironment::tileOf(const Eigen::Vector2d &pos) const
+{
+    return {static_cast<long>(std::floor(pos.x() / m_tileSize)), static_cast<long>(std::floor(pos.y() / m_tileSize))};
+}
+
+void TiledEnvironment::update(double time)
+{
+    m_messageArena.reset();
+    computeTiledDistances();
+
+    // every agent gets a message queue before the parallel update -> the map is not modified concurrently
+    for(const auto& a: getAgents())
+    {
+        m_msgMap[a->id()];
+    }
+
+    runParallel(m_tiles.size(), [this, time](size_t tileIdx)
+    {
+        updateTileAgents(m_tiles[tileIdx], time);
+    });
+
+    deliverTileMessages();
+}
+
+void TiledEnvironment::reset()
+{
+    Environment::reset();
+
+    m_tiles.clear();
+    m_tileIndex.clear();
+    m_agentTile.clear();
+    m_slotOfAgent.clear();
+    m_slotDistances.clear();
+    m_nMigrations = 0;
+
+    // started again by the next update
+    stopWorkers();
+}
+
+void TiledEnvironment::updateTileAgents(Tile &tile, double time)
+{
+    t_outbox = &tile.outbox;
+    t_delivered = &tile.delivered;
+
+    for(auto& a: tile.updateAgents)
+    {
+        a->update(time);
+    }
+
+    t_outbox = nullptr;
+    t_delivered = nullptr;
+}
+
+void TiledEnvironment::deliverTileMessages()
+{
+    // deliver the messages of this step in tile order -> independent of thread timing
+    for(Tile& tile: m_tiles)
+    {
+        for(auto& m: tile.delivered)
+        {
+            notifyMessage(m);
+        }
+        tile.delivered.clear();
+
+        for(auto& m: tile.outbox)
+        {
+            Environment::sendMessage(m);
+        }
+        tile.outbox.clear();
+    }
+}
+
+void TiledEnvironment::computeTiledDistances()
+{
+    m_tiles.clear();
+    m_tileIndex.clear();
+    m_slotOfAgent.clear();
+    m_slotDistances.clear();
+
+    auto getTile = [this](const TileKey& key) -> Tile&
+    {
+        auto it = m_tileIndex.find(key);
+        if(it == m_tileIndex.end())
+        {
+            it = m_tileIndex.insert({key, m_tiles.size()}).first;
+            m_tiles.push_back(Tile());
+            m_tiles.back().key = key;
+        }
+        return m_tiles[it->second];
+    };
+
+    // top level agents are updated by the tile of their position
+    m_nMigrations = 0;
+    for(auto& a: m_agents)
+    {
+        TileKey key = tileOf(a->getPosition());
+        getTile(key).updateAgents.push_back(a);
+
+        auto before = m_agentTile.find(a->id());
+        if(before != m_agentTile.end() && before->second != key)
+        {
+            m_nMigrations++;
+        }
+        m_agentTile[a->id()] = key;
+    }
+
+    // enabled agents incl. sub agents take part in the distance computation
+    for(const auto& a: getAgents())
+    {
+        if(a->getEnabled())
+        {
+            getTile(tileOf(a->getPosition())).distanceAgents.push_back(a.get());
+            size_t slot = m_slotOfAgent.size();
+            m_slotOfAgent[a->id()] = slot;
+        }
+    }
+    m_slotDistances.resize(m_slotOfAgent.size());
+
+    runParallel(m_tiles.size(), [this](size_t tileIdx)
+    {
+        computeTileDistances(m_tiles[tileIdx]);
+    });
+}
+
+void TiledEnvironment::computeTileDistances(Tile &tile)
+{
+    if(tile.distanceAgents.empty())
+    {
+        return;
+    }
+
+    // collect own agents and the halo: agents of neighbouring tiles within halo width of this tile
+    std::vector<Agent*> candidates = tile.distanceAgents;
+
+    Eigen::Vector2d tileMin(tile.key.first * m_tileSize, tile.key.second * m_tileSize);
+    Eigen::Vector2d tileMax = tileMin + Eigen::Vector2d(m_tileSize, m_tileSize);
+    long ring = static_cast<long>(std::ceil(m_haloWidth / m_tileSize));
+
+    for(long ix = tile.key.first - ring; ix <= tile.key.first + ring; ix++)
+    {
+        for(long iy = tile.key.second - ring; iy <= tile.key.second + ring; iy++)
+        {
+            auto it = m_tileIndex.find({ix, iy});
+            if(it == m_tileIndex.end() || it->first == tile.key)
+            {
+                continue;
+            }
+
+            for(Agent* a: m_tiles[it->second].distanceAgents)
+            {
+                Eigen::Vector2d p = a->getPosition();
+                Eigen::Vector2d closest = p.cwiseMax(tileMin).cwiseMin(tileMax);
+                if((p - closest).norm() < m_haloWidth)
+                {
+                    candidates.push_back(a);
+                }
+            }
+        }
+    }
+
+    size_t n = candidates.size();
+    std::vector<double> x(n), y(n), dx(n), dy(n), d(n);
+    for(size_t k = 0; k < n; k++)
+    {
+        x[k] = candidates[k]->getPosition().x();
+        y[k] = candidates[k]->getPosition().y();
+    }
+
+    // distances of own agents to all candidates within halo width
+    for(size_t i = 0; i < tile.distanceAgents.size(); i++)
+    {
+        DistanceKernel::computeBlock(x[i], y[i], x.data(), y.data(), n, dx.data(), dy.data(), d.data());
+
+        DistanceQueue& q = m_slotDistances[m_slotOfAgent.at(candidates[i]->id())];
+        for(size_t k = 0; k < n; k++)
+        {
+            if(k != i && d[k] < m_haloWidth)
+            {
+                q.push({d[k], candidates[k]->id(), Eigen::Vector2d(dx[k], dy[k])});
+            }
+        }
+    }
+}
+
+void TiledEnvironment::runParallel(size_t nJobs, const std::function<void(size_t)>& job)
+{
+    if(m_nThreads == 1 || nJobs <= 1)
+    {
+        for(size_t k = 0; k < nJobs; k++)
+        {
+            job(k);
+        }
+        return;
+    }
+
+    // the calling thread is one of the workers
+    if(m_workers.empty())
+    {
+        m_stopWorkers = false;
+        for(size_t t = 1; t < m_nThreads; t++)
+        {
+            m_workers.push_back(std::thread(&TiledEnvironment::workerLoop, this, m_jobGeneration));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_workerMutex);
+        m_job = &job;
+        m_nJobs = nJobs;
+        m_nextJob = 0;
+        m_nBusyWorkers = m_workers.size();
+        m_jobGeneration++;
+    }
+    m_workerCondition.notify_all();
+
+    runJobs();
+
+    std::unique_lock<std::mutex> lock(m_workerMutex);
+    m_workersDoneCondition.wait(lock, [this]() { return m_nBusyWorkers == 0; });
+    m_job = nullptr;
+}
+
+void TiledEnvironment::runJobs()
+{
+    for(size_t k = m_nextJob++; k < m_nJobs; k = m_nextJob++)
+    {
+        (*m_job)(k);
+    }
+}
+
+void TiledEnvironment::workerLoop(size_t generation)
+{
+    std::unique_lock<std::mutex> lock(m_workerMutex);
+    while(true)
+    {
+        m_workerCondition.wait(lock, [this, generation]() { return m_stopWorkers || m_jobGeneration != generation; });
+        if(m_stopWorkers)
+        {
+            return;
+        }
+        generation = m_jobGeneration;
+
+        lock.unlock();
+        runJobs();
+        lock.lock();
+
+        if(--m_nBusyWorkers == 0)
+        {
+            m_workersDoneCondition.notify_one();
+        }
+    }
+}
+
+void TiledEnvironment::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_workerMutex);
+        m_stopWorkers = true;
+    }
+    m_workerCondition.notify_all();
+
+    for(std::thread& t: m_workers)
+    {
+        t.join();
+    }
+    m_workers.clear();
+}
+
+EnvironmentInterface::DistanceQueue TiledEnvironment::getAgentDistancesToAllOtherAgents(unsigned int id)
+{
+    auto it = m_slotOfAgent.find(id);
+    if(it == m_slotOfAgent.end())
+    {
+        return DistanceQueue();
+    }
+
+    return m_slotDistances[it->second];
+}
+
+void TiledEnvironment::sendMessage(std::shared_ptr<Message> aMessage)
+{
+    if(t_outbox != nullptr)
+    {
+        // sent during parallel update
+        auto receiverBox = m_msgMap.find(aMessage->receiverId());
+        if(receiverBox != m_msgMap.end() && deliverImmediately(*aMessage))
+        {
+            // lock-free push, log and listeners at end of step
+            receiverBox->second.push(aMessage);
+            t_delivered->push_back(aMessage);
+        }
+        else
+        {
+            t_outbox->push_back(aMessage);
+        }
+    }
+    else
+    {
+        Environment::sendMessage(aMessage);
+    }
+}
+
+bool TiledEnvironment::deliverImmediately(const Message& /*aMessage*/) const
+{
+    return m_messageDelivery == Immediate;
+}
+
+void TiledEnvironment::log(LogLevel level, const std::string &logMsg)
+{
+    std::lock_guard<std::mutex> lock(m_logMutex);
+    Environment::log(level, logMsg);
+}
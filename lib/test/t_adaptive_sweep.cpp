@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include "adaptive_sweep.h"
+
+namespace
+{
+    // step of the metric at a = 0.37
+    class StepEvaluation: public Evaluation
+    {
+    public:
+        StepEvaluation(double a) : m_a(a) {}
+
+        ResultValues getResultValues() override
+        {
+            return {{"a", m_a}, {"step", m_a > 0.37 ? 1.0 : 0.0}};
+        }
+
+        double m_a;
+    };
+
+    // reports the stream id the sweep assigned to the simulation
+    class StreamEvaluation: public Evaluation
+    {
+    public:
+        StreamEvaluation(Simulation* sim, double a) : m_sim(sim), m_a(a) {}
+
+        ResultValues getResultValues() override
+        {
+            return {{"step", m_a > 0.37 ? 1.0 : 0.0}, {"stream", double(m_sim->streamId())}};
+        }
+
+        Simulation* m_sim;
+        double m_a;
+    };
+
+    ParameterSweep::ScenarioBuilder stepBuilder()
+    {
+        return [](const ParameterPoint& point, unsigned int simId)
+        {
+            auto s = Simulation::createSimulation(simId);
+            s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+            s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+            s->setEnableLogMessages(false);
+            s->setEvaluation(std::shared_ptr<Evaluation>(new StepEvaluation(point["a"])));
+            return s;
+        };
+    }
+}
+
+TEST(AdaptiveSweep, Refine1D)
+{
+    auto sweep = AdaptiveSweep::createAdaptiveSweep();
+    sweep->addAxis("a", 0.0, 1.0, 5);
+    sweep->setScenarioBuilder(stepBuilder());
+    sweep->setRefinement("step", 0.5, 4);
+
+    auto table = sweep->run(2, 0.5, 1.0);
+
+    // 5 coarse points, then one midpoint per level in the cell containing the step
+    ASSERT_EQ(table.numberOfRows(), 9);
+    ASSERT_EQ(table.columnNames(), std::vector<std::string>({"point", "a", "level", "step"}));
+
+    // the step is bracketed at the finest resolution 0.25 / 16
+    table.sortByColumn("a");
+    double below = 0.0;
+    double above = 1.0;
+    for(size_t r = 0; r < table.numberOfRows(); r++)
+    {
+        double a = table.value(r, "a");
+        if(table.value(r, "step") == 0.0)
+            below = std::max(below, a);
+        else
+            above = std::min(above, a);
+    }
+
+    ASSERT_LE(below, 0.37);
+    ASSERT_GT(above, 0.37);
+    ASSERT_DOUBLE_EQ(above - below, 0.25 / 16);
+    ASSERT_EQ(table.value(0, "level"), 0);
+    ASSERT_TRUE(sweep->failedPoints().empty());
+}
+
+TEST(AdaptiveSweep, FailedCornersAreNotRefined)
+{
+    auto builder = stepBuilder();
+    auto sweep = AdaptiveSweep::createAdaptiveSweep();
+    sweep->addAxis("a", 0.0, 1.0, 5);
+    sweep->setScenarioBuilder([builder](const ParameterPoint& point, unsigned int simId)
+    {
+        if(point["a"] == 0.5)
+        {
+            throw std::runtime_error("invalid scenario");
+        }
+        return builder(point, simId);
+    });
+    sweep->setRefinement("step", 0.5, 4);
+
+    auto table = sweep->run(2, 0.5, 1.0);
+
+    // the step lies in the cell of the failed corner: nothing is refined
+    ASSERT_EQ(table.numberOfRows(), 4);
+    for(size_t r = 0; r < table.numberOfRows(); r++)
+    {
+        ASSERT_EQ(table.value(r, "level"), 0);
+    }
+
+    ASSERT_EQ(sweep->failedPoints().size(), 1);
+    ASSERT_EQ(sweep->failedPoints()[0]["a"], 0.5);
+}
+
+TEST(AdaptiveSweep, StreamIdsOfPointValues)
+{
+    auto sweep = AdaptiveSweep::createAdaptiveSweep();
+    sweep->addAxis("a", 0.0, 1.0, 5);
+    sweep->setScenarioBuilder([](const ParameterPoint& point, unsigned int simId)
+    {
+        auto s = Simulation::createSimulation(simId);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        s->setEvaluation(std::shared_ptr<Evaluation>(new StreamEvaluation(s.get(), point["a"])));
+        return s;
+    });
+    sweep->setRefinement("step", 0.5, 3);
+
+    // the stream of a point only depends on its values, not on when it was refined
+    auto table = sweep->run(2, 0.5, 1.0);
+    ASSERT_GT(table.numberOfRows(), 5);
+    for(size_t r = 0; r < table.numberOfRows(); r++)
+    {
+        ParameterPoint p;
+        p.names = {"a"};
+        p.values = {table.value(r, "a")};
+        ASSERT_EQ(table.value(r, "stream"), RandomService::streamIdOf(ParameterSweep::scenarioKey(p, 0)));
+    }
+}
+
+TEST(AdaptiveSweep, Refine2D)
+{
+    auto sweep = AdaptiveSweep::createAdaptiveSweep();
+    sweep->addAxis("a", 0.0, 1.0, 5);
+    sweep->addAxis("b", 0.0, 1.0, 5);
+    sweep->setScenarioBuilder(stepBuilder());
+    sweep->setRefinement("step", 0.5, 3);
+
+    auto table = sweep->run(3, 0.5, 1.0);
+
+    // refinement only along the line a = 0.37: much less than the full fine grid
+    size_t fullGrid = 33 * 33;
+    ASSERT_GT(table.numberOfRows(), 25);
+    ASSERT_LT(table.numberOfRows(), fullGrid / 4);
+
+    // no point was simulated twice
+    table.sortByColumn("point");
+    for(size_t r = 0; r < table.numberOfRows(); r++)
+    {
+        ASSERT_EQ(table.value(r, "point"), r);
+    }
+
+    // far from the step, the grid stays coarse
+    for(size_t r = 0; r < table.numberOfRows(); r++)
+    {
+        if(table.value(r, "level") > 0)
+        {
+            ASSERT_GE(table.value(r, "a"), 0.25);
+            ASSERT_LE(table.value(r, "a"), 0.5);
+        }
+    }
+}
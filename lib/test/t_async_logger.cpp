@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+
+#include "async_logger.h"
+#include "environment.h"
+
+namespace
+{
+    // stream buffer which blocks the writer till opened, to fill the ring
+    class GateBuffer: public std::stringbuf
+    {
+    public:
+        void open()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_open = true;
+            m_condition.notify_all();
+        }
+
+        bool writerWaiting() const
+        {
+            return m_waiting;
+        }
+
+    protected:
+        int sync() override
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_waiting = true;
+            m_condition.wait(lock, [this] { return m_open; });
+            return 0;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_open = false;
+        std::atomic_bool m_waiting{false};
+    };
+
+    size_t countLines(const std::string& s)
+    {
+        return std::count(s.begin(), s.end(), '\n');
+    }
+}
+
+TEST(AsyncLogger, WritesInOrder)
+{
+    std::ostringstream out;
+    {
+        auto logger = AsyncLogger::createAsyncLogger(out, 100);
+        ASSERT_EQ(logger->capacity(), 128);
+        ASSERT_EQ(logger->overflowPolicy(), AsyncLogger::Drop);
+
+        for(int k = 0; k < 1000; k++)
+        {
+            logger->log("line " + std::to_string(k));
+        }
+        logger->flush();
+
+        auto c = logger->counters();
+        ASSERT_EQ(c.logged + c.dropped, 1000);
+        ASSERT_EQ(c.written, c.logged);
+        ASSERT_EQ(countLines(out.str()), c.logged);
+
+        // long texts are cut
+        logger->log(std::string(AsyncLogger::MaxTextLength + 10, 'x'));
+        logger->logMessage(Message(3, 4, Message::Hit));
+    }
+
+    // the destructor writes the rest
+    std::string s = out.str();
+    ASSERT_EQ(s.find("line 0\n"), 0);
+    ASSERT_NE(s.find(std::string(AsyncLogger::MaxTextLength, 'x') + "\n"), std::string::npos);
+    ASSERT_NE(s.find("Message: " + Message(3, 4, Message::Hit).toString() + "\n"), std::string::npos);
+}
+
+TEST(AsyncLogger, DropWhenFull)
+{
+    GateBuffer buffer;
+    std::ostream out(&buffer);
+    auto logger = AsyncLogger::createAsyncLogger(out, 16, AsyncLogger::Drop);
+
+    // the writer blocks on its first flush -> then only the ring is filled
+    logger->log("first");
+    while(!buffer.writerWaiting())
+    {
+        std::this_thread::yield();
+    }
+    for(int k = 0; k < 100; k++)
+    {
+        logger->log("x");
+    }
+    auto c = logger->counters();
+    ASSERT_EQ(c.logged, 17);
+    ASSERT_EQ(c.dropped, 84);
+    ASSERT_EQ(c.blocked, 0);
+
+    buffer.open();
+    logger->flush();
+    ASSERT_EQ(logger->counters().written, c.logged);
+    ASSERT_EQ(countLines(buffer.str()), c.logged);
+}
+
+TEST(AsyncLogger, BlockWhenFull)
+{
+    GateBuffer buffer;
+    std::ostream out(&buffer);
+    auto logger = AsyncLogger::createAsyncLogger(out, 16, AsyncLogger::Block);
+
+    logger->log("first");
+    while(!buffer.writerWaiting())
+    {
+        std::this_thread::yield();
+    }
+
+    std::thread producer([&logger]()
+    {
+        for(int k = 0; k < 99; k++)
+        {
+            logger->log("x");
+        }
+    });
+
+    // the producer waits for space till the writer continues
+    while(logger->counters().blocked == 0)
+    {
+        std::this_thread::yield();
+    }
+    buffer.open();
+    producer.join();
+    logger->flush();
+
+    auto c = logger->counters();
+    ASSERT_EQ(c.logged, 100);
+    ASSERT_EQ(c.dropped, 0);
+    ASSERT_EQ(c.written, 100);
+    ASSERT_EQ(countLines(buffer.str()), 100);
+}
+
+TEST(AsyncLogger, Environment)
+{
+    std::ostringstream out;
+    auto logger = AsyncLogger::createAsyncLogger(out);
+
+    auto e = Environment::createEnvironment(1);
+    auto a1 = Agent::createAgent(10);
+    a1->setEnvironment(e);
+    e->addAgent(a1);
+    e->setLogger(logger);
+
+    e->log("hello");
+    a1->sendMessage(20, Message::Disable);
+    e->setEnableLogMessages(false);
+    e->log("hidden");
+    a1->sendMessage(20, Message::Enable);
+    logger->flush();
+
+    ASSERT_EQ(out.str(), "hello\nMessage: " + Message(10, 20, Message::Disable).toString() + "\n");
+    ASSERT_EQ(logger->counters().logged, 2);
+}
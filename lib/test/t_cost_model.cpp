@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+
+#include "cost_model.h"
+
+TEST(CostModel, Estimate)
+{
+    auto model = CostModel::createCostModel(2);
+    ASSERT_EQ(model->numberOfObservations(), 0);
+    ASSERT_EQ(model->estimate({1.0, 1.0}), 0.0);
+
+    model->addObservation({0.0, 10.0}, 1.0);
+    model->addObservation({1.0, 10.0}, 3.0);
+    model->addObservation({4.0, 30.0}, 9.0);
+    model->addObservation({1.0}, 100.0); // other number of features -> ignored
+    ASSERT_EQ(model->numberOfObservations(), 3);
+
+    // observed features are estimated by their cost
+    ASSERT_DOUBLE_EQ(model->estimate({1.0, 10.0}), 3.0);
+
+    // in the middle of the two nearest observations
+    ASSERT_DOUBLE_EQ(model->estimate({0.5, 10.0}), 2.0);
+
+    // closer to an observation -> closer to its cost
+    double e = model->estimate({3.5, 28.0});
+    ASSERT_GT(e, 6.0);
+    ASSERT_LT(e, 9.0);
+}
+
+TEST(CostModel, SaveLoad)
+{
+    std::string path = "t_cost_model.txt";
+
+    auto model = CostModel::createCostModel();
+    model->addObservation({0.1, 2.0}, 0.25);
+    model->addObservation({0.3, 1.0}, 1.0 / 3.0);
+    ASSERT_TRUE(model->save(path));
+
+    auto loaded = CostModel::createCostModel();
+    ASSERT_TRUE(loaded->load(path));
+    ASSERT_EQ(loaded->numberOfObservations(), 2);
+    ASSERT_DOUBLE_EQ(loaded->estimate({0.3, 1.0}), 1.0 / 3.0);
+    ASSERT_DOUBLE_EQ(loaded->estimate({0.1, 2.0}), 0.25);
+
+    ASSERT_FALSE(loaded->load("t_cost_model_missing.txt"));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+
+#include "cpu_topology.h"
+
+TEST(CpuTopology, ParseCpuList)
+{
+    ASSERT_EQ(CpuTopology::parseCpuList("0-3,8,10-11\n"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_EQ(CpuTopology::parseCpuList("5"), std::vector<int>({5}));
+    ASSERT_TRUE(CpuTopology::parseCpuList("").empty());
+}
+
+TEST(CpuTopology, SparseNodeNumbers)
+{
+    std::vector<int> allowed;
+    for(const auto& node: CpuTopology::numaNodes())
+    {
+        allowed.insert(allowed.end(), node.cpus.begin(), node.cpus.end());
+    }
+    if(allowed.empty())
+    {
+        return;
+    }
+
+    // node1 is missing, node0 and node10 have no allowed CPUs
+    std::string dir = "t_cpu_topology_nodes";
+    std::filesystem::remove_all(dir);
+    for(auto [name, cpus]: {std::make_pair("node0", std::string("100000")),
+                            std::make_pair("node2", std::to_string(allowed.front())),
+                            std::make_pair("node10", std::string("100001")),
+                            std::make_pair("online", std::string("0-1"))})
+    {
+        std::filesystem::create_directories(dir + "/" + name);
+        std::ofstream(dir + "/" + name + "/cpulist") << cpus << "\n";
+    }
+
+    auto nodes = CpuTopology::numaNodes(dir);
+    ASSERT_EQ(nodes.size(), 1);
+    ASSERT_EQ(nodes[0].id, 2);
+    ASSERT_EQ(nodes[0].cpus, std::vector<int>({allowed.front()}));
+    ASSERT_EQ(CpuTopology::nodeOfCpu(allowed.front(), dir), 2);
+    ASSERT_EQ(CpuTopology::nodeOfCpu(100000, dir), -1);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(CpuTopology, WorkerCpus)
+{
+    auto nodes = CpuTopology::numaNodes();
+    auto cpus = CpuTopology::workerCpus(5);
+
+    if(nodes.empty())
+    {
+        ASSERT_TRUE(cpus.empty());
+        return;
+    }
+
+    // the first workers are spread over the nodes
+    ASSERT_EQ(cpus.size(), 5);
+    for(size_t w = 0; w < std::min<size_t>(5, nodes.size()); w++)
+    {
+        ASSERT_EQ(CpuTopology::nodeOfCpu(cpus[w]), nodes[w].id);
+    }
+
+#if defined(__linux__)
+    // pin another thread, this one keeps its affinity
+    bool pinned = false;
+    std::thread([&pinned, &cpus] { pinned = CpuTopology::pinCurrentThread(cpus[0]); }).join();
+    ASSERT_TRUE(pinned);
+#endif
+}
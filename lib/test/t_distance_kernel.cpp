@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+
+#include "distance_kernel.h"
+#include "random_stream.h"
+
+TEST(DistanceKernel, Block)
+{
+    std::vector<double> x = {1.0, 4.0, -2.0};
+    std::vector<double> y = {1.0, 5.0, 1.0};
+    std::vector<double> dx(3), dy(3), d(3);
+
+    DistanceKernel::computeBlock(1.0, 1.0, x.data(), y.data(), 3, dx.data(), dy.data(), d.data());
+
+    ASSERT_DOUBLE_EQ(d[0], 0.0);
+    ASSERT_DOUBLE_EQ(dx[1], 3.0);
+    ASSERT_DOUBLE_EQ(dy[1], 4.0);
+    ASSERT_DOUBLE_EQ(d[1], 5.0);
+    ASSERT_DOUBLE_EQ(dx[2], -3.0);
+    ASSERT_DOUBLE_EQ(d[2], 3.0);
+}
+
+TEST(DistanceKernel, AllIsaEqual)
+{
+    RandomStream rnd(3, 0);
+
+    // odd size to run through all tail handlings
+    size_t n = 37;
+    std::vector<double> x(n), y(n);
+    for(size_t k = 0; k < n; k++)
+    {
+        x[k] = rnd.uniform() * 1000.0 - 500.0;
+        y[k] = rnd.uniform() * 1000.0 - 500.0;
+    }
+
+    auto initialIsa = DistanceKernel::activeIsa();
+
+    ASSERT_EQ(DistanceKernel::setIsa(DistanceKernel::Scalar), DistanceKernel::Scalar);
+    std::vector<double> rdx(n), rdy(n), rd(n);
+    DistanceKernel::computeBlock(3.3, -7.1, x.data(), y.data(), n, rdx.data(), rdy.data(), rd.data());
+
+    for(auto isa: {DistanceKernel::SSE2, DistanceKernel::AVX2, DistanceKernel::AVX512})
+    {
+        DistanceKernel::setIsa(isa);
+        std::vector<double> dx(n), dy(n), d(n);
+        DistanceKernel::computeBlock(3.3, -7.1, x.data(), y.data(), n, dx.data(), dy.data(), d.data());
+
+        for(size_t k = 0; k < n; k++)
+        {
+            ASSERT_EQ(dx[k], rdx[k]);
+            ASSERT_EQ(dy[k], rdy[k]);
+            ASSERT_EQ(d[k], rd[k]);
+            ASSERT_EQ(d[k], std::sqrt(dx[k]*dx[k] + dy[k]*dy[k]));
+        }
+    }
+
+    DistanceKernel::setIsa(initialIsa);
+    ASSERT_EQ(DistanceKernel::activeIsa(), DistanceKernel::detectIsa());
+}
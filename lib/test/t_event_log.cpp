@@ -0,0 +1,231 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <cstddef>
+#include "event_log.h"
+#include "simulation.h"
+#include "missile_station.h"
+
+namespace
+{
+    class PingAgent: public Agent
+    {
+    public:
+        PingAgent(unsigned int id) : Agent(id) {}
+
+        void update(double time) override
+        {
+            sendMessage(id() + 1, Message::Hit, {time, 2.0});
+            Agent::update(time);
+        }
+    };
+
+    class PingAgentFactory: public AgentFactory
+    {
+    public:
+        std::list<std::shared_ptr<Agent>> createAgents() override
+        {
+            return {std::make_shared<PingAgent>(1)};
+        }
+    };
+}
+
+TEST(EventLog, WriteAndRead)
+{
+    std::string path = "t_event_log.mafe";
+    {
+        auto log = EventLog::createEventLog(path);
+        ASSERT_TRUE(log->isOpen());
+        log->setTime(0.5);
+        log->append(Message(1, 2, Message::Disable));
+        log->setTime(1.0);
+        log->append(Message(3, 4, Message::Hit, "long text beyond the inline payload", {1.5, 2.5}, {7, -8, 9}));
+        EXPECT_EQ(log->numberOfEvents(), 2);
+    }
+
+    auto reader = EventLogReader::createEventLogReader(path);
+    ASSERT_TRUE(reader->isOpen());
+    ASSERT_EQ(reader->numberOfEvents(), 2);
+
+    auto it = reader->begin();
+    auto e = *it;
+    EXPECT_EQ(e.time(), 0.5);
+    EXPECT_EQ(e.senderId(), 1);
+    EXPECT_EQ(e.receiverId(), 2);
+    EXPECT_EQ(e.subject(), Message::Disable);
+    EXPECT_EQ(e.numberOfDoubleParams(), 0);
+    EXPECT_EQ(e.numberOfIntParams(), 0);
+    EXPECT_TRUE(e.textView().empty());
+
+    e = *(++it);
+    EXPECT_EQ(e.time(), 1.0);
+    EXPECT_EQ(e.subject(), Message::Hit);
+    ASSERT_EQ(e.numberOfDoubleParams(), 2);
+    EXPECT_EQ(e.doubleParam(1), 2.5);
+    ASSERT_EQ(e.numberOfIntParams(), 3);
+    EXPECT_EQ(e.intParam(1), -8);
+    EXPECT_EQ(e.textView(), "long text beyond the inline payload");
+    EXPECT_EQ(++it, reader->end());
+
+    // an incomplete last record is ignored
+    reader.reset();
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    reader = EventLogReader::createEventLogReader(path);
+    ASSERT_TRUE(reader->isOpen());
+    EXPECT_EQ(reader->numberOfEvents(), 1);
+
+    std::filesystem::remove(path);
+    EXPECT_FALSE(EventLogReader::createEventLogReader(path)->isOpen());
+}
+
+TEST(EventLog, EventKinds)
+{
+    std::string path = "t_event_log_kinds.mafe";
+    {
+        auto log = EventLog::createEventLog(path);
+        ASSERT_TRUE(log->isOpen());
+        log->append(Message(1, 2, Message::Disable));
+        log->setTime(2.0);
+        log->appendEvent(EventKind::Fire, 10, 2, {1.5, -2.5}, {11});
+        log->appendEvent(EventKind::Detonation, 11, 2);
+    }
+
+    auto reader = EventLogReader::createEventLogReader(path);
+    ASSERT_EQ(reader->numberOfEvents(), 3);
+
+    auto it = reader->begin();
+    EXPECT_EQ((*it).kind(), EventKind::MessageEvent);
+
+    auto e = *(++it);
+    EXPECT_EQ(e.kind(), EventKind::Fire);
+    EXPECT_EQ(e.time(), 2.0);
+    EXPECT_EQ(e.senderId(), 10);
+    EXPECT_EQ(e.receiverId(), 2);
+    ASSERT_EQ(e.numberOfDoubleParams(), 2);
+    EXPECT_EQ(e.doubleParam(1), -2.5);
+    ASSERT_EQ(e.numberOfIntParams(), 1);
+    EXPECT_EQ(e.intParam(0), 11);
+
+    e = *(++it);
+    EXPECT_EQ(e.kind(), EventKind::Detonation);
+    EXPECT_EQ(e.senderId(), 11);
+    EXPECT_EQ(e.numberOfDoubleParams(), 0);
+    EXPECT_EQ(e.numberOfIntParams(), 0);
+
+    std::filesystem::remove(path);
+}
+
+TEST(EventLog, CorruptPayloadSize)
+{
+    std::string path = "t_event_log_corrupt.mafe";
+    {
+        auto log = EventLog::createEventLog(path);
+        log->append(Message(1, 2, Message::Hit, {1.0}));
+        log->append(Message(1, 2, Message::Hit, "text", {2.0}));
+        log->append(Message(1, 2, Message::Disable));
+    }
+    size_t firstRecordSize = (*EventLogReader::createEventLogReader(path)->begin()).recordSize();
+
+    // the text of the second record claims more bytes than the record holds
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        uint32_t textLength = 1000;
+        file.seekp(8 + firstRecordSize + offsetof(EventLog::Record, textLength));
+        file.write(reinterpret_cast<const char*>(&textLength), sizeof(textLength));
+    }
+
+    auto reader = EventLogReader::createEventLogReader(path);
+    ASSERT_TRUE(reader->isOpen());
+    EXPECT_EQ(reader->numberOfEvents(), 1);
+
+    reader.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(EventLog, FireAndDetonation)
+{
+    std::string path = "t_event_log_missile.mafe";
+    auto log = EventLog::createEventLog(path);
+
+    auto e = Environment::createEnvironment(0);
+    e->setEnableLogMessages(false);
+    e->setEventLog(log);
+    auto s = std::shared_ptr<MissileStation>(new MissileStation(2000, 1, 5.0, 1.0));
+    s->setEnvironment(e);
+    s->setPosition(Eigen::Vector2d(1.0, 0.0));
+    e->addAgent(s);
+
+    auto a = Agent::createAgent(1);
+    a->setPosition(Eigen::Vector2d(1.0, 4.0));
+    a->setEnvironment(e);
+    e->addAgent(a);
+
+    for(int t = 0; t < 100; t++)
+    {
+        e->update(0.1);
+    }
+    log->flush();
+
+    auto reader = EventLogReader::createEventLogReader(path);
+    int nbrOfFires = 0;
+    int nbrOfDetonations = 0;
+    for(auto event: *reader)
+    {
+        if(event.kind() == EventKind::Fire)
+        {
+            nbrOfFires++;
+            EXPECT_EQ(event.senderId(), 2000);
+            EXPECT_EQ(event.receiverId(), 1);
+            ASSERT_EQ(event.numberOfDoubleParams(), 2);
+            EXPECT_EQ(event.doubleParam(0), 1.0);
+            ASSERT_EQ(event.numberOfIntParams(), 1);
+            EXPECT_EQ(event.intParam(0), 2002);
+        }
+        else if(event.kind() == EventKind::Detonation)
+        {
+            nbrOfDetonations++;
+            EXPECT_EQ(event.senderId(), 2002);
+            EXPECT_EQ(event.receiverId(), 1);
+            EXPECT_EQ(event.numberOfDoubleParams(), 2);
+        }
+    }
+    EXPECT_EQ(nbrOfFires, 1);
+    EXPECT_EQ(nbrOfDetonations, 1);
+
+    reader.reset();
+    std::filesystem::remove(path);
+}
+
+TEST(EventLog, Simulation)
+{
+    std::string dir = "t_event_log_sim";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+
+    auto s = Simulation::createSimulation(3);
+    s->setAgentFactory(std::make_shared<PingAgentFactory>());
+    s->setEnvironmentFactory(std::make_shared<EnvironmentFactory>());
+    s->setEnableLogMessages(false);
+    s->setEventLogDirectory(dir);
+    s->initEnvironment();
+    s->initAgents();
+    s->runSimulation(0.5, 2.0);
+
+    auto reader = EventLogReader::createEventLogReader(dir + "/events_3.mafe");
+    ASSERT_TRUE(reader->isOpen());
+    ASSERT_EQ(reader->numberOfEvents(), 4);
+
+    double time = 0.0;
+    for(auto e: *reader)
+    {
+        time += 0.5;
+        EXPECT_EQ(e.time(), time);
+        EXPECT_EQ(e.senderId(), 1);
+        EXPECT_EQ(e.receiverId(), 2);
+        ASSERT_EQ(e.numberOfDoubleParams(), 2);
+        EXPECT_EQ(e.doubleParam(0), 0.5);
+    }
+
+    s.reset();
+    std::filesystem::remove_all(dir);
+}
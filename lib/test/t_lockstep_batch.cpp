@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+#include <set>
+
+#include "lockstep_batch.h"
+#include "parameter_sweep.h"
+#include "missile_station.h"
+#include "plane.h"
+#include "target.h"
+#include "human.h"
+
+namespace
+{
+    // a small airdefence scenario: planes approach the target, two stations defend it
+    class DefenceAgentFactory: public AgentFactory
+    {
+    public:
+        DefenceAgentFactory(double planeSpeed, double missileSpeed, size_t nPlanes = 12) :
+            m_planeSpeed(planeSpeed), m_missileSpeed(missileSpeed), m_nPlanes(nPlanes) {}
+
+        std::list<std::shared_ptr<Agent>> createAgents() override
+        {
+            std::list<std::shared_ptr<Agent>> agents;
+            for(size_t i = 0; i < m_nPlanes; i++)
+            {
+                Eigen::Rotation2Dd t(6.28 / m_nPlanes * i);
+                auto hp = std::shared_ptr<HostilePlane>(new HostilePlane(20000 + i));
+                hp->setPosition(t.toRotationMatrix() * Eigen::Vector2d(60000.0 + i * 500.0, 0.0));
+                hp->setVelocityLimit(m_planeSpeed);
+                hp->setMovingTowardsTarget(Eigen::Vector2d(0.0, 0.0), m_planeSpeed);
+                agents.push_back(hp);
+            }
+
+            auto m = std::shared_ptr<MissileStation>(new MissileStation(2000, 4, 30000, m_missileSpeed));
+            m->setPosition(Eigen::Vector2d(-20000.0, 0.0), true);
+            agents.push_back(m);
+
+            auto n = std::shared_ptr<MissileStation>(new MissileStation(3000, 4, 30000, m_missileSpeed));
+            n->setPosition(Eigen::Vector2d(15000.0, 15000.0), true);
+            agents.push_back(n);
+
+            agents.push_back(Target::createTarget(102, Eigen::Vector2d(0.0, 0.0), 5000.0));
+            return agents;
+        }
+
+        double m_planeSpeed;
+        double m_missileSpeed;
+        size_t m_nPlanes;
+    };
+
+    class ReachEvaluation: public Evaluation
+    {
+    public:
+        void evaluate(std::shared_ptr<Simulation> sim, double /*timeStep*/) override
+        {
+            for(const auto& a: sim->getEnvironment()->getAgents())
+            {
+                if(a->type() == ETarget)
+                {
+                    for(const auto& d: std::static_pointer_cast<Target>(a)->getAgentsInSensorRange())
+                    {
+                        if(d.targetId >= 20000)
+                            m_reached.insert(d.targetId);
+                    }
+                }
+            }
+        }
+
+        bool isSimulationFinished(std::shared_ptr<Simulation> sim) override
+        {
+            for(const auto& a: sim->getEnvironment()->getAgents())
+            {
+                if(a->type() == EPlaneHostile && a->getEnabled() && m_reached.count(a->id()) == 0)
+                    return false;
+            }
+            return true;
+        }
+
+        std::set<unsigned int> m_reached;
+    };
+
+    class ReachBatchEvaluation: public BatchEvaluation
+    {
+    public:
+        ReachBatchEvaluation(size_t nRuns) : m_reached(nRuns) {}
+
+        void evaluate(const LockstepBatch& batch, size_t run, double /*timeStep*/) override
+        {
+            for(const auto& d: batch.agentsInSensorRange(batch.agentIndex(102), run))
+            {
+                if(d.targetId >= 20000)
+                    m_reached[run].insert(d.targetId);
+            }
+        }
+
+        bool isRunFinished(const LockstepBatch& batch, size_t run) override
+        {
+            for(size_t a = 0; a < batch.numberOfAgents(); a++)
+            {
+                if(batch.agentType(a) == EPlaneHostile && batch.enabled(a, run) && m_reached[run].count(batch.agentId(a)) == 0)
+                    return false;
+            }
+            return true;
+        }
+
+        Evaluation::ResultValues getResultValues(const LockstepBatch& batch, size_t run) override
+        {
+            return {{"hits", double(m_reached[run].size())}, {"sim_time", batch.runningTime(run)}};
+        }
+
+        std::vector<std::set<unsigned int>> m_reached;
+    };
+
+    std::shared_ptr<Simulation> createDefenceSimulation(unsigned int id, double planeSpeed, double missileSpeed)
+    {
+        auto s = Simulation::createSimulation(id);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new DefenceAgentFactory(planeSpeed, missileSpeed)));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEvaluation(std::shared_ptr<Evaluation>(new ReachEvaluation()));
+        s->setEnableLogMessages(false);
+        return s;
+    }
+}
+
+TEST(LockstepBatch, SameResultsAsSimulation)
+{
+    std::vector<std::pair<double, double>> speeds = {{250.0, 400.0}, {300.0, 600.0}, {400.0, 450.0},
+                                                     {200.0, 1200.0}, {500.0, 500.0}, {350.0, 800.0}};
+
+    auto batch = LockstepBatch::createLockstepBatch();
+    for(size_t r = 0; r < speeds.size(); r++)
+    {
+        ASSERT_TRUE(batch->addRun(createDefenceSimulation(r, speeds[r].first, speeds[r].second)));
+    }
+    ASSERT_EQ(batch->numberOfRuns(), speeds.size());
+    ASSERT_EQ(batch->numberOfAgents(), 12 + 2 * (1 + 1 + 4) + 1);
+
+    auto batchEval = std::shared_ptr<ReachBatchEvaluation>(new ReachBatchEvaluation(speeds.size()));
+    batch->setEvaluation(batchEval);
+    batch->runUntilFinished(1.0, 400.0);
+
+    std::set<size_t> hits;
+    for(size_t r = 0; r < speeds.size(); r++)
+    {
+        auto sim = createDefenceSimulation(r, speeds[r].first, speeds[r].second);
+        sim->initEnvironment();
+        sim->initAgents();
+        sim->runSimulationUntilFinished(1.0, 400.0);
+
+        // runs diverge, but each one like its simulation
+        auto eval = std::static_pointer_cast<ReachEvaluation>(sim->getEvaluation());
+        ASSERT_EQ(batchEval->m_reached[r], eval->m_reached);
+        ASSERT_DOUBLE_EQ(batch->runningTime(r), sim->getSimulationRunningTime());
+        hits.insert(eval->m_reached.size());
+
+        for(const auto& a: sim->getEnvironment()->getAgents())
+        {
+            size_t idx = batch->agentIndex(a->id());
+            ASSERT_NE(idx, LockstepBatch::NoAgent);
+            ASSERT_EQ(batch->enabled(idx, r), a->getEnabled());
+            ASSERT_NEAR((batch->position(idx, r) - a->getPosition()).norm(), 0.0, 1e-6);
+        }
+    }
+    ASSERT_GT(hits.size(), 1);
+}
+
+TEST(LockstepBatch, Run)
+{
+    auto batch = LockstepBatch::createLockstepBatch();
+    ASSERT_TRUE(batch->addRun(createDefenceSimulation(0, 300.0, 600.0)));
+    ASSERT_TRUE(batch->addRun(createDefenceSimulation(1, 400.0, 600.0)));
+    ASSERT_EQ(batch->simulationId(1), 1);
+
+    batch->run(0.5, 3.0);
+    ASSERT_DOUBLE_EQ(batch->runningTime(0), 3.0);
+    ASSERT_DOUBLE_EQ(batch->runningTime(1), 3.0);
+
+    size_t plane = batch->agentIndex(20000);
+    ASSERT_NEAR(batch->position(plane, 0).x(), 60000.0 - 3.0 * 300.0, 1e-6);
+    ASSERT_NEAR(batch->position(plane, 1).x(), 60000.0 - 3.0 * 400.0, 1e-6);
+    ASSERT_NEAR(batch->velocity(plane, 1).norm(), 400.0, 1e-6);
+
+    // runs are added before running only
+    ASSERT_FALSE(batch->addRun(createDefenceSimulation(2, 300.0, 600.0)));
+}
+
+TEST(LockstepBatch, RejectsOtherScenarios)
+{
+    auto batch = LockstepBatch::createLockstepBatch();
+    ASSERT_TRUE(batch->addRun(createDefenceSimulation(0, 300.0, 600.0)));
+
+    // different number of planes
+    auto other = Simulation::createSimulation(1);
+    other->setAgentFactory(std::shared_ptr<AgentFactory>(new DefenceAgentFactory(300.0, 600.0, 11)));
+    ASSERT_FALSE(batch->addRun(other));
+
+    // agent classes with own behaviour are not supported
+    class HumanFactory: public AgentFactory
+    {
+    public:
+        std::list<std::shared_ptr<Agent>> createAgents() override
+        {
+            return {std::shared_ptr<Agent>(new Human(1, 1.0, 1.0, 1.0, 0.5))};
+        }
+    };
+    auto humans = Simulation::createSimulation(2);
+    humans->setAgentFactory(std::shared_ptr<AgentFactory>(new HumanFactory()));
+    ASSERT_FALSE(LockstepBatch::createLockstepBatch()->addRun(humans));
+
+    ASSERT_EQ(batch->numberOfRuns(), 1);
+}
+
+TEST(LockstepBatch, Sweep)
+{
+    auto sweep = ParameterSweep::createParameterSweep();
+    sweep->addAxis("plane_speed", {200.0, 300.0, 450.0});
+    sweep->addAxis("missile_speed", {400.0, 700.0});
+    sweep->setStopWhenFinished(true);
+    sweep->setScenarioBuilder([](const ParameterPoint& point, unsigned int simId)
+    {
+        return createDefenceSimulation(simId, point["plane_speed"], point["missile_speed"]);
+    });
+
+    // the batch evaluation gives the results of ReachEvaluation
+    auto batched = sweep->runLockstep(2, 4, [](size_t nRuns)
+    {
+        return std::shared_ptr<BatchEvaluation>(new ReachBatchEvaluation(nRuns));
+    }, 1.0, 400.0);
+    ASSERT_EQ(batched.numberOfRows(), 6);
+    batched.sortByColumn("point");
+
+    for(size_t r = 0; r < 6; r++)
+    {
+        auto p = sweep->point(r);
+        auto sim = createDefenceSimulation(r, p["plane_speed"], p["missile_speed"]);
+        sim->initEnvironment();
+        sim->initAgents();
+        sim->runSimulationUntilFinished(1.0, 400.0);
+
+        auto eval = std::static_pointer_cast<ReachEvaluation>(sim->getEvaluation());
+        ASSERT_EQ(batched.value(r, "hits"), eval->m_reached.size());
+        ASSERT_DOUBLE_EQ(batched.value(r, "sim_time"), sim->getSimulationRunningTime());
+    }
+}
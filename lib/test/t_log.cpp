@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <functional>
+#include "environment.h"
+#include "tiled_environment.h"
+
+namespace
+{
+    std::string captureCout(const std::function<void()>& f)
+    {
+        std::ostringstream out;
+        auto old = std::cout.rdbuf(out.rdbuf());
+        f();
+        std::cout.rdbuf(old);
+        return out.str();
+    }
+}
+
+TEST(Log, FormatsOnlyWhenEnabled)
+{
+    auto e = Environment::createEnvironment(0);
+    int formatted = 0;
+    auto format = [&formatted](std::ostream& s)
+    {
+        formatted++;
+        s << "value " << 42;
+    };
+
+    std::string out = captureCout([&]()
+    {
+        MafLog::log<LogLevel::Info>(*e, format);
+        MafLog::log<LogLevel::Debug>(*e, format);
+
+        e->setLogLevel(LogLevel::Warning);
+        MafLog::log<LogLevel::Info>(*e, format);
+        MafLog::log<LogLevel::Error>(*e, format);
+
+        e->setEnableLogMessages(false);
+        MafLog::log<LogLevel::Error>(*e, format);
+    });
+
+    EXPECT_EQ(formatted, 2);
+    EXPECT_EQ(out, "value 42\nvalue 42\n");
+    EXPECT_FALSE(e->logEnabled(LogLevel::Error));
+    EXPECT_FALSE(e->logEnabled(LogLevel::Off));
+}
+
+TEST(Log, MessagesNotFormattedWhenDisabled)
+{
+    auto e = Environment::createEnvironment(0);
+    e->setEnableLogMessages(false);
+
+    std::string out = captureCout([&]()
+    {
+        e->sendMessage(Message::createMessage(1, 2, Message::Hit));
+        e->log("hidden");
+    });
+    EXPECT_TRUE(out.empty());
+
+    // messages are logged at info level
+    e->setEnableLogMessages(true);
+    e->setLogLevel(LogLevel::Warning);
+    out = captureCout([&]()
+    {
+        e->sendMessage(Message::createMessage(1, 2, Message::Hit));
+    });
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(Log, TiledEnvironmentLevels)
+{
+    auto e = TiledEnvironment::createTiledEnvironment(0, 10.0, 5.0, 2);
+    e->setLogLevel(LogLevel::Error);
+
+    std::string out = captureCout([&]()
+    {
+        e->log("info");
+        e->log(LogLevel::Error, "error");
+    });
+    EXPECT_EQ(out, "error\n");
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include "lookahead_environment.h"
+#include "human.h"
+#include "plane.h"
+#include "missile_station.h"
+#include "maintain_distance.h"
+#include "random_stream.h"
+
+std::vector<std::shared_ptr<Human>> addClusters(std::shared_ptr<Environment> e)
+{
+    // two crowds 100 m apart
+    RandomStream rnd(11, 0);
+    std::vector<std::shared_ptr<Human>> humans;
+    for(unsigned int k = 0; k < 60; k++)
+    {
+        auto h = Human::createHuman(k, 1.5, 2.5, 1.5, 0.0);
+        double offset = (k % 2 == 0) ? 0.0 : 100.0;
+        h->setPosition(Eigen::Vector2d(offset + rnd.uniform() * 5.0, rnd.uniform() * 5.0));
+        h->addObjective(std::shared_ptr<MaintainDistance>(new MaintainDistance(k, 1, h, 1.5)));
+        h->setEnvironment(e);
+        e->addAgent(h);
+        humans.push_back(h);
+    }
+    return humans;
+}
+
+TEST(LookaheadEnvironment, SpeedBound)
+{
+    auto a = Agent::createAgent(1);
+    a->setVelocity(Eigen::Vector2d(3.0, 4.0));
+    ASSERT_EQ(LookaheadEnvironment::speedBound(*a, 1.0), std::numeric_limits<double>::max());
+
+    a->setVelocityLimit(10.0);
+    ASSERT_DOUBLE_EQ(LookaheadEnvironment::speedBound(*a, 1.0), 10.0);
+
+    a->setAccelreationLimit(2.0);
+    ASSERT_DOUBLE_EQ(LookaheadEnvironment::speedBound(*a, 1.0), 7.0);
+}
+
+TEST(LookaheadEnvironment, LogicalProcesses)
+{
+    auto e = LookaheadEnvironment::createLookaheadEnvironment(1, 0.1, 1.5, 2);
+    addClusters(e);
+
+    e->buildLogicalProcesses(1.0);
+    ASSERT_EQ(e->numberOfLogicalProcesses(), 2);
+
+    // within a long window, the crowds could meet
+    e->buildLogicalProcesses(40.0);
+    ASSERT_EQ(e->numberOfLogicalProcesses(), 1);
+
+    // an agent without limits could reach anyone
+    auto unbounded = Agent::createAgent(1000);
+    unbounded->setPosition(Eigen::Vector2d(-1000.0, 0.0));
+    unbounded->setEnvironment(e);
+    e->addAgent(unbounded);
+    e->buildLogicalProcesses(1.0);
+    ASSERT_EQ(e->numberOfLogicalProcesses(), 1);
+}
+
+TEST(LookaheadEnvironment, SameAsTimeStepped)
+{
+    auto ref = Environment::createEnvironment(1);
+    auto refHumans = addClusters(ref);
+    for(int s = 0; s < 30; s++)
+        ref->update(0.1);
+
+    for(size_t nThreads: {1, 3})
+    {
+        auto e = LookaheadEnvironment::createLookaheadEnvironment(1, 0.1, 1.5, nThreads);
+        auto humans = addClusters(e);
+        for(int w = 0; w < 3; w++)
+            e->update(1.0);
+
+        ASSERT_EQ(e->numberOfLogicalProcesses(), 2);
+        for(size_t k = 0; k < humans.size(); k++)
+        {
+            ASSERT_NEAR((humans[k]->getPosition() - refHumans[k]->getPosition()).norm(), 0.0, 1e-9);
+        }
+    }
+}
+
+std::pair<std::shared_ptr<MissileStation>, std::shared_ptr<Agent>> addAirDefence(std::shared_ptr<Environment> e)
+{
+    e->setEnableLogMessages(false);
+
+    auto s = std::shared_ptr<MissileStation>(new MissileStation(2000, 1, 500.0, 50.0));
+    s->setPosition(Eigen::Vector2d(0.0, 0.0), true);
+
+    // the station and its sensor do not move
+    s->setVelocityLimit(0.0);
+    for(const auto& sa: s->getSubAgents())
+    {
+        if(sa->type() == AgentType::EProxSensor)
+        {
+            sa->setVelocityLimit(0.0);
+        }
+    }
+    s->setEnvironment(e);
+    e->addAgent(s);
+
+    auto p = std::shared_ptr<HostilePlane>(new HostilePlane(1));
+    p->setVelocityLimit(20.0);
+    p->setPosition(Eigen::Vector2d(1000.0, 0.0));
+    p->setMovingTowardsTarget(Eigen::Vector2d(0.0, 0.0), 20.0);
+    p->setEnvironment(e);
+    e->addAgent(p);
+
+    // far away plane, its own logical process
+    auto far = std::shared_ptr<HostilePlane>(new HostilePlane(2));
+    far->setVelocityLimit(20.0);
+    far->setPosition(Eigen::Vector2d(-10000.0, 0.0));
+    far->setEnvironment(e);
+    e->addAgent(far);
+
+    return {s, p};
+}
+
+TEST(LookaheadEnvironment, MissileInterception)
+{
+    auto ref = Environment::createEnvironment(1);
+    auto[refStation, refPlane] = addAirDefence(ref);
+    for(int s = 0; s < 60; s++)
+        ref->update(1.0);
+
+    auto e = LookaheadEnvironment::createLookaheadEnvironment(1, 1.0, 500.0, 2);
+    auto[station, plane] = addAirDefence(e);
+    e->update(10.0);
+
+    // plane and missiles could meet within the window, the far plane not
+    ASSERT_EQ(e->numberOfLogicalProcesses(), 2);
+
+    for(int w = 1; w < 6; w++)
+        e->update(10.0);
+
+    ASSERT_EQ(refStation->status(), MissileStation::Empty);
+    ASSERT_FALSE(refPlane->getEnabled());
+
+    ASSERT_EQ(station->status(), MissileStation::Empty);
+    ASSERT_FALSE(plane->getEnabled());
+    ASSERT_NEAR((plane->getPosition() - refPlane->getPosition()).norm(), 0.0, 1e-6);
+}
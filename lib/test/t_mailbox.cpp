@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "mailbox.h"
+
+TEST(Mailbox, FifoOrder)
+{
+    Mailbox box;
+    ASSERT_TRUE(box.empty());
+    ASSERT_EQ(box.size(), 0);
+
+    box.push(std::shared_ptr<Message>(new Message(0, 1, Message::Disable)));
+    box.push(std::shared_ptr<Message>(new Message(0, 1, Message::Enable)));
+    ASSERT_FALSE(box.empty());
+    ASSERT_EQ(box.size(), 2);
+
+    ASSERT_EQ(box.front()->subject(), Message::Disable);
+    box.pop();
+    ASSERT_EQ(box.front()->subject(), Message::Enable);
+    box.pop();
+    ASSERT_TRUE(box.empty());
+    ASSERT_EQ(box.size(), 0);
+
+    // pop on empty box does nothing
+    box.pop();
+    ASSERT_TRUE(box.empty());
+}
+
+TEST(Mailbox, ReleasesMessages)
+{
+    auto m = std::shared_ptr<Message>(new Message(0, 1, Message::Hit));
+    {
+        Mailbox box;
+        box.push(m);
+        box.push(m);
+        ASSERT_EQ(m.use_count(), 3);
+        box.pop();
+        ASSERT_EQ(m.use_count(), 2);
+    }
+    ASSERT_EQ(m.use_count(), 1);
+}
+
+TEST(Mailbox, ConcurrentSenders)
+{
+    Mailbox box;
+    const unsigned int nSenders = 4;
+    const unsigned int nMessages = 5000;
+
+    std::vector<std::thread> senders;
+    for(unsigned int s = 0; s < nSenders; s++)
+    {
+        senders.push_back(std::thread([&box, s, nMessages]
+        {
+            for(unsigned int k = 0; k < nMessages; k++)
+            {
+                box.push(std::shared_ptr<Message>(new Message(s, 99, Message::Information, "", {}, {int(k)})));
+            }
+        }));
+    }
+
+    // consume concurrently: messages of one sender arrive in order
+    std::vector<int> lastOfSender(nSenders, -1);
+    unsigned int received = 0;
+    while(received < nSenders * nMessages)
+    {
+        if(!box.empty())
+        {
+            auto m = box.front();
+            box.pop();
+            int k = m->intVecParam()[0];
+            ASSERT_EQ(k, lastOfSender[m->senderId()] + 1);
+            lastOfSender[m->senderId()] = k;
+            received++;
+        }
+    }
+
+    for(auto& t: senders)
+    {
+        t.join();
+    }
+
+    ASSERT_TRUE(box.empty());
+}
@@ -40,3 +40,64 @@ TEST(Message, ToString)
 
     delete m;
 }
+
+TEST(Message, InlinePayload)
+{
+    auto m = Message::createMessage(3, 4, Message::Hit, {1.5, -2.0, 7.25});
+    ASSERT_TRUE(m->hasInlinePayload());
+    ASSERT_EQ(m->subject(), Message::Hit);
+    ASSERT_EQ(m->numberOfDoubleParams(), 3);
+    ASSERT_EQ(m->doubleParam(0), 1.5);
+    ASSERT_EQ(m->doubleParam(2), 7.25);
+    ASSERT_EQ(m->numberOfIntParams(), 0);
+    ASSERT_TRUE(m->textView().empty());
+
+    // text, doubles and ints share the inline buffer
+    auto t = Message::createMessage(3, 4, Message::Information, std::string("FIRE"), std::vector<double>({2.0}), std::vector<int>({7, 8}));
+    ASSERT_TRUE(t->hasInlinePayload());
+    ASSERT_EQ(t->textView(), "FIRE");
+    ASSERT_EQ(t->textParam(), "FIRE");
+    ASSERT_EQ(t->doubleVecParam(), std::vector<double>({2.0}));
+    ASSERT_EQ(t->intParam(1), 8);
+    ASSERT_EQ(t->intVecParam(), std::vector<int>({7, 8}));
+}
+
+TEST(Message, ExtendedPayloadAndCopy)
+{
+    std::string text(Message::InlinePayloadSize + 1, 'x');
+    Message m(1, 2, Message::Information, text, {1.0, 2.0}, {3});
+    ASSERT_FALSE(m.hasInlinePayload());
+    ASSERT_EQ(m.textView(), text);
+    ASSERT_EQ(m.doubleParam(1), 2.0);
+    ASSERT_EQ(m.intParam(0), 3);
+
+    Message c(m);
+    ASSERT_EQ(c.textParam(), text);
+    ASSERT_EQ(c.doubleVecParam(), m.doubleVecParam());
+    ASSERT_EQ(c.intVecParam(), m.intVecParam());
+
+    Message a(5, 6, Message::Enable, {4.0});
+    a = m;
+    ASSERT_EQ(a.senderId(), 1);
+    ASSERT_EQ(a.textParam(), text);
+
+    a = Message(7, 8, Message::Disable, {9.0});
+    ASSERT_TRUE(a.hasInlinePayload());
+    ASSERT_EQ(a.doubleParam(0), 9.0);
+}
+
+TEST(Message, PooledAllocation)
+{
+    // a released message's block is reused by the next one
+    Message* first;
+    {
+        auto m = Message::createMessage(0, 1, Message::Disable);
+        first = m.get();
+    }
+    size_t cached = MessagePool::numberOfCachedBlocks();
+    ASSERT_GE(cached, 1);
+
+    auto m = Message::createMessage(0, 1, Message::Disable);
+    ASSERT_EQ(m.get(), first);
+    ASSERT_EQ(MessagePool::numberOfCachedBlocks(), cached - 1);
+}
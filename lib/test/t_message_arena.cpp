@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "message_arena.h"
+#include "environment.h"
+
+TEST(MessageArena, ResetReusesChunk)
+{
+    MessageArena arena;
+    ASSERT_EQ(arena.numberOfChunks(), 0);
+
+    Message* first;
+    {
+        auto m = arena.createMessage(1, 2, Message::Disable);
+        first = m.get();
+        ASSERT_EQ(arena.numberOfChunks(), 1);
+    }
+
+    // all released -> the next step starts at the beginning of the chunk
+    arena.reset();
+    auto m = arena.createMessage(3, 4, Message::Hit, {1.0, 2.0});
+    ASSERT_EQ(m.get(), first);
+    ASSERT_EQ(m->senderId(), 3);
+    ASSERT_EQ(m->doubleParam(1), 2.0);
+
+    // many steps of released messages fit into one chunk
+    m.reset();
+    for(int step = 0; step < 100; step++)
+    {
+        arena.reset();
+        for(int k = 0; k < 100; k++)
+        {
+            ASSERT_EQ(arena.createMessage(1, 2, Message::Enable)->subject(), Message::Enable);
+        }
+    }
+    ASSERT_EQ(arena.numberOfChunks(), 1);
+}
+
+TEST(MessageArena, KeptMessagesStayValid)
+{
+    std::shared_ptr<Message> kept;
+    std::shared_ptr<Message> copy;
+    {
+        MessageArena arena;
+        kept = arena.createMessage(5, 6, Message::Information, std::string("FIRE"));
+        copy = kept->clone();
+
+        // the kept message pins its chunk, new messages go elsewhere
+        arena.reset();
+        std::vector<std::shared_ptr<Message>> step;
+        for(int k = 0; k < 2000; k++)
+        {
+            step.push_back(arena.createMessage(7, 8, Message::Hit, {double(k)}));
+        }
+        ASSERT_GE(arena.numberOfChunks(), 2);
+        ASSERT_EQ(step[1999]->doubleParam(0), 1999.0);
+        ASSERT_EQ(kept->textView(), "FIRE");
+    }
+
+    // the arena is gone, the message lives on till released
+    ASSERT_EQ(kept->senderId(), 5);
+    ASSERT_EQ(kept->textParam(), "FIRE");
+    ASSERT_EQ(copy->textParam(), "FIRE");
+}
+
+TEST(MessageArena, ConcurrentCreation)
+{
+    MessageArena arena;
+    std::vector<std::thread> threads;
+    std::atomic_size_t nWrong(0);
+    for(unsigned int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&arena, &nWrong, t]()
+        {
+            std::vector<std::shared_ptr<Message>> kept;
+            for(unsigned int k = 0; k < 5000; k++)
+            {
+                kept.push_back(arena.createMessage(t, k, Message::Hit, {double(t), double(k)}));
+                if(kept.size() == 100)
+                {
+                    for(const auto& m: kept)
+                    {
+                        if(m->senderId() != t || m->doubleParam(0) != t || m->doubleParam(1) != m->receiverId())
+                        {
+                            nWrong++;
+                        }
+                    }
+                    kept.clear();
+                }
+            }
+        }));
+    }
+
+    for(auto& t: threads)
+    {
+        t.join();
+    }
+    ASSERT_EQ(nWrong, 0);
+}
+
+TEST(MessageArena, Environment)
+{
+    auto e = Environment::createEnvironment(1);
+    auto a1 = Agent::createAgent(10);
+    auto a2 = Agent::createAgent(20);
+    a1->setEnvironment(e);
+    a2->setEnvironment(e);
+    e->addAgent(a1);
+    e->addAgent(a2);
+
+    // messages of the agents are created in the environment's arena
+    ASSERT_NE(e->messageArena(), nullptr);
+    for(int step = 0; step < 50; step++)
+    {
+        a1->sendMessage(20, Message::Disable);
+        a2->sendMessage(10, Message::Enable, {1.0});
+        e->update(0.1);
+    }
+    ASSERT_EQ(e->messageArena()->numberOfChunks(), 1);
+    ASSERT_TRUE(a1->getEnabled());
+    ASSERT_FALSE(a2->getEnabled());
+
+    e->setUseMessageArena(false);
+    ASSERT_EQ(e->messageArena(), nullptr);
+    a1->sendMessage(20, Message::Enable);
+    e->update(0.1);
+    ASSERT_TRUE(a2->getEnabled());
+}
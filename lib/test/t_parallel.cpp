@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 #include <chrono>
+#include <set>
+#include <map>
+#include <algorithm>
 
 #include "parallel.h"
+#include "evaluation.h"
 
 TEST(Parallel, Run)
 {
@@ -33,3 +37,550 @@ TEST(Parallel, Run)
     ASSERT_EQ(d2, 4);
     ASSERT_EQ(q2, 0);
 }
+
+TEST(Parallel, WorkStealingChunks)
+{
+    for(size_t chunk: {1, 3, 8})
+    {
+        auto p = Parallel::createParallel(3);
+        p->setChunkSize(chunk);
+        ASSERT_EQ(p->chunkSize(), chunk);
+
+        std::vector<std::shared_ptr<Simulation>> sims;
+        for(unsigned int k = 0; k < 40; k++ )
+        {
+            auto s = Simulation::createSimulation(k);
+            s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+            s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+            s->setEnableLogMessages(false);
+
+            // every third simulation is long -> the first worker's queue is slow
+            double dur = (k % 3 == 0) ? 200.0 : 1.0;
+            p->addSimulation(s, 0.1, dur);
+            sims.push_back(s);
+        }
+
+        auto[d0, q0] = p->getProgress();
+        ASSERT_EQ(d0, 0);
+        ASSERT_EQ(q0, 40);
+
+        p->run();
+        p.reset(); // joins the workers
+
+        for(auto& s: sims)
+        {
+            ASSERT_GT(s->getSimulationRunningTime(), 0.0);
+        }
+    }
+}
+
+TEST(Parallel, FuturesAndCompletion)
+{
+    auto p = Parallel::createParallel(2);
+
+    std::atomic_size_t nCallbacks(0);
+    p->setCompletionCallback([&nCallbacks](std::shared_ptr<Simulation>)
+    {
+        nCallbacks++;
+    });
+
+    std::vector<Parallel::SimulationFuture> futures;
+    std::vector<std::shared_ptr<Simulation>> sims;
+    for(unsigned int k = 0; k < 6; k++ )
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        futures.push_back(p->addSimulation(s, 0.1, 1.0 + k));
+        sims.push_back(s);
+    }
+
+    p->run();
+
+    // every simulation is returned exactly once by waitAny
+    std::set<unsigned int> returned;
+    while(auto s = p->waitAny())
+    {
+        ASSERT_TRUE(returned.insert(s->id()).second);
+    }
+    ASSERT_EQ(returned.size(), 6);
+
+    p->wait();
+    ASSERT_EQ(nCallbacks, 6);
+
+    for(size_t k = 0; k < futures.size(); k++)
+    {
+        ASSERT_EQ(futures[k].get(), sims[k]);
+    }
+
+    auto[done, queued] = p->getProgress();
+    ASSERT_EQ(done, 6);
+    ASSERT_EQ(queued, 0);
+}
+
+namespace
+{
+    class TimeEvaluation: public Evaluation
+    {
+    public:
+        void evaluate(std::shared_ptr<Simulation> sim, double /*timeStep*/) override
+        {
+            m_time = sim->getSimulationRunningTime();
+        }
+
+        ResultValues getResultValues() override
+        {
+            return {{"time", m_time}};
+        }
+
+        double m_time = 0.0;
+    };
+}
+
+TEST(Parallel, StreamingResults)
+{
+    auto p = Parallel::createParallel(3);
+
+    std::map<unsigned int, double> results;
+    p->setResultSink(CallbackResultSink::createCallbackResultSink([&results](const SimulationResult& r)
+    {
+        ASSERT_EQ(r.values.size(), 1);
+        results[r.simulationId] = r.values[0].second;
+    }));
+
+    std::vector<std::shared_ptr<Simulation>> sims;
+    for(unsigned int k = 0; k < 10; k++ )
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEvaluation(std::shared_ptr<Evaluation>(new TimeEvaluation()));
+        s->setEnableLogMessages(false);
+        p->addSimulation(s, 0.5, 1.0 + k);
+        sims.push_back(s);
+    }
+
+    p->run();
+    p->wait();
+
+    // finished simulations are not kept in streaming mode
+    ASSERT_EQ(p->waitAny(), nullptr);
+
+    ASSERT_EQ(results.size(), 10);
+    for(unsigned int k = 0; k < 10; k++ )
+    {
+        ASSERT_DOUBLE_EQ(results[k], 1.0 + k);
+        ASSERT_EQ(sims[k]->getEnvironment(), nullptr);
+    }
+}
+
+TEST(Parallel, Generator)
+{
+    auto p = Parallel::createParallel(3);
+    p->setChunkSize(2);
+
+    std::atomic_size_t nGenerated(0);
+    std::vector<int> generatedIdx(25, 0);
+    p->addSimulationGenerator(25, [&nGenerated, &generatedIdx](size_t idx)
+    {
+        nGenerated++;
+        generatedIdx[idx]++;
+
+        auto s = Simulation::createSimulation(idx);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        return s;
+    }, 0.1, 1.0);
+
+    // nothing generated before the workers need it
+    ASSERT_EQ(nGenerated, 0);
+    auto[d0, q0] = p->getProgress();
+    ASSERT_EQ(d0, 0);
+    ASSERT_EQ(q0, 25);
+
+    p->run();
+
+    std::set<unsigned int> returned;
+    while(auto s = p->waitAny())
+    {
+        ASSERT_TRUE(returned.insert(s->id()).second);
+        ASSERT_GT(s->getSimulationRunningTime(), 0.0);
+    }
+
+    ASSERT_EQ(returned.size(), 25);
+    ASSERT_EQ(nGenerated, 25);
+    for(int n: generatedIdx)
+    {
+        ASSERT_EQ(n, 1);
+    }
+
+    auto[d1, q1] = p->getProgress();
+    ASSERT_EQ(d1, 25);
+    ASSERT_EQ(q1, 0);
+}
+
+TEST(Parallel, ThrowingGenerator)
+{
+    auto generator = [](size_t idx)
+    {
+        if(idx % 4 == 1)
+        {
+            throw std::runtime_error("invalid scenario");
+        }
+
+        auto s = Simulation::createSimulation(idx);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        return s;
+    };
+
+    // failed indices are finished without simulation
+    auto p = Parallel::createParallel(2);
+    p->addSimulationGenerator(8, generator, 0.5, 1.0);
+    p->run();
+    p->wait();
+
+    std::set<unsigned int> returned;
+    while(auto s = p->waitAny())
+    {
+        returned.insert(s->id());
+    }
+    ASSERT_EQ(returned, std::set<unsigned int>({0, 2, 3, 4, 6, 7}));
+    ASSERT_EQ(p->numberOfFailedSimulations(), 2);
+    ASSERT_EQ(p->getProgress().first, 8);
+
+    // streaming mode: no result is written for them
+    auto q = Parallel::createParallel(3);
+    std::vector<unsigned int> results;
+    q->setResultSink(CallbackResultSink::createCallbackResultSink([&results](const SimulationResult& r)
+    {
+        results.push_back(r.simulationId);
+    }));
+    q->addSimulationGenerator(8, generator, 0.5, 1.0);
+    q->run();
+    q->wait();
+
+    std::sort(results.begin(), results.end());
+    ASSERT_EQ(results, std::vector<unsigned int>({0, 2, 3, 4, 6, 7}));
+    ASSERT_EQ(q->numberOfFailedSimulations(), 2);
+}
+
+TEST(Parallel, ThrowingCompletionCallback)
+{
+    auto p = Parallel::createParallel(2);
+    std::atomic_int nbrOfCalls(0);
+    p->setCompletionCallback([&nbrOfCalls](std::shared_ptr<Simulation> sim)
+    {
+        nbrOfCalls++;
+        if(sim->id() % 2 == 0)
+        {
+            throw std::runtime_error("callback failed");
+        }
+    });
+    for(unsigned int k = 0; k < 6; k++)
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        p->addSimulation(s, 0.5, 1.0);
+    }
+    p->run();
+
+    // all simulations finish, the throwing callbacks count as failed
+    p->wait();
+    ASSERT_EQ(nbrOfCalls, 6);
+    ASSERT_EQ(p->numberOfFailedSimulations(), 3);
+    ASSERT_EQ(p->getProgress().first, 6);
+}
+
+namespace
+{
+    class FinishAfterEvaluation: public Evaluation
+    {
+    public:
+        FinishAfterEvaluation(double finishTime) : m_finishTime(finishTime) {}
+
+        bool isSimulationFinished(std::shared_ptr<Simulation> sim) override
+        {
+            return sim->getSimulationRunningTime() >= m_finishTime;
+        }
+
+        double m_finishTime;
+    };
+}
+
+TEST(Parallel, StopWhenFinished)
+{
+    for(bool stop: {false, true})
+    {
+        auto p = Parallel::createParallel(2);
+        ASSERT_FALSE(p->stopWhenFinished());
+        p->setStopWhenFinished(stop);
+
+        std::vector<std::shared_ptr<Simulation>> sims;
+        for(unsigned int k = 0; k < 4; k++ )
+        {
+            auto s = Simulation::createSimulation(k);
+            s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+            s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+            s->setEnableLogMessages(false);
+
+            // the last one would finish after the maximum duration
+            s->setEvaluation(std::shared_ptr<Evaluation>(new FinishAfterEvaluation(k < 3 ? 1.0 + k : 100.0)));
+            p->addSimulation(s, 0.5, 10.0);
+            sims.push_back(s);
+        }
+
+        p->run();
+        p->wait();
+
+        for(unsigned int k = 0; k < 4; k++ )
+        {
+            double expected = (stop && k < 3) ? 1.0 + k : 10.0;
+            ASSERT_DOUBLE_EQ(sims[k]->getSimulationRunningTime(), expected);
+        }
+    }
+}
+
+TEST(Parallel, PinnedWorkerStatistics)
+{
+    for(bool pin: {false, true})
+    {
+        auto p = Parallel::createParallel(2);
+        p->setPinThreads(pin);
+
+        for(unsigned int k = 0; k < 8; k++ )
+        {
+            auto s = Simulation::createSimulation(k);
+            s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+            s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+            s->setEnableLogMessages(false);
+            p->addSimulation(s, 0.1, 5.0);
+        }
+
+        p->run();
+        p->wait();
+
+        auto stats = p->getWorkerStatistics();
+        ASSERT_EQ(stats.size(), 2);
+
+        size_t nSims = 0;
+        for(const auto& w: stats)
+        {
+            nSims += w.simulations;
+            ASSERT_GE(w.busySeconds, 0.0);
+            ASSERT_GE(w.wallSeconds, 0.0);
+            if(!pin)
+            {
+                ASSERT_EQ(w.cpu, -1);
+                ASSERT_EQ(w.node, -1);
+            }
+        }
+        ASSERT_EQ(nSims, 8);
+
+        // one line per worker plus header and tail idle time
+        std::string report = p->workerReport();
+        ASSERT_EQ(std::count(report.begin(), report.end(), '\n'), 4);
+    }
+}
+
+namespace
+{
+    std::atomic_size_t nCreatedEnvironments(0);
+
+    class CountingEnvironmentFactory: public EnvironmentFactory
+    {
+    public:
+        std::shared_ptr<Environment> createEnvironment() override
+        {
+            nCreatedEnvironments++;
+            return EnvironmentFactory::createEnvironment();
+        }
+    };
+
+    class AgentCountEvaluation: public Evaluation
+    {
+    public:
+        void evaluate(std::shared_ptr<Simulation> sim, double timeStep) override
+        {
+            m_maxAgents = std::max(m_maxAgents, sim->getEnvironment()->getAgents().size());
+            m_time += timeStep;
+        }
+
+        size_t m_maxAgents = 0;
+        double m_time = 0.0;
+    };
+}
+
+TEST(Parallel, RecycleSimulations)
+{
+    auto p = Parallel::createParallel(2);
+    ASSERT_FALSE(p->recycleSimulations());
+    p->setRecycleSimulations(true);
+    ASSERT_TRUE(p->recycleSimulations());
+
+    nCreatedEnvironments = 0;
+    std::vector<std::shared_ptr<AgentCountEvaluation>> evals;
+    for(unsigned int k = 0; k < 12; k++ )
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new CountingEnvironmentFactory()));
+        s->setEnableLogMessages(false);
+
+        auto eval = std::shared_ptr<AgentCountEvaluation>(new AgentCountEvaluation());
+        s->setEvaluation(eval);
+        evals.push_back(eval);
+        p->addSimulation(s, 0.5, 1.0 + k);
+    }
+
+    p->run();
+
+    std::set<unsigned int> returned;
+    while(auto s = p->waitAny())
+    {
+        // the added simulation only carries the configuration
+        ASSERT_TRUE(returned.insert(s->id()).second);
+        ASSERT_EQ(s->getEnvironment(), nullptr);
+    }
+    ASSERT_EQ(returned.size(), 12);
+
+    // at most one environment per worker, agents of earlier runs are gone
+    ASSERT_LE(nCreatedEnvironments, 2);
+    for(unsigned int k = 0; k < 12; k++ )
+    {
+        ASSERT_EQ(evals[k]->m_maxAgents, 1);
+        ASSERT_DOUBLE_EQ(evals[k]->m_time, 1.0 + k);
+    }
+}
+
+TEST(Parallel, LongestFirst)
+{
+    std::vector<double> durations = {1.0, 5.0, 3.0, 8.0, 2.0, 4.0};
+
+    // one worker -> the simulations finish in order of decreasing cost
+    auto p = Parallel::createParallel(1);
+    p->setCostEstimator([&durations](const std::shared_ptr<Simulation>& sim) { return durations[sim->id()]; });
+    for(unsigned int k = 0; k < durations.size(); k++)
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        p->addSimulation(s, 0.5, durations[k]);
+    }
+    p->run();
+
+    std::vector<unsigned int> order;
+    while(auto s = p->waitAny())
+    {
+        order.push_back(s->id());
+    }
+    ASSERT_EQ(order, std::vector<unsigned int>({3, 1, 5, 2, 4, 0}));
+    ASSERT_DOUBLE_EQ(p->tailIdleSeconds(), 0.0);
+
+    // generated simulations are created in order of decreasing cost
+    auto g = Parallel::createParallel(1);
+    std::vector<size_t> generated;
+    g->addSimulationGenerator(durations.size(), [&generated](size_t idx)
+    {
+        generated.push_back(idx);
+        auto s = Simulation::createSimulation(idx);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        return s;
+    }, 0.5, 1.0, [&durations](size_t idx) { return durations[idx]; });
+    g->run();
+    g->wait();
+    ASSERT_EQ(generated, std::vector<size_t>({3, 1, 5, 2, 4, 0}));
+
+    // several workers: all simulations run once, the tail idle time is reported
+    auto m = Parallel::createParallel(3);
+    m->setCostEstimator([](const std::shared_ptr<Simulation>& sim) { return sim->id() % 4; });
+    for(unsigned int k = 0; k < 20; k++)
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        m->addSimulation(s, 0.5, 1.0 + k % 4);
+    }
+    m->run();
+
+    std::set<unsigned int> returned;
+    while(auto s = m->waitAny())
+    {
+        ASSERT_TRUE(returned.insert(s->id()).second);
+    }
+    ASSERT_EQ(returned.size(), 20);
+    ASSERT_GE(m->tailIdleSeconds(), 0.0);
+    ASSERT_NE(m->workerReport().find("tail idle s:"), std::string::npos);
+}
+
+TEST(Parallel, LiveStatistics)
+{
+    auto p = Parallel::createParallel(2);
+    for(unsigned int k = 0; k < 10; k++)
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        p->addSimulation(s, 0.5, 2.0 + k);
+    }
+
+    auto s0 = p->getLiveStatistics();
+    ASSERT_EQ(s0.finished, 0);
+    ASSERT_EQ(s0.queued, 10);
+    ASSERT_EQ(s0.elapsedSeconds, 0.0);
+
+    // another thread polls while the workers run
+    std::atomic_bool done(false);
+    bool consistent = true;
+    std::thread poller([&]()
+    {
+        while(!done)
+        {
+            auto s = p->getLiveStatistics();
+            consistent = consistent && s.finished + s.running + s.queued == 10 && s.workers.size() == 2;
+        }
+    });
+
+    p->run();
+    p->wait();
+    done = true;
+    poller.join();
+    ASSERT_TRUE(consistent);
+
+    auto s1 = p->getLiveStatistics();
+    ASSERT_EQ(s1.finished, 10);
+    ASSERT_EQ(s1.running, 0);
+    ASSERT_EQ(s1.queued, 0);
+    ASSERT_EQ(s1.etaSeconds, 0.0);
+    ASSERT_GT(s1.simulationsPerSecond, 0.0);
+    ASSERT_GT(s1.stepsPerSecond, 0.0);
+
+    // steps: (2 + k) / 0.5 per simulation
+    size_t steps = 0;
+    for(const auto& w: s1.workers)
+    {
+        steps += w.steps;
+        ASSERT_GE(w.idleSeconds, 0.0);
+    }
+    ASSERT_EQ(steps, 130);
+
+    ASSERT_GT(s1.minWallSeconds, 0.0);
+    ASSERT_LE(s1.minWallSeconds, s1.medianWallSeconds);
+    ASSERT_LE(s1.medianWallSeconds, s1.p90WallSeconds);
+    ASSERT_LE(s1.p90WallSeconds, s1.p99WallSeconds);
+    ASSERT_LE(s1.p99WallSeconds, s1.maxWallSeconds);
+    ASSERT_GE(s1.meanWallSeconds, s1.minWallSeconds);
+    ASSERT_LE(s1.meanWallSeconds, s1.maxWallSeconds);
+
+    ASSERT_NE(p->liveReport().find("10 / 10 finished"), std::string::npos);
+}
@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <cstdio>
+#include <fstream>
+
+#include "parameter_sweep.h"
+
+namespace
+{
+    // reports the running time and a value depending on the parameters
+    class SweepEvaluation: public Evaluation
+    {
+    public:
+        SweepEvaluation(double a, double b, double r) : m_a(a), m_b(b), m_r(r) {}
+
+        void evaluate(std::shared_ptr<Simulation> sim, double /*timeStep*/) override
+        {
+            m_time = sim->getSimulationRunningTime();
+        }
+
+        ResultValues getResultValues() override
+        {
+            return {{"a", m_a}, {"sum", m_a + m_b + m_r}, {"time", m_time}};
+        }
+
+        double m_a;
+        double m_b;
+        double m_r;
+        double m_time = 0.0;
+    };
+}
+
+TEST(ParameterSweep, Grid)
+{
+    auto sweep = ParameterSweep::createParameterSweep();
+    sweep->addAxis("a", {1.0, 2.0, 3.0});
+    sweep->addLinearAxis("b", 10.0, 5.0, 2);
+
+    ASSERT_EQ(sweep->numberOfPoints(), 6);
+    ASSERT_EQ(sweep->axisNames(), std::vector<std::string>({"a", "b"}));
+
+    // last axis changes fastest
+    auto p0 = sweep->point(0);
+    auto p1 = sweep->point(1);
+    auto p5 = sweep->point(5);
+    ASSERT_EQ(p0["a"], 1.0);
+    ASSERT_EQ(p0["b"], 10.0);
+    ASSERT_EQ(p1["a"], 1.0);
+    ASSERT_EQ(p1["b"], 15.0);
+    ASSERT_EQ(p5["a"], 3.0);
+    ASSERT_EQ(p5["b"], 15.0);
+    ASSERT_EQ(p5.index, 5);
+}
+
+TEST(ParameterSweep, RandomSampling)
+{
+    auto sweep = ParameterSweep::createParameterSweep();
+    sweep->addAxis("a", {-1.0, 1.0});
+    sweep->addAxis("b", {0.0, 10.0});
+    sweep->setSampling(ParameterSweep::Random, 50, 7);
+
+    ASSERT_EQ(sweep->numberOfPoints(), 50);
+    for(size_t k = 0; k < 50; k++)
+    {
+        auto p = sweep->point(k);
+        ASSERT_GE(p["a"], -1.0);
+        ASSERT_LT(p["a"], 1.0);
+        ASSERT_GE(p["b"], 0.0);
+        ASSERT_LT(p["b"], 10.0);
+
+        // reproducible
+        ASSERT_EQ(p.values, sweep->point(k).values);
+    }
+}
+
+TEST(ParameterSweep, LatinHypercube)
+{
+    auto sweep = ParameterSweep::createParameterSweep();
+    sweep->addAxis("a", {0.0, 1.0});
+    sweep->addAxis("b", {0.0, 20.0});
+    sweep->setSampling(ParameterSweep::LatinHypercube, 20, 3);
+
+    // each of the 20 strata of each axis holds exactly one sample
+    std::set<int> strataA, strataB;
+    for(size_t k = 0; k < 20; k++)
+    {
+        auto p = sweep->point(k);
+        strataA.insert(int(p["a"] * 20));
+        strataB.insert(int(p["b"]));
+    }
+
+    ASSERT_EQ(strataA.size(), 20);
+    ASSERT_EQ(strataB.size(), 20);
+}
+
+TEST(ParameterSweep, Run)
+{
+    auto sweep = ParameterSweep::createParameterSweep();
+    sweep->addAxis("a", {1.0, 2.0});
+    sweep->addAxis("b", {10.0, 20.0, 30.0});
+    sweep->setReplications(3);
+    sweep->setScenarioBuilder([&sweep](const ParameterPoint& point, unsigned int simId)
+    {
+        auto s = Simulation::createSimulation(simId);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+
+        double replication = simId % sweep->replications();
+        s->setEvaluation(std::shared_ptr<Evaluation>(new SweepEvaluation(point["a"], point["b"], replication)));
+        return s;
+    });
+
+    auto table = sweep->run(Parallel::createParallel(3), 0.5, 2.0);
+
+    // the result "a" is left out, it is already an axis
+    ASSERT_EQ(table.columnNames(), std::vector<std::string>({"point", "a", "b", "sum", "time"}));
+    ASSERT_EQ(table.numberOfRows(), 6);
+
+    table.sortByColumn("point");
+    for(size_t r = 0; r < 6; r++)
+    {
+        auto p = sweep->point(r);
+        ASSERT_EQ(table.value(r, "point"), r);
+        ASSERT_EQ(table.value(r, "a"), p["a"]);
+        ASSERT_EQ(table.value(r, "b"), p["b"]);
+
+        // mean over the replications 0, 1, 2
+        ASSERT_DOUBLE_EQ(table.value(r, "sum"), p["a"] + p["b"] + 1.0);
+        ASSERT_DOUBLE_EQ(table.value(r, "time"), 2.0);
+    }
+}
+
+TEST(ParameterSweep, JournalResume)
+{
+    std::string path = "t_parameter_sweep.journal";
+    std::remove(path.c_str());
+
+    std::atomic_size_t nBuilt(0);
+    auto makeSweep = [&nBuilt, &path]()
+    {
+        auto sweep = ParameterSweep::createParameterSweep();
+        sweep->addAxis("a", {1.0, 2.0, 3.0});
+        sweep->addAxis("b", {10.0, 20.0});
+        sweep->setReplications(2);
+        sweep->setJournal(path);
+        sweep->setScenarioBuilder([&nBuilt](const ParameterPoint& point, unsigned int simId)
+        {
+            nBuilt++;
+            auto s = Simulation::createSimulation(simId);
+            s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+            s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+            s->setEnableLogMessages(false);
+            s->setEvaluation(std::shared_ptr<Evaluation>(new SweepEvaluation(point["a"], point["b"], simId % 2)));
+            return s;
+        });
+        return sweep;
+    };
+
+    auto sweep = makeSweep();
+    auto full = sweep->run(Parallel::createParallel(2), 0.5, 1.0);
+    ASSERT_EQ(sweep->numberOfResumedPoints(), 0);
+    ASSERT_EQ(nBuilt, 12);
+    full.sortByColumn("point");
+
+    // keep header, columns and two points, plus a line cut off while writing
+    std::vector<std::string> lines;
+    {
+        std::ifstream f(path);
+        std::string line;
+        while(std::getline(f, line))
+            lines.push_back(line);
+    }
+    ASSERT_EQ(lines.size(), 8);
+    {
+        std::ofstream f(path);
+        for(size_t k = 0; k < 4; k++)
+            f << lines[k] << "\n";
+        f << lines[4].substr(0, 5);
+    }
+
+    nBuilt = 0;
+    sweep = makeSweep();
+    auto resumed = sweep->run(Parallel::createParallel(2), 0.5, 1.0);
+    ASSERT_EQ(sweep->numberOfResumedPoints(), 2);
+    ASSERT_EQ(nBuilt, 8);
+    resumed.sortByColumn("point");
+
+    ASSERT_EQ(resumed.columnNames(), full.columnNames());
+    for(const auto& name: full.columnNames())
+    {
+        ASSERT_EQ(resumed.column(name), full.column(name));
+    }
+
+    // everything finished -> nothing to simulate
+    nBuilt = 0;
+    sweep = makeSweep();
+    resumed = sweep->run(Parallel::createParallel(2), 0.5, 1.0);
+    ASSERT_EQ(sweep->numberOfResumedPoints(), 6);
+    ASSERT_EQ(nBuilt, 0);
+    ASSERT_EQ(resumed.numberOfRows(), 6);
+
+    // another sweep does not resume from the journal
+    nBuilt = 0;
+    sweep = makeSweep();
+    sweep->setReplications(1);
+    sweep->run(Parallel::createParallel(2), 0.5, 1.0);
+    ASSERT_EQ(sweep->numberOfResumedPoints(), 0);
+    ASSERT_EQ(nBuilt, 6);
+
+    std::remove(path.c_str());
+}
+
+TEST(ParameterSweep, RunProcesses)
+{
+    auto makeSweep = []()
+    {
+        auto sweep = ParameterSweep::createParameterSweep();
+        sweep->addAxis("a", {1.0, 2.0, 3.0});
+        sweep->addAxis("b", {10.0, 20.0});
+        sweep->setReplications(2);
+        sweep->setScenarioBuilder([](const ParameterPoint& point, unsigned int simId)
+        {
+            auto s = Simulation::createSimulation(simId);
+            s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+            s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+            s->setEnableLogMessages(false);
+            s->setEvaluation(std::shared_ptr<Evaluation>(new SweepEvaluation(point["a"], point["b"], simId % 2)));
+            return s;
+        });
+        return sweep;
+    };
+
+    auto threads = makeSweep()->run(Parallel::createParallel(2), 0.5, 1.5);
+    auto sweep = makeSweep();
+    auto processes = sweep->runProcesses(3, 0.5, 1.5);
+
+    ASSERT_TRUE(sweep->failedPoints().empty());
+    threads.sortByColumn("point");
+    processes.sortByColumn("point");
+    ASSERT_EQ(processes.columnNames(), threads.columnNames());
+    for(const auto& name: threads.columnNames())
+    {
+        ASSERT_EQ(processes.column(name), threads.column(name));
+    }
+}
+
+TEST(ParameterSweep, CostOrder)
+{
+    std::vector<unsigned int> built;
+    auto sweep = ParameterSweep::createParameterSweep();
+    sweep->addAxis("a", {1.0, 2.0, 3.0});
+    sweep->addAxis("b", {10.0, 20.0});
+    sweep->setReplications(2);
+    sweep->setScenarioBuilder([&built](const ParameterPoint& point, unsigned int simId)
+    {
+        built.push_back(simId);
+        auto s = Simulation::createSimulation(simId);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEnableLogMessages(false);
+        s->setEvaluation(std::shared_ptr<Evaluation>(new SweepEvaluation(point["a"], point["b"], simId % 2)));
+        return s;
+    });
+
+    // larger a is more expensive -> built first
+    sweep->setCostEstimator([](const ParameterPoint& point) { return point["a"]; });
+    auto model = CostModel::createCostModel();
+    sweep->setCostModel(model);
+
+    auto table = sweep->run(Parallel::createParallel(1), 0.5, 1.5);
+    ASSERT_EQ(table.numberOfRows(), 6);
+    ASSERT_EQ(built, std::vector<unsigned int>({8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3}));
+
+    // the model learned the wall time of every simulation
+    ASSERT_EQ(model->numberOfObservations(), 12);
+    ASSERT_GT(model->estimate({2.0, 15.0}), 0.0);
+}
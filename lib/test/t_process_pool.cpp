@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "process_pool.h"
+
+TEST(ProcessPool, Run)
+{
+    ProcessPool pool(3);
+
+    std::map<size_t, Evaluation::ResultValues> results;
+    size_t nSucceeded = pool.run(20, [](size_t idx)
+    {
+        return Evaluation::ResultValues({{"idx", double(idx)}, {"pid", double(getpid())}});
+    },
+    [&results](size_t idx, const Evaluation::ResultValues& values)
+    {
+        results[idx] = values;
+    });
+
+    ASSERT_EQ(nSucceeded, 20);
+    ASSERT_TRUE(pool.failedTasks().empty());
+    ASSERT_EQ(pool.numberOfLostWorkers(), 0);
+    ASSERT_EQ(results.size(), 20);
+    for(const auto& [idx, values]: results)
+    {
+        ASSERT_EQ(values[0].first, "idx");
+        ASSERT_EQ(values[0].second, idx);
+
+        // computed in a worker process
+        ASSERT_NE(values[1].second, double(getpid()));
+    }
+}
+
+TEST(ProcessPool, RetryAndFail)
+{
+    std::string marker = "t_process_pool.marker";
+    std::remove(marker.c_str());
+
+    ProcessPool pool(2);
+    pool.setMaxRetries(2);
+
+    std::map<size_t, double> results;
+    size_t nSucceeded = pool.run(10, [&marker](size_t idx)
+    {
+        // task 2 crashes its worker once, task 5 always, task 7 always throws
+        if(idx == 2 && !std::ifstream(marker).good())
+        {
+            std::ofstream(marker) << "crashed";
+            _exit(1);
+        }
+        if(idx == 5)
+        {
+            _exit(1);
+        }
+        if(idx == 7)
+        {
+            throw std::runtime_error("failed");
+        }
+        return Evaluation::ResultValues({{"v", idx * 2.0}});
+    },
+    [&results](size_t idx, const Evaluation::ResultValues& values)
+    {
+        results[idx] = values[0].second;
+    });
+
+    ASSERT_EQ(nSucceeded, 8);
+    ASSERT_EQ(pool.failedTasks(), std::vector<size_t>({5, 7}));
+
+    // task 2 once and task 5 three times
+    ASSERT_EQ(pool.numberOfLostWorkers(), 4);
+
+    ASSERT_EQ(results.size(), 8);
+    ASSERT_EQ(results[2], 4.0);
+    ASSERT_EQ(results.count(5), 0);
+
+    std::remove(marker.c_str());
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+
+#include "random_stream.h"
+#include "simulation.h"
+
+TEST(RandomStream, PhiloxKnownAnswer)
+{
+    // Random123 known answer vectors for philox4x32-10
+    auto r0 = RandomStream::philox({0, 0, 0, 0}, {0, 0});
+    ASSERT_EQ(r0[0], 0x6627e8d5);
+    ASSERT_EQ(r0[1], 0xe169c58d);
+    ASSERT_EQ(r0[2], 0xbc57ac4c);
+    ASSERT_EQ(r0[3], 0x9b00dbd8);
+
+    auto r1 = RandomStream::philox({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff});
+    ASSERT_EQ(r1[0], 0x408f276d);
+    ASSERT_EQ(r1[1], 0x41c83b0e);
+    ASSERT_EQ(r1[2], 0xa20bc7c6);
+    ASSERT_EQ(r1[3], 0x6d5451fd);
+}
+
+TEST(RandomStream, Reproducible)
+{
+    RandomStream a(77, 3);
+    RandomStream b(77, 3);
+    RandomStream c(77, 4);
+
+    bool allSame = true;
+    for(int k = 0; k < 100; k++)
+    {
+        auto va = a();
+        ASSERT_EQ(va, b());
+        allSame = allSame && (va == c());
+    }
+    ASSERT_FALSE(allSame);
+}
+
+TEST(RandomStream, Discard)
+{
+    RandomStream a(5, 1);
+    RandomStream b(5, 1);
+
+    a();
+    for(int k = 0; k < 10; k++)
+        b();
+    a.discard(9);
+
+    for(int k = 0; k < 20; k++)
+        ASSERT_EQ(a(), b());
+}
+
+TEST(RandomStream, Uniform)
+{
+    RandomStream a(5, 1);
+    double sum = 0.0;
+    for(int k = 0; k < 10000; k++)
+    {
+        double u = a.uniform();
+        ASSERT_GE(u, 0.0);
+        ASSERT_LT(u, 1.0);
+        sum += u;
+    }
+    ASSERT_NEAR(sum / 10000, 0.5, 0.02);
+
+    // usable with std distributions
+    std::normal_distribution<> d{10.0, 1.0};
+    double v = d(a);
+    ASSERT_GT(v, 0.0);
+}
+
+TEST(RandomStream, ServiceStreams)
+{
+    auto s1 = RandomService::createRandomService(1, 10);
+    auto s2 = RandomService::createRandomService(1, 10);
+    auto s3 = RandomService::createRandomService(1, 11);
+    auto s4 = RandomService::createRandomService(2, 10);
+
+    ASSERT_EQ(s1->getAgentStream(4)(), s2->getAgentStream(4)());
+    ASSERT_NE(s1->getAgentStream(4)(), s1->getAgentStream(5)());
+    ASSERT_NE(s1->getAgentStream(4)(), s3->getAgentStream(4)());
+    ASSERT_NE(s1->getAgentStream(4)(), s4->getAgentStream(4)());
+    ASSERT_NE(s1->getAgentStream(4)(), s1->getStream(RandomService::FactoryDomain, 4)());
+}
+
+TEST(RandomStream, AgentStreamIndependentOfOrder)
+{
+    auto runSim = [](bool reverse) {
+        auto sim = Simulation::createSimulation(3);
+        sim->setMasterSeed(42);
+        sim->setAgentFactory(std::shared_ptr<AgentFactory>(new AgentFactory()));
+        sim->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        sim->initEnvironment();
+
+        auto a = Agent::createAgent(1);
+        auto b = Agent::createAgent(2);
+        a->setEnvironment(sim->getEnvironment());
+        b->setEnvironment(sim->getEnvironment());
+
+        if(reverse)
+        {
+            b->randomStream()();
+            return std::make_pair(a->randomStream()(), b->randomStream()());
+        }
+        else
+        {
+            auto ra = a->randomStream()();
+            b->randomStream()();
+            return std::make_pair(ra, b->randomStream()());
+        }
+    };
+
+    ASSERT_EQ(runSim(false), runSim(true));
+
+    // Same on another thread
+    std::pair<uint32_t, uint32_t> threadRes;
+    std::thread t([&]{ threadRes = runSim(true); });
+    t.join();
+    ASSERT_EQ(runSim(false), threadRes);
+}
+
+class RandomAgentFactory: public AgentFactory
+{
+public:
+    std::list<std::shared_ptr<Agent>> createAgents() override
+    {
+        std::list<std::shared_ptr<Agent>> agents;
+        auto a = Agent::createAgent(1);
+        a->setPosition(Eigen::Vector2d(randomStream().uniform(), randomStream().uniform()));
+        agents.push_back(a);
+        return agents;
+    }
+};
+
+TEST(RandomStream, FactoryStream)
+{
+    auto createPos = [](unsigned int simId, uint64_t seed) {
+        auto sim = Simulation::createSimulation(simId);
+        sim->setMasterSeed(seed);
+        sim->setAgentFactory(std::shared_ptr<AgentFactory>(new RandomAgentFactory()));
+        sim->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        sim->initEnvironment();
+        sim->initAgents();
+        return sim->getEnvironment()->getAgents().front()->getPosition();
+    };
+
+    ASSERT_EQ(createPos(1, 5), createPos(1, 5));
+    ASSERT_NE(createPos(1, 5), createPos(2, 5));
+    ASSERT_NE(createPos(1, 5), createPos(1, 6));
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+#include "result_cache.h"
+#include "parameter_sweep.h"
+
+namespace
+{
+    class SpeedAgentFactory: public AgentFactory
+    {
+    public:
+        SpeedAgentFactory(double speed) : m_speed(speed) {}
+
+        std::string configuration() const override
+        {
+            return "speed=" + std::to_string(m_speed);
+        }
+
+        double m_speed;
+    };
+
+    // simulated runs are appended to a file -> counted across worker processes
+    const std::string RunLogPath = "t_result_cache_runs.log";
+
+    size_t numberOfSimulatedRuns()
+    {
+        std::ifstream f(RunLogPath);
+        size_t n = 0;
+        std::string line;
+        while(std::getline(f, line))
+        {
+            n++;
+        }
+        return n;
+    }
+
+    class SpeedEvaluation: public Evaluation
+    {
+    public:
+        SpeedEvaluation(double speed) : m_speed(speed) {}
+
+        void evaluate(std::shared_ptr<Simulation> sim, double /*timeStep*/) override
+        {
+            m_time = sim->getSimulationRunningTime();
+        }
+
+        ResultValues getResultValues() override
+        {
+            std::ofstream(RunLogPath, std::ios::app) << m_speed << std::endl;
+            return {{"distance", m_speed * m_time}, {"time", m_time}};
+        }
+
+        double m_speed;
+        double m_time = 0.0;
+    };
+
+    std::shared_ptr<Simulation> createSpeedSimulation(unsigned int id, double speed)
+    {
+        auto s = Simulation::createSimulation(id);
+        s->setAgentFactory(std::shared_ptr<AgentFactory>(new SpeedAgentFactory(speed)));
+        s->setEnvironmentFactory(std::shared_ptr<EnvironmentFactory>(new EnvironmentFactory()));
+        s->setEvaluation(std::shared_ptr<Evaluation>(new SpeedEvaluation(speed)));
+        s->setEnableLogMessages(false);
+        return s;
+    }
+}
+
+TEST(ResultCache, StoreLookup)
+{
+    std::string dir = "t_result_cache_store";
+    std::filesystem::remove_all(dir);
+
+    auto cache = ResultCache::createResultCache(dir);
+    ASSERT_TRUE(cache->isOpen());
+
+    std::string key = ResultCache::key(createSpeedSimulation(3, 2.0), 0.5, 10.0, false);
+    Evaluation::ResultValues values;
+    ASSERT_FALSE(cache->lookup(key, values));
+    ASSERT_EQ(cache->misses(), 1);
+
+    Evaluation::ResultValues stored = {{"with space", 1.0 / 3.0}, {"second", -1e300}};
+    ASSERT_TRUE(cache->store(key, stored));
+
+    // a second cache instance on the same directory finds it as well
+    auto other = ResultCache::createResultCache(dir);
+    ASSERT_TRUE(other->lookup(key, values));
+    ASSERT_EQ(values, stored);
+    ASSERT_EQ(other->hits(), 1);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ResultCache, Key)
+{
+    std::string key = ResultCache::key(createSpeedSimulation(3, 2.0), 0.5, 10.0, false);
+    ASSERT_NE(key.find(ResultCache::libraryVersion()), std::string::npos);
+    ASSERT_EQ(key, ResultCache::key(createSpeedSimulation(3, 2.0), 0.5, 10.0, false));
+
+    // each part of the configuration matters
+    ASSERT_NE(key, ResultCache::key(createSpeedSimulation(4, 2.0), 0.5, 10.0, false));
+    ASSERT_NE(key, ResultCache::key(createSpeedSimulation(3, 2.5), 0.5, 10.0, false));
+    ASSERT_NE(key, ResultCache::key(createSpeedSimulation(3, 2.0), 0.25, 10.0, false));
+    ASSERT_NE(key, ResultCache::key(createSpeedSimulation(3, 2.0), 0.5, 11.0, false));
+    ASSERT_NE(key, ResultCache::key(createSpeedSimulation(3, 2.0), 0.5, 10.0, true));
+
+    auto seeded = createSpeedSimulation(3, 2.0);
+    seeded->setMasterSeed(5);
+    ASSERT_NE(key, ResultCache::key(seeded, 0.5, 10.0, false));
+
+    // with a scenario key, the simulation id does not matter, the streams do
+    auto a = createSpeedSimulation(3, 2.0);
+    auto b = createSpeedSimulation(9, 2.0);
+    for(auto& s: {a, b})
+    {
+        s->setScenarioKey("speed=2 replication=0");
+        s->setStreamId(RandomService::streamIdOf(s->scenarioKey()));
+    }
+    ASSERT_EQ(ResultCache::key(a, 0.5, 10.0, false), ResultCache::key(b, 0.5, 10.0, false));
+    b->setStreamId(4);
+    ASSERT_NE(ResultCache::key(a, 0.5, 10.0, false), ResultCache::key(b, 0.5, 10.0, false));
+}
+
+TEST(ResultCache, SweepReusesResults)
+{
+    std::string dir = "t_result_cache_sweep";
+    std::filesystem::remove_all(dir);
+    auto cache = ResultCache::createResultCache(dir);
+
+    std::filesystem::remove(RunLogPath);
+
+    auto runSweep = [&cache](bool processes)
+    {
+        auto sweep = ParameterSweep::createParameterSweep();
+        sweep->addAxis("speed", {1.0, 2.0, 3.0, 4.0});
+        sweep->setResultCache(cache);
+        sweep->setScenarioBuilder([](const ParameterPoint& point, unsigned int simId)
+        {
+            return createSpeedSimulation(simId, point["speed"]);
+        });
+
+        auto table = processes ? sweep->runProcesses(2, 0.5, 2.0) : sweep->run(Parallel::createParallel(2), 0.5, 2.0);
+        table.sortByColumn("point");
+        return table;
+    };
+
+    auto first = runSweep(false);
+    ASSERT_EQ(numberOfSimulatedRuns(), 4);
+    ASSERT_EQ(cache->misses(), 4);
+
+    // all results come from the cache, with threads or processes
+    for(bool processes: {false, true})
+    {
+        auto second = runSweep(processes);
+        ASSERT_EQ(numberOfSimulatedRuns(), 4);
+        ASSERT_EQ(second.numberOfRows(), 4);
+        for(size_t r = 0; r < 4; r++)
+        {
+            ASSERT_DOUBLE_EQ(second.value(r, "distance"), first.value(r, "distance"));
+            ASSERT_DOUBLE_EQ(second.value(r, "distance"), (r + 1.0) * 2.0);
+        }
+    }
+    ASSERT_EQ(cache->hits(), 4);
+
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove(RunLogPath);
+}
+
+TEST(ResultCache, OverlappingSweeps)
+{
+    std::string dir = "t_result_cache_overlap";
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove(RunLogPath);
+    auto cache = ResultCache::createResultCache(dir);
+
+    auto runSweep = [&cache](const std::vector<double>& speeds, bool processes)
+    {
+        auto sweep = ParameterSweep::createParameterSweep();
+        sweep->addAxis("speed", speeds);
+        sweep->setReplications(2);
+        sweep->setResultCache(cache);
+        sweep->setScenarioBuilder([](const ParameterPoint& point, unsigned int simId)
+        {
+            auto s = createSpeedSimulation(simId, point["speed"]);
+            s->setMasterSeed(7);
+            return s;
+        });
+
+        auto table = processes ? sweep->runProcesses(2, 0.5, 2.0) : sweep->run(Parallel::createParallel(2), 0.5, 2.0);
+        table.sortByColumn("speed");
+        return table;
+    };
+
+    runSweep({1.0, 2.0, 3.0, 4.0}, false);
+    ASSERT_EQ(numberOfSimulatedRuns(), 8);
+    ASSERT_EQ(cache->misses(), 8);
+
+    // speeds 3 and 4 are other points of the shifted sweep, but hit the cache
+    auto shifted = runSweep({3.0, 4.0, 5.0, 6.0}, false);
+    ASSERT_EQ(cache->hits(), 4);
+    ASSERT_EQ(cache->misses(), 12);
+    ASSERT_EQ(numberOfSimulatedRuns(), 12);
+    ASSERT_EQ(shifted.numberOfRows(), 4);
+    for(size_t r = 0; r < 4; r++)
+    {
+        ASSERT_DOUBLE_EQ(shifted.value(r, "distance"), (r + 3.0) * 2.0);
+    }
+
+    // worker processes only simulate the new points 7 and 8
+    auto processed = runSweep({5.0, 6.0, 7.0, 8.0}, true);
+    ASSERT_EQ(numberOfSimulatedRuns(), 16);
+    ASSERT_EQ(processed.numberOfRows(), 4);
+
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove(RunLogPath);
+}
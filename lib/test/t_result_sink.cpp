@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+
+#include "result_sink.h"
+
+TEST(ResultSink, Callback)
+{
+    std::vector<SimulationResult> collected;
+    auto sink = CallbackResultSink::createCallbackResultSink([&collected](const SimulationResult& r)
+    {
+        collected.push_back(r);
+    });
+
+    sink->write({3, "three", {{"a", 1.0}}});
+    ASSERT_EQ(collected.size(), 1);
+    ASSERT_EQ(collected[0].simulationId, 3);
+    ASSERT_EQ(collected[0].description, "three");
+    ASSERT_EQ(collected[0].values[0].second, 1.0);
+}
+
+TEST(ResultSink, Csv)
+{
+    std::string path = "t_result_sink.csv";
+    {
+        auto sink = CsvResultSink::createCsvResultSink(path);
+        ASSERT_TRUE(sink->isOpen());
+        sink->write({0, "first", {{"a", 1.5}, {"b", -2.0}}});
+        sink->write({1, "with \"quote\"", {{"a", 0.25}, {"b", 3.0}}});
+    }
+
+    std::ifstream f(path);
+    std::stringstream content;
+    content << f.rdbuf();
+    ASSERT_EQ(content.str(), "simulation_id,description,\"a\",\"b\"\n"
+                             "0,\"first\",1.5,-2\n"
+                             "1,\"with \"\"quote\"\"\",0.25,3\n");
+    std::remove(path.c_str());
+}
+
+TEST(ResultSink, BinaryRoundTrip)
+{
+    std::string path = "t_result_sink.bin";
+    {
+        auto sink = BinaryResultSink::createBinaryResultSink(path);
+        ASSERT_TRUE(sink->isOpen());
+        for(unsigned int k = 0; k < 5; k++)
+        {
+            sink->write({k, "sim " + std::to_string(k), {{"x", k * 0.1}, {"y", k * 1e300}}});
+        }
+    }
+
+    std::vector<SimulationResult> collected;
+    ASSERT_TRUE(BinaryResultSink::read(path, [&collected](const SimulationResult& r)
+    {
+        collected.push_back(r);
+    }));
+
+    ASSERT_EQ(collected.size(), 5);
+    for(unsigned int k = 0; k < 5; k++)
+    {
+        ASSERT_EQ(collected[k].simulationId, k);
+        ASSERT_EQ(collected[k].description, "sim " + std::to_string(k));
+        ASSERT_EQ(collected[k].values.size(), 2);
+        ASSERT_EQ(collected[k].values[0].first, "x");
+        ASSERT_EQ(collected[k].values[0].second, k * 0.1);
+        ASSERT_EQ(collected[k].values[1].second, k * 1e300);
+    }
+
+    std::remove(path.c_str());
+    ASSERT_FALSE(BinaryResultSink::read(path, [](const SimulationResult&) {}));
+}
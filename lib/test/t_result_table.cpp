@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "result_table.h"
+
+TEST(ResultTable, Columns)
+{
+    ResultTable t({"a", "b"});
+    ASSERT_EQ(t.numberOfColumns(), 2);
+    ASSERT_EQ(t.numberOfRows(), 0);
+    ASSERT_EQ(t.columnIndex("b"), 1);
+    ASSERT_EQ(t.columnIndex("c"), ResultTable::NoColumn);
+
+    t.addRow({1.0, 10.0});
+    t.addRow({2.0, 20.0});
+    ASSERT_EQ(t.numberOfRows(), 2);
+    ASSERT_EQ(t.column("a"), std::vector<double>({1.0, 2.0}));
+    ASSERT_EQ(t.value(1, "b"), 20.0);
+}
+
+TEST(ResultTable, Sort)
+{
+    ResultTable t({"id", "v"});
+    t.addRow({0, 3.0});
+    t.addRow({1, 1.0});
+    t.addRow({2, 2.0});
+    t.addRow({3, 1.0});
+
+    t.sortByColumn("v");
+    ASSERT_EQ(t.column("id"), std::vector<double>({1, 3, 2, 0}));
+    ASSERT_EQ(t.column("v"), std::vector<double>({1.0, 1.0, 2.0, 3.0}));
+
+    t.sortByColumn("id", false);
+    ASSERT_EQ(t.column("id"), std::vector<double>({3, 2, 1, 0}));
+}
+
+TEST(ResultTable, Csv)
+{
+    ResultTable t({"x", "y"});
+    t.addRow({0.5, 1.0});
+
+    std::string path = "t_result_table.csv";
+    ASSERT_TRUE(t.writeCsv(path));
+
+    std::ifstream f(path);
+    std::stringstream content;
+    content << f.rdbuf();
+    ASSERT_EQ(content.str(), "x,y\n0.5,1\n");
+    std::remove(path.c_str());
+}
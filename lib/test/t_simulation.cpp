@@ -1,8 +1,14 @@
 
 #include <gtest/gtest.h>
 
+#include <random>
+#include <atomic>
+
 #include "simulation.h"
 #include "evaluation.h"
+#include "parallel.h"
+#include "human.h"
+#include "maintain_distance.h"
 
 TEST(Simulation, Id)
 {
@@ -243,3 +249,196 @@ TEST(Simulation, RunTillFinished)
 
     ASSERT_NEAR(s->getSimulationRunningTime(), 5.1, 0.00001);
 }
+
+TEST(Simulation, RunUntilFinishedCapped)
+{
+    for(double maxDuration: {2.0, 20.0})
+    {
+        auto s = Simulation::createSimulation(4);
+        s->setAgentFactory(std::shared_ptr<MyBoringAgentFactory>(new MyBoringAgentFactory()));
+        s->setEnvironmentFactory(std::shared_ptr<CircEnvFactory>(new CircEnvFactory()));
+        s->setEvaluation(std::shared_ptr<MySumAgentEvaluation>(new MySumAgentEvaluation()));
+
+        s->initEnvironment();
+        s->initAgents();
+
+        // finished after 5 seconds, unless the cap is reached before
+        s->runSimulationUntilFinished(0.1, maxDuration);
+        ASSERT_NEAR(s->getSimulationRunningTime(), std::min(maxDuration, 5.1), 0.00001);
+    }
+}
+
+TEST(Simulation, ResetInPlace)
+{
+    auto s = Simulation::createSimulation(4);
+    s->setAgentFactory(std::shared_ptr<MyBoringAgentFactory>(new MyBoringAgentFactory()));
+    s->setEnvironmentFactory(std::shared_ptr<CircEnvFactory>(new CircEnvFactory()));
+    s->setMasterSeed(11);
+
+    s->initEnvironment();
+    s->initAgents();
+    s->runSimulation(0.1, 2.0);
+
+    auto env = s->getEnvironment();
+    auto firstAgents = env->getAgents();
+    env->getMessages(0).push(std::shared_ptr<Message>(new Message(1, 0, Message::Disable)));
+
+    s->reset(7, 12);
+    ASSERT_EQ(s->id(), 7);
+    ASSERT_EQ(s->masterSeed(), 12);
+    ASSERT_NEAR(s->getSimulationRunningTime(), 0.0, 0.00001);
+    ASSERT_EQ(env->getAgents().size(), 0);
+    ASSERT_TRUE(env->getMessages(0).empty());
+
+    // the environment is kept, but gets fresh agents
+    s->initEnvironment();
+    s->initAgents();
+    ASSERT_EQ(s->getEnvironment(), env);
+    ASSERT_EQ(env->getRandomService(), s->getRandomService());
+
+    auto agents = env->getAgents();
+    ASSERT_EQ(agents.size(), 2);
+    for(const auto& a: agents)
+    {
+        ASSERT_TRUE(std::find(firstAgents.begin(), firstAgents.end(), a) == firstAgents.end());
+        ASSERT_NEAR(a->getPosition().x(), 0.0, 0.00001);
+    }
+
+    s->runSimulation(0.1, 2.0);
+    ASSERT_NEAR(s->getSimulationRunningTime(), 2.0, 0.00001);
+
+    // a released environment is created again
+    s->releaseEnvironment();
+    s->reset(8, 12);
+    s->initEnvironment();
+    ASSERT_NE(s->getEnvironment(), env);
+}
+
+namespace
+{
+    std::atomic_size_t nCreatedCrowds(0);
+    std::atomic_size_t nResetCrowds(0);
+
+    class CrowdFactory: public AgentFactory
+    {
+    public:
+        CrowdFactory(double maxSpeed, double obsDistance) : m_maxSpeed(maxSpeed), m_obsDistance(obsDistance) {}
+
+        std::list<std::shared_ptr<Agent>> createAgents() override
+        {
+            nCreatedCrowds++;
+            std::normal_distribution<> reactionDist{0.4, 0.1};
+            std::list<std::shared_ptr<Agent>> agents;
+            for(unsigned int k = 0; k < 16; k++)
+            {
+                auto h = Human::createHuman(k, m_maxSpeed, 1.0, m_obsDistance, reactionDist(randomStream()));
+                h->setPosition(Eigen::Vector2d(0.01 * (k % 4), 0.01 * (k / 4)));
+                h->addObjective(std::make_shared<MaintainDistance>(k, 1, h, m_obsDistance));
+                agents.push_back(h);
+            }
+            return agents;
+        }
+
+        std::list<std::shared_ptr<Agent>> resetAgents(const std::list<std::shared_ptr<Agent>>& previous) override
+        {
+            nResetCrowds++;
+            std::normal_distribution<> reactionDist{0.4, 0.1};
+            unsigned int k = 0;
+            for(const auto& a: previous)
+            {
+                auto h = std::static_pointer_cast<Human>(a);
+                h->reset();
+                h->setParameters(m_maxSpeed, 1.0, m_obsDistance, reactionDist(randomStream()));
+                h->setPosition(Eigen::Vector2d(0.01 * (k % 4), 0.01 * (k / 4)));
+                std::static_pointer_cast<MaintainDistance>(h->getActiveObjective())->setObservationDistance(m_obsDistance);
+                k++;
+            }
+            return previous;
+        }
+
+    private:
+        double m_maxSpeed;
+        double m_obsDistance;
+    };
+
+    std::vector<Eigen::Vector2d> positions(const std::shared_ptr<Simulation>& s)
+    {
+        std::vector<Eigen::Vector2d> pos;
+        for(const auto& a: s->getEnvironment()->getAgents())
+        {
+            pos.push_back(a->getPosition());
+        }
+        return pos;
+    }
+}
+
+TEST(Simulation, ResetAgentsInPlace)
+{
+    auto s = Simulation::createSimulation(4);
+    s->setAgentFactory(std::make_shared<CrowdFactory>(1.0, 1.0));
+    s->setEnvironmentFactory(std::make_shared<EnvironmentFactory>());
+    s->setEnableLogMessages(false);
+    s->initEnvironment();
+    s->initAgents();
+    s->runSimulation(0.1, 3.0);
+    auto firstAgents = s->getEnvironment()->getAgents();
+
+    // the same agent objects get the parameters of the next run
+    s->reset(5, 9);
+    s->setAgentFactory(std::make_shared<CrowdFactory>(2.0, 1.5));
+    s->initEnvironment();
+    s->initAgents();
+    auto agents = s->getEnvironment()->getAgents();
+    ASSERT_EQ(agents, firstAgents);
+    for(const auto& a: agents)
+    {
+        auto h = std::static_pointer_cast<Human>(a);
+        ASSERT_DOUBLE_EQ(h->velocityLimit(), 2.0);
+        ASSERT_DOUBLE_EQ(h->observationDistance(), 1.5);
+        ASSERT_DOUBLE_EQ(std::static_pointer_cast<MaintainDistance>(h->getActiveObjective())->observationDistance(), 1.5);
+        ASSERT_EQ(h->getVelocity(), Eigen::Vector2d(0.0, 0.0));
+        ASSERT_EQ(h->getStressLevel(), 0.0);
+    }
+    s->runSimulation(0.1, 3.0);
+
+    // ... and behave like freshly created agents
+    auto fresh = Simulation::createSimulation(5);
+    fresh->setMasterSeed(9);
+    fresh->setAgentFactory(std::make_shared<CrowdFactory>(2.0, 1.5));
+    fresh->setEnvironmentFactory(std::make_shared<EnvironmentFactory>());
+    fresh->setEnableLogMessages(false);
+    fresh->initEnvironment();
+    fresh->initAgents();
+    fresh->runSimulation(0.1, 3.0);
+    ASSERT_EQ(positions(s), positions(fresh));
+
+    // another kind of agent factory creates the agents again
+    s->reset(6, 9);
+    s->setAgentFactory(std::make_shared<AgentFactory>());
+    s->initEnvironment();
+    s->initAgents();
+    ASSERT_EQ(s->getEnvironment()->getAgents().size(), 1);
+}
+
+TEST(Simulation, ResetAgentsInParallelWorkers)
+{
+    nCreatedCrowds = 0;
+    nResetCrowds = 0;
+
+    auto p = Parallel::createParallel(1);
+    p->setRecycleSimulations(true);
+    for(unsigned int k = 0; k < 4; k++)
+    {
+        auto s = Simulation::createSimulation(k);
+        s->setAgentFactory(std::make_shared<CrowdFactory>(1.0 + k, 1.0));
+        s->setEnvironmentFactory(std::make_shared<EnvironmentFactory>());
+        s->setEnableLogMessages(false);
+        p->addSimulation(s, 0.1, 1.0);
+    }
+    p->run();
+    p->wait();
+
+    // the worker creates the agents once and resets them for the other runs
+    ASSERT_EQ(nCreatedCrowds, 1);
+    ASSERT_EQ(nResetCrowds, 3);
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include <mutex>
+
+#include "tiled_environment.h"
+#include "human.h"
+#include "maintain_distance.h"
+#include "random_stream.h"
+
+TEST(TiledEnvironment, TilesAndMigration)
+{
+    auto e = TiledEnvironment::createTiledEnvironment(1, 10.0, 15.0, 2);
+
+    auto a = Agent::createAgent(1);
+    a->setPosition(Eigen::Vector2d(1.0, 1.0));
+    a->setEnvironment(e);
+    e->addAgent(a);
+
+    auto b = Agent::createAgent(2);
+    b->setPosition(Eigen::Vector2d(12.0, 1.0));
+    b->setEnvironment(e);
+    e->addAgent(b);
+
+    auto c = Agent::createAgent(3);
+    c->setPosition(Eigen::Vector2d(-25.0, 1.0));
+    c->setEnvironment(e);
+    e->addAgent(c);
+
+    e->computeTiledDistances();
+    ASSERT_EQ(e->numberOfTiles(), 3);
+    ASSERT_EQ(e->numberOfMigrations(), 0);
+
+    // a and b see each other across the tile border, c is too far away
+    auto qa = e->getAgentDistancesToAllOtherAgents(1);
+    ASSERT_EQ(qa.size(), 1);
+    ASSERT_EQ(qa.top().targetId, 2);
+    ASSERT_DOUBLE_EQ(qa.top().dist, 11.0);
+
+    auto qb = e->getAgentDistancesToAllOtherAgents(2);
+    ASSERT_EQ(qb.size(), 1);
+    ASSERT_EQ(qb.top().targetId, 1);
+    ASSERT_TRUE((qb.top().vect - Eigen::Vector2d(-11.0, 0.0)).isMuchSmallerThan(0.0001));
+
+    ASSERT_EQ(e->getAgentDistancesToAllOtherAgents(3).size(), 0);
+
+    // b moves into the tile of a
+    b->setPosition(Eigen::Vector2d(4.0, 1.0));
+    e->computeTiledDistances();
+    ASSERT_EQ(e->numberOfTiles(), 2);
+    ASSERT_EQ(e->numberOfMigrations(), 1);
+    ASSERT_DOUBLE_EQ(e->getAgentDistancesToAllOtherAgents(1).top().dist, 3.0);
+}
+
+class CrowdEnv: public TiledEnvironment
+{
+public:
+    CrowdEnv(size_t nThreads): TiledEnvironment(1, 4.0, 2.0, nThreads) {}
+};
+
+std::vector<Eigen::Vector2d> runCrowd(std::shared_ptr<Environment> e, size_t nSteps)
+{
+    RandomStream rnd(7, 0);
+    std::vector<std::shared_ptr<Human>> humans;
+    for(unsigned int k = 0; k < 200; k++)
+    {
+        auto h = Human::createHuman(k, 1.5, 2.5, 1.5, 0.0);
+        h->setPosition(Eigen::Vector2d(rnd.uniform() * 20.0, rnd.uniform() * 20.0));
+        h->addObjective(std::shared_ptr<MaintainDistance>(new MaintainDistance(k, 1, h, 1.5)));
+        h->setEnvironment(e);
+        e->addAgent(h);
+        humans.push_back(h);
+    }
+
+    for(size_t s = 0; s < nSteps; s++)
+    {
+        e->update(0.1);
+    }
+
+    std::vector<Eigen::Vector2d> positions;
+    for(auto& h: humans)
+    {
+        positions.push_back(h->getPosition());
+    }
+    return positions;
+}
+
+TEST(TiledEnvironment, SameAsEnvironment)
+{
+    auto ref = runCrowd(Environment::createEnvironment(1), 20);
+    auto tiledSingle = runCrowd(std::shared_ptr<Environment>(new CrowdEnv(1)), 20);
+    auto tiledMulti = runCrowd(std::shared_ptr<Environment>(new CrowdEnv(4)), 20);
+
+    ASSERT_EQ(ref.size(), tiledSingle.size());
+    for(size_t k = 0; k < ref.size(); k++)
+    {
+        // independent of thread count
+        ASSERT_EQ(tiledSingle[k], tiledMulti[k]);
+
+        // halo width exceeds observation distance -> same result as exhaustive distance computation
+        ASSERT_NEAR((ref[k] - tiledSingle[k]).norm(), 0.0, 1e-9);
+    }
+
+    // humans moved
+    ASSERT_GT((ref[0] - runCrowd(Environment::createEnvironment(1), 0)[0]).norm(), 0.0);
+}
+
+class DisablerAgent: public Agent
+{
+public:
+    DisablerAgent(unsigned int id, unsigned int victim): Agent(id), m_victim(victim) {}
+    void update(double time) override
+    {
+        Agent::update(time);
+        sendMessage(m_victim, Message::Disable);
+    }
+    unsigned int m_victim;
+};
+
+TEST(TiledEnvironment, MessagesDeliveredAtEndOfStep)
+{
+    auto e = TiledEnvironment::createTiledEnvironment(1, 10.0, 5.0, 2);
+    e->setEnableLogMessages(false);
+
+    auto victim = Agent::createAgent(1);
+    victim->setEnvironment(e);
+    e->addAgent(victim);
+
+    auto disabler = std::shared_ptr<DisablerAgent>(new DisablerAgent(2, 1));
+    disabler->setPosition(Eigen::Vector2d(100.0, 0.0));
+    disabler->setEnvironment(e);
+    e->addAgent(disabler);
+
+    e->update(1.0);
+    ASSERT_TRUE(victim->getEnabled());
+    ASSERT_EQ(e->getMessages(1).size(), 1);
+
+    e->update(1.0);
+    ASSERT_FALSE(victim->getEnabled());
+}
+
+TEST(TiledEnvironment, ImmediateMessageDelivery)
+{
+    auto e = TiledEnvironment::createTiledEnvironment(1, 10.0, 5.0, 2);
+    e->setEnableLogMessages(false);
+    e->setMessageDelivery(TiledEnvironment::Immediate);
+    ASSERT_EQ(e->messageDelivery(), TiledEnvironment::Immediate);
+
+    // victim is updated after the disabler within the same tile
+    auto disabler = std::shared_ptr<DisablerAgent>(new DisablerAgent(2, 1));
+    disabler->setEnvironment(e);
+    e->addAgent(disabler);
+
+    auto victim = Agent::createAgent(1);
+    victim->setEnvironment(e);
+    e->addAgent(victim);
+
+    e->update(1.0);
+    ASSERT_FALSE(victim->getEnabled());
+}
+
+namespace
+{
+    class ThreadRecordingAgent: public Agent
+    {
+    public:
+        ThreadRecordingAgent(unsigned int id, std::set<std::thread::id>& ids, std::mutex& mutex) :
+            Agent(id), m_ids(ids), m_mutex(mutex) {}
+
+        void update(double time) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_ids.insert(std::this_thread::get_id());
+            }
+            Agent::update(time);
+        }
+
+    private:
+        std::set<std::thread::id>& m_ids;
+        std::mutex& m_mutex;
+    };
+}
+
+TEST(TiledEnvironment, WorkerThreadsReused)
+{
+    std::set<std::thread::id> ids;
+    std::mutex mutex;
+    auto e = TiledEnvironment::createTiledEnvironment(1, 10.0, 5.0, 3);
+    for(unsigned int k = 0; k < 20; k++)
+    {
+        auto a = std::make_shared<ThreadRecordingAgent>(k + 1, ids, mutex);
+        a->setPosition(Eigen::Vector2d(k * 20.0, 0.0));
+        a->setEnvironment(e);
+        e->addAgent(a);
+    }
+
+    // fresh threads per step would give new thread ids
+    for(int s = 0; s < 50; s++)
+    {
+        e->update(0.1);
+    }
+    ASSERT_LE(ids.size(), 3);
+    ASSERT_GE(ids.size(), 1);
+
+    // reset stops the workers, the next update starts them again
+    e->reset();
+    auto a = std::make_shared<ThreadRecordingAgent>(1, ids, mutex);
+    a->setEnvironment(e);
+    e->addAgent(a);
+    e->update(0.1);
+}